@@ -10,8 +10,13 @@
 
 #include <algorithm>
 #include <cctype>
+#include <clocale>
 #include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <deque>
+#include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
@@ -26,7 +31,16 @@
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/split.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/iterator/iterator_adaptor.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/type_traits/is_convertible.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/utility/enable_if.hpp>
+#include <boost/utility/string_ref.hpp>
 
 #if __cplusplus <= 199711L
 #define MEM_FN std::mem_fun_ref
@@ -34,8 +48,444 @@
 #define MEM_FN std::mem_fn
 #endif
 
+#if !defined(SLHAEA_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define SLHAEA_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if !defined(SLHAEA_NO_THREADS) && __cplusplus >= 201103L
+#define SLHAEA_THREADS
+#include <atomic>
+#include <exception>
+#include <thread>
+#endif
+
+#if !defined(SLHAEA_NO_CHARCONV) && __cplusplus >= 201703L && \
+    defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#include <system_error>
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define SLHAEA_CHARCONV
+#endif
+#endif
+#endif
+
+#if !defined(SLHAEA_NO_SIMD) && defined(__AVX2__)
+#define SLHAEA_AVX2
+#include <immintrin.h>
+#elif !defined(SLHAEA_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#define SLHAEA_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace SLHAea {
 
+namespace detail {
+
+// number_kind<T>::value is 1 for the integer types and 2 for the
+// floating-point types that to(), to_string() and write_number()
+// convert without lexical_cast, and 0 for all other types.
+template<class T> struct number_kind { static const int value = 0; };
+template<> struct number_kind<short> { static const int value = 1; };
+template<> struct number_kind<unsigned short> { static const int value = 1; };
+template<> struct number_kind<int> { static const int value = 1; };
+template<> struct number_kind<unsigned int> { static const int value = 1; };
+template<> struct number_kind<long> { static const int value = 1; };
+template<> struct number_kind<unsigned long> { static const int value = 1; };
+#ifdef BOOST_HAS_LONG_LONG
+template<> struct number_kind<boost::long_long_type>
+{ static const int value = 1; };
+template<> struct number_kind<boost::ulong_long_type>
+{ static const int value = 1; };
+#endif
+template<> struct number_kind<float> { static const int value = 2; };
+template<> struct number_kind<double> { static const int value = 2; };
+
+template<int Kind> struct number_tag {};
+
+/**
+ * Writes the decimal representation of the integer \p value, as
+ * produced by to_string(), to the characters before \p last and
+ * returns a pointer to its first character. At most
+ * <tt>std::numeric_limits<T>::digits10 + 2</tt> characters (11 for
+ * int) are written.
+ */
+template<class T> inline char*
+int_to_chars(T value, char* last)
+{
+  const bool negative = value < T();
+  boost::uintmax_t magnitude = negative ?
+    0 - static_cast<boost::uintmax_t>(value) :
+    static_cast<boost::uintmax_t>(value);
+  do
+  {
+    *--last = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (negative) *--last = '-';
+  return last;
+}
+
+/**
+ * Parses the decimal number in [\p first, \p last) if it has at most
+ * 15 significant digits and a decimal exponent of at most 22. The
+ * result equals the correctly rounded value because the digits and
+ * the power of ten are exact doubles that are combined with a single
+ * operation. Returns false for all other strings.
+ */
+inline bool
+parse_decimal(const char* first, const char* last, double& value)
+{
+  static const double powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  const char* c = first;
+  const bool negative = c != last && *c == '-';
+  if (c != last && (*c == '-' || *c == '+')) ++c;
+
+  boost::uint64_t mantissa = 0;
+  int digits = 0, exponent = 0;
+  bool has_digits = false, in_fraction = false;
+  for (; c != last; ++c)
+  {
+    if (*c == '.' && !in_fraction) { in_fraction = true; continue; }
+    if (*c < '0' || *c > '9') break;
+    has_digits = true;
+    if (mantissa != 0 || *c != '0')
+    {
+      if (++digits > 15) return false;
+      mantissa = mantissa * 10 + static_cast<boost::uint64_t>(*c - '0');
+    }
+    if (in_fraction) --exponent;
+  }
+  if (!has_digits) return false;
+
+  if (c != last && (*c == 'e' || *c == 'E'))
+  {
+    const bool negative_exponent = ++c != last && *c == '-';
+    if (c != last && (*c == '-' || *c == '+')) ++c;
+    if (c == last || last - c > 3) return false;
+    int e = 0;
+    for (; c != last && *c >= '0' && *c <= '9'; ++c) e = e * 10 + (*c - '0');
+    exponent += negative_exponent ? -e : e;
+  }
+  if (c != last || exponent < -22 || exponent > 22) return false;
+
+  value = static_cast<double>(mantissa);
+  value = (exponent < 0) ? value / powers_of_ten[-exponent]
+                         : value * powers_of_ten[exponent];
+  if (negative) value = -value;
+  return true;
+}
+
+// The parse_number() overloads parse all of [first, last) as a number
+// and return false if that is not possible. Strings that they reject
+// are converted with lexical_cast, so they only need to accept a
+// subset of what lexical_cast accepts and must give the same values.
+#ifdef SLHAEA_CHARCONV
+template<class T, int Kind> inline bool
+parse_number(const char* first, const char* last, T& value, number_tag<Kind>)
+{
+  const std::from_chars_result result = std::from_chars(first, last, value);
+  return result.ec == std::errc() && result.ptr == last;
+}
+#else
+template<class T> inline bool
+parse_number(const char* first, const char* last, T& value, number_tag<1>)
+{
+  const bool negative = first != last && *first == '-';
+  if (negative && !std::numeric_limits<T>::is_signed) return false;
+  if (negative) ++first;
+  if (first == last) return false;
+
+  T result = T();
+  for (; first != last; ++first)
+  {
+    if (*first < '0' || *first > '9') return false;
+    const T digit = static_cast<T>(*first - '0');
+    if (negative)
+    {
+      if (result < (std::numeric_limits<T>::min() + digit) / 10) return false;
+      result = static_cast<T>(result * 10 - digit);
+    }
+    else
+    {
+      if (result > (std::numeric_limits<T>::max() - digit) / 10) return false;
+      result = static_cast<T>(result * 10 + digit);
+    }
+  }
+  value = result;
+  return true;
+}
+
+template<class T> inline bool
+parse_number(const char*, const char*, T&, number_tag<2>)
+{ return false; }
+
+inline bool
+parse_number(const char* first, const char* last, double& value,
+             number_tag<2>)
+{ return parse_decimal(first, last, value); }
+#endif
+
+template<class Target, class Source> inline Target
+parse_or_cast(const char* first, const char* last, const Source& arg)
+{
+  Target value = Target();
+  if (parse_number(first, last, value,
+                   number_tag<number_kind<Target>::value>())) return value;
+  return boost::lexical_cast<Target>(arg);
+}
+
+// Conversion of to(). Strings are converted to numbers with
+// parse_number() and everything else with lexical_cast.
+template<class Target, class Source,
+         bool = (number_kind<Target>::value != 0)>
+struct converter
+{
+  static Target
+  convert(const Source& arg)
+  { return boost::lexical_cast<Target>(arg); }
+};
+
+template<class Target>
+struct converter<Target, std::string, true>
+{
+  static Target
+  convert(const std::string& arg)
+  {
+    return parse_or_cast<Target>(arg.data(), arg.data() + arg.length(),
+                                 arg);
+  }
+};
+
+template<class Target>
+struct converter<Target, const char*, true>
+{
+  static Target
+  convert(const char* arg)
+  { return parse_or_cast<Target>(arg, arg + std::strlen(arg), arg); }
+};
+
+template<class Target>
+struct converter<Target, char*, true>
+  : converter<Target, const char*, true> {};
+
+template<class Target, std::size_t N>
+struct converter<Target, char[N], true>
+  : converter<Target, const char*, true> {};
+
+/**
+ * Converts \p arg like lexical_cast<std::string>() if \p precision is
+ * negative and like an std::ostream in scientific notation with the
+ * given precision otherwise.
+ */
+template<class Source> inline std::string
+stream_to_string(const Source& arg, int precision)
+{
+  if (precision < 0) return boost::lexical_cast<std::string>(arg);
+  std::ostringstream output;
+  output << std::setprecision(precision) << std::scientific << arg;
+  return output.str();
+}
+
+#ifndef SLHAEA_CHARCONV
+/**
+ * Returns true if the C locale writes and reads floating-point numbers
+ * with \c '.' as decimal point, so that std::sprintf() and
+ * std::strtod() can be used instead of streams.
+ */
+inline bool
+has_decimal_dot()
+{
+  const char* point = std::localeconv()->decimal_point;
+  return point[0] == '.' && point[1] == '\0';
+}
+
+/**
+ * Writes \p value like std::printf("%.*e") into \p buffer, which
+ * must be large enough for \p precision (at most 255), and returns a
+ * pointer to the terminating null character.
+ */
+inline char*
+print_scientific(char* buffer, double value, int precision)
+{ return buffer + std::sprintf(buffer, "%.*e", precision, value); }
+
+/** Copies [\p str, \p str_last) to [\p first, \p last) if it fits. */
+inline char*
+copy_chars(const char* str, const char* str_last, char* first, char* last)
+{
+  if (str_last - str > last - first) return 0;
+  return std::copy(str, str_last, first);
+}
+#endif
+
+// The format_number() overloads write a number like
+// stream_to_string() into [first, last) and return a pointer to one
+// past the last written character, or 0 if the buffer is too small.
+template<class T> inline char*
+format_number(char* first, char* last, T value, int, number_tag<1>)
+{
+#ifdef SLHAEA_CHARCONV
+  const std::to_chars_result result = std::to_chars(first, last, value);
+  return result.ec == std::errc() ? result.ptr : 0;
+#else
+  char buffer[std::numeric_limits<T>::digits10 + 3];
+  char* const buffer_last = buffer + sizeof(buffer);
+  const char* buffer_first = int_to_chars(value, buffer_last);
+  if (buffer_last - buffer_first > last - first) return 0;
+  return std::copy(buffer_first, static_cast<const char*>(buffer_last),
+                   first);
+#endif
+}
+
+template<class T> inline char*
+format_number(char* first, char* last, T value, int precision,
+              number_tag<2>)
+{
+#ifdef SLHAEA_CHARCONV
+  // lexical_cast writes floating-point numbers like %g with the
+  // precision below.
+  static const int lexical_precision =
+    2 + std::numeric_limits<T>::digits * 30103L / 100000L;
+  const std::to_chars_result result = (precision < 0) ?
+    std::to_chars(first, last, value, std::chars_format::general,
+                  lexical_precision) :
+    std::to_chars(first, last, value, std::chars_format::scientific,
+                  precision);
+  return result.ec == std::errc() ? result.ptr : 0;
+#else
+  if (precision >= 0 && precision <= 255 && has_decimal_dot())
+  {
+    char buffer[300];
+    return copy_chars(buffer, print_scientific(buffer, value, precision),
+                      first, last);
+  }
+  const std::string str = stream_to_string(value, precision);
+  if (str.length() > static_cast<std::size_t>(last - first)) return 0;
+  return std::copy(str.begin(), str.end(), first);
+#endif
+}
+
+template<class Source> inline char*
+format_number(char* first, char* last, const Source& arg, int precision,
+              number_tag<0>)
+{
+  const std::string str = stream_to_string(arg, precision);
+  if (str.length() > static_cast<std::size_t>(last - first)) return 0;
+  return std::copy(str.begin(), str.end(), first);
+}
+
+template<class Source> inline std::string
+number_to_string(const Source& arg, int precision, number_tag<0>)
+{ return stream_to_string(arg, precision); }
+
+template<class Source, int Kind> inline std::string
+number_to_string(const Source& arg, int precision, number_tag<Kind>)
+{
+#ifndef SLHAEA_CHARCONV
+  if (Kind == 2 && precision < 0) return stream_to_string(arg, precision);
+#endif
+  char buffer[64];
+  const char* last = format_number(buffer, buffer + sizeof(buffer), arg,
+                                   precision, number_tag<Kind>());
+  return last ? std::string(static_cast<const char*>(buffer), last) :
+    stream_to_string(arg, precision);
+}
+
+// The format_shortest() overloads write a floating-point number in
+// scientific notation with the fewest digits that are converted back
+// to the same value by to() and return a pointer to one past the last
+// written character, or 0 if the buffer is too small.
+#ifdef SLHAEA_CHARCONV
+template<class T> inline char*
+format_shortest(char* first, char* last, T value, number_tag<2>)
+{
+  const std::to_chars_result result =
+    std::to_chars(first, last, value, std::chars_format::scientific);
+  return result.ec == std::errc() ? result.ptr : 0;
+}
+#else
+inline bool
+reads_back(const char* str, const char*, double value)
+{ return std::strtod(str, 0) == value; }
+
+inline bool
+reads_back(const char* str, const char* last, float value)
+{
+  const std::string copy(str, last);
+  return converter<float, std::string>::convert(copy) == value;
+}
+
+template<class T> inline char*
+format_shortest(char* first, char* last, T value, number_tag<2>)
+{
+  const int digits10 = std::numeric_limits<T>::digits10;
+  const int max_precision =
+    1 + std::numeric_limits<T>::digits * 30103L / 100000L;
+  if (!has_decimal_dot())
+  { return format_shortest(first, last, value, number_tag<0>()); }
+
+  // Decimals with up to digits10 significant digits are converted to
+  // distinct values. So if the value is read back from digits10
+  // digits, its shortest representation is these digits without
+  // trailing zeros. Otherwise one of the next precisions is needed.
+  char buffer[64];
+  for (int precision = digits10 - 1; precision <= max_precision; ++precision)
+  {
+    char* end = print_scientific(buffer, value, precision);
+    if (precision == digits10 - 1)
+    {
+      char* exponent = std::find(buffer, end, 'e');
+      char* mantissa_last = exponent;
+      while (mantissa_last[-1] == '0') --mantissa_last;
+      if (mantissa_last[-1] == '.') --mantissa_last;
+      end = std::copy(exponent, end, mantissa_last);
+      *end = '\0';
+    }
+    if (precision == max_precision || reads_back(buffer, end, value))
+    { return copy_chars(buffer, end, first, last); }
+  }
+  return 0;
+}
+#endif
+
+template<class T, int Kind> inline char*
+format_shortest(char* first, char* last, T value, number_tag<Kind>)
+{
+  // Every precision that is at least the precision of the shortest
+  // representation converts back to value, so it is found by a binary
+  // search. max_precision always suffices (except for NaN).
+  const int max_precision =
+    1 + std::numeric_limits<T>::digits * 30103L / 100000L;
+  if (value != value || value == std::numeric_limits<T>::infinity() ||
+      value == -std::numeric_limits<T>::infinity())
+  { return format_number(first, last, value, max_precision,
+                         number_tag<Kind>()); }
+
+  int low = 0, high = max_precision;
+  while (low < high)
+  {
+    const int mid = (low + high) / 2;
+    const char* end = format_number(first, last, value, mid,
+                                    number_tag<Kind>());
+    if (end == 0) return 0;
+    const std::string str(static_cast<const char*>(first), end);
+    if (converter<T, std::string>::convert(str) == value) high = mid;
+    else low = mid + 1;
+  }
+  return format_number(first, last, value, low, number_tag<Kind>());
+}
+
+} // namespace detail
+
+
 // auxiliary functions
 /**
  * \brief Converts an object of type \c Source to an object of type
@@ -43,24 +493,33 @@ namespace SLHAea {
  * \param arg Object that will be converted.
  * \return Result of the conversion of \p arg to \c Target.
  *
- * This function is a wrapper for
- * \c boost::lexical_cast<Target>().
+ * This function is equivalent to \c boost::lexical_cast<Target>().
+ * Strings are converted to integer types, \c float and \c double
+ * without lexical_cast (with \c std::from_chars if it is available),
+ * so that these conversions do not depend on the locale and do not
+ * allocate memory. Strings that cannot be converted this way are
+ * still passed to lexical_cast, which may accept them or throw.
  */
 template<class Target, class Source> inline Target
 to(const Source& arg)
-{ return boost::lexical_cast<Target>(arg); }
+{ return detail::converter<Target, Source>::convert(arg); }
 
 /**
  * \brief Converts an object of type \c Source to a string.
  * \param arg Object that will be converted.
  * \return Result of the conversion of \p arg to \c std::string.
  *
- * This function is a wrapper for
- * \c boost::lexical_cast<std::string>().
+ * This function is equivalent to
+ * \c boost::lexical_cast<std::string>(). Integers are converted
+ * without lexical_cast, and so are \c float and \c double if
+ * \c std::to_chars is available.
  */
 template<class Source> inline std::string
 to_string(const Source& arg)
-{ return boost::lexical_cast<std::string>(arg); }
+{
+  return detail::number_to_string(arg, -1,
+    detail::number_tag<detail::number_kind<Source>::value>());
+}
 
 /**
  * \brief Converts an object of type \c Source to a string.
@@ -71,16 +530,195 @@ to_string(const Source& arg)
  *
  * This function is equivalent to \c to_string() except that all
  * floating-point numbers are written in scientific notation with the
- * given precision.
+ * given precision. Numbers are converted like in to_string() without
+ * a std::ostringstream.
  */
 template<class Source> inline std::string
 to_string(const Source& arg, int precision)
 {
-  std::ostringstream output;
-  output << std::setprecision(precision) << std::scientific << arg;
-  return output.str();
+  return detail::number_to_string(arg, (precision < 0) ? 6 : precision,
+    detail::number_tag<detail::number_kind<Source>::value>());
+}
+
+/**
+ * \brief Writes an object of type \c Source into a character buffer.
+ * \param first, last Pointers to the initial and final positions of
+ *   the buffer.
+ * \param arg Object that will be written.
+ * \return Pointer to one past the last written character, or 0 if the
+ *   buffer is too small.
+ *
+ * The written characters equal to_string(\p arg). Integers, and
+ * \c float and \c double if \c std::to_chars is available, are
+ * written without allocating memory and independent of the locale.
+ */
+template<class Source> inline char*
+write_number(char* first, char* last, const Source& arg)
+{
+  return detail::format_number(first, last, arg, -1,
+    detail::number_tag<detail::number_kind<Source>::value>());
+}
+
+/**
+ * \brief Writes an object of type \c Source into a character buffer.
+ * \param first, last Pointers to the initial and final positions of
+ *   the buffer.
+ * \param arg Object that will be written.
+ * \param precision Precision of float values that are written in
+ *   scientific notation.
+ * \return Pointer to one past the last written character, or 0 if the
+ *   buffer is too small.
+ *
+ * The written characters equal to_string(\p arg, \p precision).
+ */
+template<class Source> inline char*
+write_number(char* first, char* last, const Source& arg, int precision)
+{
+  return detail::format_number(first, last, arg,
+    (precision < 0) ? 6 : precision,
+    detail::number_tag<detail::number_kind<Source>::value>());
 }
 
+/**
+ * Format of the floating-point numbers that are inserted into a Line.
+ * A %number_format is selected by inserting it into a Line with
+ * Line::operator<<() and is then used for all floating-point numbers
+ * that are inserted into that Line afterwards:
+ * \code
+ * line << number_format::slha() << 25 << 1.25e2;  // "   25  1.25000000E+02"
+ * \endcode
+ * The default format of a Line is digits10(). Only shortest()
+ * guarantees that to() converts the inserted string back to the same
+ * value. Numbers are written with \c std::to_chars if it is available.
+ * Otherwise they are written with std::sprintf() and a \c "%.*e"
+ * format with the precision of the format, and only if the C locale
+ * does not use \c '.' as decimal point with an std::ostringstream.
+ */
+class number_format
+{
+public:
+  /**
+   * Returns the format that writes numbers in scientific notation
+   * with \c std::numeric_limits<T>::digits10 digits after the decimal
+   * point, like to_string(value, digits10).
+   */
+  static number_format
+  digits10()
+  { return number_format(digits10_style, 0); }
+
+  /**
+   * Returns the format that writes numbers in scientific notation
+   * with the fewest digits that to() converts back to the same value.
+   */
+  static number_format
+  shortest()
+  { return number_format(shortest_style, 0); }
+
+  /**
+   * Returns the format that writes numbers in scientific notation
+   * with eight digits after the decimal point and an upper-case
+   * exponent, like \c "%16.8E" in SLHA files.
+   */
+  static number_format
+  slha()
+  { return number_format(slha_style, 8); }
+
+  /**
+   * \brief Returns the format that writes numbers in scientific
+   *   notation with the given precision.
+   * \param precision Number of digits after the decimal point. If it
+   *   is negative, 6 is used like in to_string(value, precision).
+   * \throw std::invalid_argument If \p precision is greater than 255.
+   */
+  static number_format
+  scientific(int precision)
+  {
+    if (precision > 255)
+    {
+      throw std::invalid_argument("SLHAea::number_format::scientific(" +
+        to_string(precision) + ")");
+    }
+    return number_format(scientific_style, (precision < 0) ? 6 : precision);
+  }
+
+  /**
+   * \brief Writes a floating-point number in this format into a
+   *   character buffer.
+   * \param first, last Pointers to the initial and final positions
+   *   of the buffer.
+   * \param value Number that will be written.
+   * \return Pointer to one past the last written character, or 0 if
+   *   the buffer is too small.
+   */
+  template<class T> char*
+  write(char* first, char* last, const T& value) const
+  {
+    const detail::number_tag<detail::number_kind<T>::value> tag;
+    switch (style_)
+    {
+    case shortest_style:
+      return detail::format_shortest(first, last, value, tag);
+    case slha_style:
+    {
+      char* end = detail::format_number(first, last, value, precision_,
+                                        tag);
+      if (end != 0) std::replace(first, end, 'e', 'E');
+      return end;
+    }
+    case scientific_style:
+      return detail::format_number(first, last, value, precision_, tag);
+    default:
+      return detail::format_number(first, last, value,
+                                   std::numeric_limits<T>::digits10, tag);
+    }
+  }
+
+  /**
+   * \brief Converts a floating-point number in this format to a
+   *   string.
+   * \param value Number that will be converted.
+   * \return The characters that write() writes for \p value.
+   */
+  template<class T> std::string
+  str(const T& value) const
+  {
+    // Scientific notation needs at most this many characters besides
+    // the digits after the decimal point.
+    const std::size_t length = 32 + ((style_ == shortest_style) ?
+      std::numeric_limits<T>::digits10 + 3 : digits(value));
+    std::string result(length, '\0');
+    const char* end = write(&result[0], &result[0] + length, value);
+    result.resize(static_cast<std::size_t>(end - result.data()));
+    return result;
+  }
+
+  bool
+  operator==(const number_format& format) const
+  { return style_ == format.style_ && precision_ == format.precision_; }
+
+  bool
+  operator!=(const number_format& format) const
+  { return !(*this == format); }
+
+private:
+  enum style
+  { digits10_style, shortest_style, slha_style, scientific_style };
+
+  number_format(style s, int precision)
+    : style_(static_cast<boost::uint8_t>(s)),
+      precision_(static_cast<boost::uint8_t>(precision)) {}
+
+  template<class T> std::size_t
+  digits(const T&) const
+  {
+    return (style_ == digits10_style) ?
+      static_cast<std::size_t>(std::numeric_limits<T>::digits10) :
+      precision_;
+  }
+
+  boost::uint8_t style_;
+  boost::uint8_t precision_;
+};
 
 namespace detail {
 
@@ -88,6 +726,34 @@ inline bool
 is_all_whitespace(const std::string& str)
 { return str.find_first_not_of(" \t\n\v\f\r") == std::string::npos; }
 
+inline bool
+is_blank(char c)
+{ return c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r'; }
+
+/**
+ * Returns true if the characters in [\p first, \p last) are
+ * \c "BLOCK" or \c "DECAY", compared case-insensitive.
+ */
+inline bool
+is_block_specifier(const char* first, const char* last)
+{
+  if (last - first != 5) return false;
+
+  const char* const specifiers[] = { "BLOCK", "DECAY" };
+  for (int i = 0; i < 2; ++i)
+  {
+    int j = 0;
+    for (; j < 5; ++j)
+    {
+      const char c = first[j];
+      if (((c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c) != specifiers[i][j])
+      { break; }
+    }
+    if (j == 5) return true;
+  }
+  return false;
+}
+
 inline std::string
 to_upper_copy(const std::string& str)
 {
@@ -97,6 +763,15 @@ to_upper_copy(const std::string& str)
   return str_upper;
 }
 
+inline std::string
+to_lower_copy(const std::string& str)
+{
+  std::string str_lower(str.length(), char());
+  std::transform(str.begin(), str.end(), str_lower.begin(),
+    static_cast<int (*)(int)>(std::tolower));
+  return str_lower;
+}
+
 inline void
 trim_left(std::string& str)
 {
@@ -113,636 +788,934 @@ trim_right(std::string& str)
   else str.clear();
 }
 
-} // namespace detail
+/** Hash function for strings that are compared with iequal_to. */
+struct ihash
+{
+  std::size_t
+  operator()(const std::string& str) const
+  {
+    std::size_t seed = 0;
+    for (std::string::const_iterator c = str.begin(); c != str.end(); ++c)
+    { boost::hash_combine(seed, std::toupper(static_cast<unsigned char>(*c))); }
+    return seed;
+  }
+};
 
+/**
+ * Case-insensitive equality of strings. It equals boost::iequals()
+ * with the classic locale but does not construct a locale per call.
+ */
+struct iequal_to
+{
+  bool
+  operator()(const std::string& a, const std::string& b) const
+  {
+    return a.length() == b.length() &&
+      std::equal(a.begin(), a.end(), b.begin(), chars_equal);
+  }
 
-// forward declarations
-class Line;
-class Block;
-class Coll;
-struct Key;
+  static bool
+  chars_equal(char a, char b)
+  {
+    return a == b || std::toupper(static_cast<unsigned char>(a)) ==
+                     std::toupper(static_cast<unsigned char>(b));
+  }
+};
 
-inline std::ostream& operator<<(std::ostream& os, const Line& line);
-inline std::ostream& operator<<(std::ostream& os, const Block& block);
-inline std::ostream& operator<<(std::ostream& os, const Coll& coll);
-inline std::ostream& operator<<(std::ostream& os, const Key& key);
+/** Returns true if \p str equals to_string(\p value). */
+inline bool
+equals_int(const std::string& str, int value)
+{
+  char buffer[11];
+  const char* first = int_to_chars(value, buffer + 11);
+  return str.length() == static_cast<std::size_t>(buffer + 11 - first) &&
+    std::equal(first, static_cast<const char*>(buffer + 11), str.begin());
+}
 
+/**
+ * Parses \p str as a positive decimal integer of at most nine digits
+ * and stores it in \p index. Returns false if \p str is not such an
+ * integer.
+ */
+inline bool
+parse_index(const std::string& str, std::size_t& index)
+{
+  if (str.empty() || str.length() > 9) return false;
+  index = 0;
+  for (std::string::const_iterator c = str.begin(); c != str.end(); ++c)
+  {
+    if (*c < '0' || *c > '9') return false;
+    index = index * 10 + static_cast<std::size_t>(*c - '0');
+  }
+  return index != 0;
+}
 
 /**
- * Container of strings that represents a line in a SLHA structure.
- * This class is a container of strings that represents a line in a
- * SLHA structure. The elements of a %Line are the so called fields of
- * an ordinary SLHA line, which are its whitespace-separated
- * substrings and the comment. For example, if a %Line is constructed
- * from the string <tt>" 1 2 0.123 # a comment"</tt> its elements
- * would be \c "1", \c "2", \c "0.123", and \c "# a comment".
- * Array-style access to the elements with integer indices is provided
- * by the operator[]() and at() functions. %Line also provides
- * introspective functions to find out whether it is a comment or data
- * line for example. Introspective functions that check if an element
- * is a block specifier (\c "BLOCK" or \c "DECAY") always perform
- * case-insensitive comparisons.
- *
- * In addition to storing the fields of a SLHA line, a %Line also
- * stores its formatting (the exact position of the fields in the
- * line). A formatted representation of a %Line can be produced with
- * str() const. The reformat() function clears the previous formatting
- * and indents all elements with an appropriate number of spaces.
+ * Parses \p str as a decimal integer with an optional sign and stores
+ * it in \p value. Returns false if \p str is not such an integer or
+ * if it does not fit into an int.
  */
-class Line
+inline bool
+parse_int(const std::string& str, int& value)
+{
+  std::string::const_iterator c = str.begin();
+  const bool negative = c != str.end() && *c == '-';
+  if (c != str.end() && (*c == '-' || *c == '+')) ++c;
+  if (c == str.end()) return false;
+
+  const unsigned long limit = negative ?
+    0UL - static_cast<unsigned long>(std::numeric_limits<int>::min()) :
+    static_cast<unsigned long>(std::numeric_limits<int>::max());
+  unsigned long magnitude = 0;
+  for (; c != str.end(); ++c)
+  {
+    if (*c < '0' || *c > '9') return false;
+    magnitude = magnitude * 10 + static_cast<unsigned long>(*c - '0');
+    if (magnitude > limit) return false;
+  }
+  value = negative ? static_cast<int>(0UL - magnitude) :
+    static_cast<int>(magnitude);
+  return true;
+}
+
+/** Appends \p count spaces to \p sink. */
+template<class Sink> inline void
+append_spaces(Sink& sink, std::size_t count)
+{
+  static const char spaces[] = "                                ";
+  static const std::size_t size = sizeof(spaces) - 1;
+  for (; count > size; count -= size) sink.append(spaces, size);
+  sink.append(spaces, count);
+}
+
+/**
+ * Sink for the write_to() functions that collects the characters in
+ * a buffer and writes them to an std::ostream when the buffer is full
+ * or when flush() is called. flush() must be called before the sink
+ * is destroyed.
+ */
+class ostream_sink
 {
+public:
+  explicit
+  ostream_sink(std::ostream& os) : os_(os), size_(0) {}
+
+  void
+  append(const char* str, std::size_t n)
+  {
+    if (n > sizeof(buffer_) - size_)
+    {
+      flush();
+      if (n > sizeof(buffer_)) { os_.write(str, n); return; }
+    }
+    std::memcpy(buffer_ + size_, str, n);
+    size_ += n;
+  }
+
+  void
+  flush()
+  {
+    if (size_ != 0) os_.write(buffer_, static_cast<std::streamsize>(size_));
+    size_ = 0;
+  }
+
 private:
-  typedef std::vector<std::string> impl_type;
+  ostream_sink(const ostream_sink&);
+  ostream_sink& operator=(const ostream_sink&);
 
+  std::ostream& os_;
+  std::size_t size_;
+  char buffer_[4096];
+};
+
+/**
+ * Sink for the write_to() functions that only counts the characters,
+ * so that the exact length of the output is known before it is
+ * written.
+ */
+class length_sink
+{
 public:
-  typedef std::string                       value_type;
-  typedef std::string&                      reference;
-  typedef const std::string&                const_reference;
-  typedef impl_type::iterator               iterator;
-  typedef impl_type::const_iterator         const_iterator;
-  typedef impl_type::reverse_iterator       reverse_iterator;
-  typedef impl_type::const_reverse_iterator const_reverse_iterator;
-  typedef impl_type::pointer                pointer;
-  typedef impl_type::const_pointer          const_pointer;
-  typedef impl_type::difference_type        difference_type;
-  typedef impl_type::size_type              size_type;
+  length_sink() : length_(0) {}
 
-  // NOTE: The compiler-generated copy constructor and assignment
-  //   operator for this class are just fine, so we don't need to
-  //   write our own.
+  void
+  append(const char*, std::size_t n)
+  { length_ += n; }
 
-  /** Constructs an empty %Line. */
-  Line() : impl_(), columns_() {}
+  std::size_t
+  length() const
+  { return length_; }
 
-  /**
-   * \brief Constructs a %Line from a string.
-   * \param line String whose fields are used as content of the %Line.
-   * \sa str()
-   */
-  Line(const std::string& line) : impl_(), columns_()
-  { str(line); }
+private:
+  std::size_t length_;
+};
 
-  /**
-   * \brief Assigns content from a string to the %Line.
-   * \param line String whose fields are used as content of the %Line.
-   * \return Reference to \c *this.
-   *
-   * This function is an alias for str().
-   */
-  Line&
-  operator=(const std::string& line)
+/**
+ * Sink for the write_to() functions that copies the characters to
+ * consecutive positions starting at a pointer. The caller must make
+ * sure that there is enough room for them.
+ */
+class pointer_sink
+{
+public:
+  explicit
+  pointer_sink(char* first) : pos_(first) {}
+
+  void
+  append(const char* str, std::size_t n)
   {
-    str(line);
-    return *this;
+    std::memcpy(pos_, str, n);
+    pos_ += n;
   }
 
-  /**
-   * \brief Appends a string to the end of the %Line.
-   * \param arg String that is appended to the %Line.
-   * \return Reference to \c *this.
-   *
-   * This function is an alias for append().
-   */
-  Line&
-  operator+=(const std::string& arg)
+private:
+  char* pos_;
+};
+
+/**
+ * Sink for the write_to() functions that appends the characters to
+ * an std::string. The string grows geometrically in steps of at least
+ * 4 KiB, and the characters are copied directly into it. finish()
+ * must be called to cut off the unused part of the string.
+ */
+class string_sink
+{
+public:
+  explicit
+  string_sink(std::string& str) : str_(str), size_(str.size()) {}
+
+  void
+  append(const char* str, std::size_t n)
   {
-    append(arg);
-    return *this;
+    if (n > str_.size() - size_)
+    { str_.resize(std::max(2 * str_.size(), size_ + n + 4096)); }
+    std::memcpy(&str_[size_], str, n);
+    size_ += n;
   }
 
-  /**
-   * \brief Inserts an element at the end of the %Line.
-   * \param field Element that is inserted at the end of the %Line.
-   * \return Reference to \c *this.
-   *
-   * This function inserts an element at the end of the %Line. If the
-   * the %Line contains a comment, \p field is only appended to the
-   * last element and thus size() remains unchanged.
-   */
-  template<class T> Line&
-  operator<<(const T& field)
+  std::string&
+  finish()
   {
-    std::string field_str = to_string(field);
-    detail::trim_right(field_str);
-    if (field_str.empty()) return *this;
+    str_.resize(size_);
+    return str_;
+  }
 
-    if (contains_comment())
-    { back() += field_str; }
-    else
+private:
+  string_sink(const string_sink&);
+  string_sink& operator=(const string_sink&);
+
+  std::string& str_;
+  std::size_t size_;
+};
+
+/**
+ * Appends the output of \p container.write_to() to \p str in one
+ * pass.
+ */
+template<class Container> inline std::string&
+append_formatted(std::string& str, const Container& container)
+{
+  string_sink sink(str);
+  container.write_to(sink);
+  return sink.finish();
+}
+
+/**
+ * Rarely used data of a Line: the original text of a Line that was
+ * read with Coll::read_verbatim and the cache of the values of its
+ * fields converted to double. Both are stored in one separately
+ * allocated block, with the text behind a header that holds its
+ * length, the capacity of the block and a pointer to the cached
+ * values. Lines that use neither only carry a null pointer.
+ */
+class line_extras
+{
+public:
+  line_extras() : block_(0) {}
+
+  line_extras(const line_extras& extras) : block_(0)
+  {
+    if (extras.has_source())
     {
-      detail::trim_left(field_str);
-      impl_.push_back(field_str);
-      reformat();
+      assign_source(extras.source_data(),
+                    extras.source_data() + extras.source_size());
+    }
+    if (extras.block_ != 0 && extras.head().values != 0)
+    {
+      reserve(0);
+      head().values = new std::vector<entry>(*extras.head().values);
     }
-    return *this;
   }
 
-  /**
-   * \brief Appends a string to the end of the %Line.
-   * \param arg String that is appended to the %Line.
-   * \return Reference to \c *this.
-   *
-   * This function appends \p arg to the output of str() const and
-   * uses this temporary string as input for str(). Based on the
-   * temporary string, size() is increased or remains unchanged.
-   */
-  Line&
-  append(const std::string& arg)
+  ~line_extras()
+  { release(); }
+
+  line_extras&
+  operator=(const line_extras& extras)
   {
-    str(str() + arg);
+    line_extras(extras).swap(*this);
     return *this;
   }
 
-  /**
-   * \brief Assigns content to the %Line based on a string.
-   * \param line String whose fields are used as content of the %Line.
-   * \return Reference to \c *this.
-   *
-   * This function parses \p line and sets the found fields as content
-   * of the %Line. If \p line contains newlines, everything after the
-   * first newline is ignored.
-   *
-   * The exact formatting of \p line is stored internally and can be
-   * reproduced with str() const.
-   */
-  Line&
-  str(const std::string& line)
+#if __cplusplus >= 201103L
+  // NOTE: Without these, the implicit move constructor of Line would
+  //   not be noexcept and std::vector<Line> would copy its elements
+  //   when it grows.
+  line_extras(line_extras&& extras) noexcept
+    : block_(extras.block_)
+  { extras.block_ = 0; }
+
+  line_extras&
+  operator=(line_extras&& extras) noexcept
   {
-    clear();
-    static const std::string whitespace = " \t\v\f\r";
-    const std::size_t last_non_ws =
-      line.substr(0, line.find('\n')).find_last_not_of(whitespace);
-    if (last_non_ws == std::string::npos) return *this;
+    swap(extras);
+    return *this;
+  }
+#endif
 
-    const std::string trimmed_line = line.substr(0, last_non_ws + 1);
-    const std::size_t comment_pos = trimmed_line.find('#');
-    const std::string data = trimmed_line.substr(0, comment_pos);
+  /** Returns true if there is an original text. */
+  bool
+  has_source() const
+  { return block_ != 0 && head().has_source; }
 
-    std::size_t pos1 = data.find_first_not_of(whitespace, 0);
-    std::size_t pos2 = data.find_first_of(whitespace, pos1);
+  const char*
+  source_data() const
+  { return block_ + sizeof(header); }
 
-    while (pos1 != std::string::npos)
-    {
-      impl_.push_back(data.substr(pos1, pos2 - pos1));
-      columns_.push_back(pos1);
+  std::size_t
+  source_size() const
+  { return head().size; }
 
-      pos1 = data.find_first_not_of(whitespace, pos2);
-      pos2 = data.find_first_of(whitespace, pos1);
-    }
+  /** Sets the original text, reusing the current block if possible. */
+  void
+  assign_source(const char* first, const char* last)
+  {
+    const std::size_t n = static_cast<std::size_t>(last - first);
+    reserve(n);
+    head().size = n;
+    head().has_source = true;
+    std::memcpy(block_ + sizeof(header), first, n);
+  }
 
-    if (comment_pos != std::string::npos)
-    {
-      impl_.push_back(trimmed_line.substr(comment_pos));
-      columns_.push_back(comment_pos);
-    }
-    return *this;
+  void
+  clear_source()
+  {
+    if (block_ == 0) return;
+    head().has_source = false;
+    if (head().values == 0) release();
   }
 
-  /** Returns a formatted string representation of the %Line. */
-  std::string
-  str() const
+  /** Returns the cached value of field \p n or 0 if there is none. */
+  const double*
+  find_value(std::size_t n) const
   {
-    if (empty()) return "";
+    if (block_ == 0) return 0;
+    const std::vector<entry>* values = head().values;
+    if (values == 0 || n >= values->size() || !(*values)[n].valid)
+    { return 0; }
+    return &(*values)[n].value;
+  }
 
-    std::ostringstream output;
-    int length = 0, spaces = 0;
+  void
+  store_value(std::size_t n, double value)
+  {
+    reserve(0);
+    if (head().values == 0) head().values = new std::vector<entry>();
+    std::vector<entry>& values = *head().values;
+    if (n >= values.size()) values.resize(n + 1);
+    values[n].value = value;
+    values[n].valid = true;
+  }
 
-    const_iterator field = begin();
-    std::vector<std::size_t>::const_iterator column = columns_.begin();
-    for (; field != end() && column != columns_.end(); ++field, ++column)
-    {
-      spaces = std::max(0, static_cast<int>(*column) - length + 1);
-      length += spaces + field->length();
+  void
+  invalidate_value(std::size_t n)
+  {
+    if (block_ == 0 || head().values == 0) return;
+    if (n < head().values->size()) (*head().values)[n].valid = false;
+  }
 
-      output << std::setw(spaces) << " " << *field;
-    }
-    return output.str().substr(1);
+  void
+  clear_values()
+  {
+    if (block_ == 0) return;
+    delete head().values;
+    head().values = 0;
+    if (!head().has_source) release();
   }
 
-  // element access
-  /**
-   * \brief Subscript access to the strings contained in the %Line.
-   * \param n Index of the string which should be accessed.
-   * \return Read/write reference to the accessed string.
-   *
-   * This operator allows for easy, array-style, data access. Note
-   * that data access with this operator is unchecked and out_of_range
-   * lookups are not defined. (For checked lookups see at().)
-   */
-  reference
-  operator[](size_type n)
-  { return impl_[n]; }
+  void
+  swap(line_extras& extras)
+  { std::swap(block_, extras.block_); }
 
-  /**
-   * \brief Subscript access to the strings contained in the %Line.
-   * \param n Index of the string which should be accessed.
-   * \return Read-only (constant) reference to the accessed string.
-   *
-   * This operator allows for easy, array-style, data access. Note
-   * that data access with this operator is unchecked and out_of_range
-   * lookups are not defined. (For checked lookups see at().)
-   */
-  const_reference
-  operator[](size_type n) const
-  { return impl_[n]; }
+private:
+  struct entry
+  {
+    entry() : value(0.), valid(false) {}
+    double value;
+    bool valid;
+  };
 
-  /**
-   * \brief Provides access to the strings contained in the %Line.
-   * \param n Index of the string which should be accessed.
-   * \return Read/write reference to the accessed string.
-   * \throw std::out_of_range If \p n is an invalid index.
-   */
-  reference
-  at(size_type n)
-  { return impl_.at(n); }
+  struct header
+  {
+    std::vector<entry>* values;
+    std::size_t size;
+    std::size_t capacity;
+    bool has_source;
+  };
 
-  /**
-   * \brief Provides access to the strings contained in the %Line.
-   * \param n Index of the string which should be accessed.
-   * \return Read-only (constant) reference to the accessed string.
-   * \throw std::out_of_range If \p n is an invalid index.
-   */
-  const_reference
-  at(size_type n) const
-  { return impl_.at(n); }
+  header&
+  head() const
+  { return *reinterpret_cast<header*>(block_); }
 
   /**
-   * Returns a read/write reference to the first element of the %Line.
+   * Makes sure that the block exists and has room for \p n characters
+   * of original text. The text is not preserved if the block is
+   * replaced.
    */
-  reference
-  front()
-  { return impl_.front(); }
-
-  /**
-   * Returns a read-only (constant) reference to the first element of
-   * the %Line.
-   */
-  const_reference
-  front() const
-  { return impl_.front(); }
-
-  /**
-   * Returns a read/write reference to the last element of the %Line.
-   */
-  reference
-  back()
-  { return impl_.back(); }
-
-  /**
-   * Returns a read-only (constant) reference to the last element of
-   * the %Line.
-   */
-  const_reference
-  back() const
-  { return impl_.back(); }
-
-  // iterators
-  /**
-   * Returns a read/write iterator that points to the first element in
-   * the %Line. Iteration is done in ordinary element order.
-   */
-  iterator
-  begin()
-  { return impl_.begin(); }
-
-  /**
-   * Returns a read-only (constant) iterator that points to the first
-   * element in the %Line. Iteration is done in ordinary element
-   * order.
-   */
-  const_iterator
-  begin() const
-  { return impl_.begin(); }
-
-  /**
-   * Returns a read-only (constant) iterator that points to the first
-   * element in the %Line. Iteration is done in ordinary element
-   * order.
-   */
-  const_iterator
-  cbegin() const
-  { return impl_.begin(); }
-
-  /**
-   * Returns a read/write iterator that points one past the last
-   * element in the %Line. Iteration is done in ordinary element
-   * order.
-   */
-  iterator
-  end()
-  { return impl_.end(); }
-
-  /**
-   * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Line. Iteration is done in ordinary element
-   * order.
-   */
-  const_iterator
-  end() const
-  { return impl_.end(); }
+  void
+  reserve(std::size_t n)
+  {
+    if (block_ != 0 && head().capacity >= n) return;
+
+    char* block = new char[sizeof(header) + n];
+    header& h = *reinterpret_cast<header*>(block);
+    h.values = (block_ != 0) ? head().values : 0;
+    h.size = 0;
+    h.capacity = n;
+    h.has_source = false;
+    delete[] block_;
+    block_ = block;
+  }
 
-  /**
-   * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Line. Iteration is done in ordinary element
-   * order.
-   */
-  const_iterator
-  cend() const
-  { return impl_.end(); }
+  void
+  release()
+  {
+    if (block_ == 0) return;
+    delete head().values;
+    delete[] block_;
+    block_ = 0;
+  }
 
-  /**
-   * Returns a read/write reverse iterator that points to the last
-   * element in the %Line. Iteration is done in reverse element order.
-   */
-  reverse_iterator
-  rbegin()
-  { return impl_.rbegin(); }
+  char* block_;
+};
 
-  /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Line. Iteration is done in reverse
-   * element order.
-   */
-  const_reverse_iterator
-  rbegin() const
-  { return impl_.rbegin(); }
+/**
+ * Returns a new value for a generation_counter. The values are taken
+ * from one process-wide sequence, so no two calls return the same
+ * value.
+ */
+inline unsigned long
+next_generation()
+{
+#ifdef SLHAEA_THREADS
+  static std::atomic<unsigned long> last(0);
+  return ++last;
+#else
+  static unsigned long last = 0;
+  return ++last;
+#endif
+}
 
-  /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Line. Iteration is done in reverse
-   * element order.
-   */
-  const_reverse_iterator
-  crbegin() const
-  { return impl_.rbegin(); }
+/**
+ * Counter of the modifications of a container that invalidate
+ * KeyHandles. Every new, copied, assigned, swapped or modified counter
+ * gets a fresh value from next_generation(), so that a container never
+ * has a value that it or any other container had before, even if it
+ * is constructed at the address of a destroyed one.
+ */
+class generation_counter
+{
+public:
+  generation_counter() : value_(next_generation()) {}
 
-  /**
-   * Returns a read/write reverse iterator that points to one before
-   * the first element in the %Line. Iteration is done in reverse
-   * element order.
-   */
-  reverse_iterator
-  rend()
-  { return impl_.rend(); }
+  generation_counter(const generation_counter&)
+    : value_(next_generation()) {}
 
-  /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Line. Iteration is done in
-   * reverse element order.
-   */
-  const_reverse_iterator
-  rend() const
-  { return impl_.rend(); }
+  generation_counter&
+  operator=(const generation_counter&)
+  {
+    value_ = next_generation();
+    return *this;
+  }
 
-  /**
-   * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Line. Iteration is done in
-   * reverse element order.
-   */
-  const_reverse_iterator
-  crend() const
-  { return impl_.rend(); }
+  void
+  increment()
+  { value_ = next_generation(); }
 
-  // introspection
-  /**
-   * Returns true if the %Line begins with \c "BLOCK" or \c "DECAY"
-   * followed by a block name.
-   */
-  bool
-  is_block_def() const
+  void
+  swap(generation_counter& counter)
   {
-    if (size() < 2) return false;
-
-    const_iterator field = begin();
-    return is_block_specifier(*field) && !is_comment(*++field);
+    value_ = next_generation();
+    counter.value_ = next_generation();
   }
 
-  /** Returns true if the %Line begins with \c "#". */
-  bool
-  is_comment_line() const
-  { return !empty() && is_comment(front()); }
+  unsigned long
+  value() const
+  { return value_; }
 
-  /**
-   * Returns true if the %Line is not empty and if it does not begin
-   * with \c "#", \c "BLOCK" or \c "DECAY".
-   */
-  bool
-  is_data_line() const
-  { return !empty() && !is_comment(front()) && !is_block_specifier(front()); }
+private:
+  unsigned long value_;
+};
 
-  // capacity
-  /** Returns the number of elements in the %Line. */
-  size_type
-  size() const
-  { return impl_.size(); }
+/**
+ * Returns the index of the lowest set bit of \p mask, which must not
+ * be zero.
+ */
+inline unsigned
+lowest_bit(boost::uint64_t mask)
+{
+#if defined(__GNUC__)
+  return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+  unsigned n = 0;
+  for (; !(mask & 1); mask >>= 1) ++n;
+  return n;
+#endif
+}
 
-  /**
-   * Returns the number of elements without the comment in the %Line.
-   */
-  size_type
-  data_size() const
-  { return std::distance(begin(), std::find_if(begin(), end(), is_comment)); }
+/**
+ * Character classifier for the SLHA tokenizer.
+ * A %char_scanner classifies the characters of a buffer 64 at a time
+ * into newlines, blanks (\c ' ', \c '\\t', \c '\\v', \c '\\f',
+ * \c '\\r'), \c '#' and other characters and stores the result as
+ * bit masks. find() then locates the next character of a given set of
+ * classes with a few bit operations. With SSE2 or AVX2 (selected at
+ * compile time, see SLHAEA_NO_SIMD) a window is classified with
+ * vector compares, otherwise with a portable scalar loop. Since a
+ * window is classified only once, all lines and fields in it are
+ * split in one pass over the buffer.
+ */
+class char_scanner
+{
+public:
+  enum char_class { newline = 1, blank = 2, hash = 4, other = 8 };
 
-  /** Returns the size() of the largest possible %Line. */
-  size_type
-  max_size() const
-  { return impl_.max_size(); }
+  char_scanner(const char* first, const char* last)
+    : last_(last), base_(first), newline_(0), blank_(0), hash_(0)
+  { if (first != last) load(first); }
 
-  /** Returns true if the %Line is empty. */
-  bool
-  empty() const
-  { return impl_.empty(); }
+  const char*
+  last() const
+  { return last_; }
 
-  // modifiers
   /**
-   * \brief Swaps data with another %Line.
-   * \param line %Line to be swapped with.
+   * Returns the first position at or after \p pos whose character
+   * belongs to one of the \p classes (a combination of char_class
+   * values), or last() if there is none.
    */
-  void
-  swap(Line& line)
+  const char*
+  find(const char* pos, int classes)
   {
-    impl_.swap(line.impl_);
-    columns_.swap(line.columns_);
+    while (pos < last_)
+    {
+      if (pos < base_ || pos >= base_ + window_size_) load(pos);
+
+      const boost::uint64_t mask = select(classes) >> (pos - base_);
+      if (mask)
+      {
+        const char* found = pos + lowest_bit(mask);
+        return (found < last_) ? found : last_;
+      }
+      pos = base_ + window_size_;
+    }
+    return last_;
   }
 
-  /** Erases all the elements in the %Line. */
-  void
-  clear()
+private:
+  static const std::ptrdiff_t window_size_ = 64;
+
+  boost::uint64_t
+  select(int classes) const
   {
-    impl_.clear();
-    columns_.clear();
+    boost::uint64_t mask = 0;
+    if (classes & newline) mask |= newline_;
+    if (classes & blank)   mask |= blank_;
+    if (classes & hash)    mask |= hash_;
+    if (classes & other)   mask |= ~(newline_ | blank_ | hash_);
+    return mask;
   }
 
-  /** Reformats the string representation of the %Line. */
   void
-  reformat()
+  load(const char* pos)
   {
-    if (empty()) return;
-
-    columns_.clear();
-    const_iterator field = begin();
-    std::size_t pos1 = 0, pos2 = 0;
-
-    if (is_block_specifier(*field))
-    {
-      pos1 = 0;
-      pos2 = pos1 + field->length();
-      columns_.push_back(pos1);
+    base_ = pos;
+    newline_ = blank_ = hash_ = 0;
 
-      if (++field == end()) return;
-
-      pos1 = pos2 + 1;
-      pos2 = pos1 + field->length();
-      columns_.push_back(pos1);
-    }
-    else if (is_comment(*field))
+    if (last_ - pos < window_size_)
     {
-      pos1 = 0;
-      pos2 = pos1 + field->length();
-      columns_.push_back(pos1);
+      // Bits past last_ are classified as other characters.
+      for (std::ptrdiff_t i = 0; i < last_ - pos; ++i)
+      { classify(pos[i], static_cast<boost::uint64_t>(1) << i); }
+      return;
     }
-    else
+#if defined(SLHAEA_AVX2)
+    const __m256i lf = _mm256_set1_epi8('\n'), sp = _mm256_set1_epi8(' ');
+    const __m256i hs = _mm256_set1_epi8('#'), tab = _mm256_set1_epi8('\t');
+    const __m256i four = _mm256_set1_epi8(4);
+    for (int i = 0; i < 2; ++i)
     {
-      pos1 = shift_width_;
-      pos2 = pos1 + field->length();
-      columns_.push_back(pos1);
+      const __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos + 32*i));
+      const __m256i is_lf = _mm256_cmpeq_epi8(v, lf);
+      const __m256i t = _mm256_sub_epi8(v, tab);
+      const __m256i is_ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(t, four), t);
+      const __m256i is_blank = _mm256_andnot_si256(is_lf,
+        _mm256_or_si256(is_ctrl, _mm256_cmpeq_epi8(v, sp)));
+      newline_ |= to_mask(_mm256_movemask_epi8(is_lf)) << (32*i);
+      blank_   |= to_mask(_mm256_movemask_epi8(is_blank)) << (32*i);
+      hash_    |= to_mask(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, hs)))
+                    << (32*i);
     }
-
-    while (++field != end())
+#elif defined(SLHAEA_SSE2)
+    const __m128i lf = _mm_set1_epi8('\n'), sp = _mm_set1_epi8(' ');
+    const __m128i hs = _mm_set1_epi8('#'), tab = _mm_set1_epi8('\t');
+    const __m128i four = _mm_set1_epi8(4);
+    for (int i = 0; i < 4; ++i)
     {
-      pos1 = pos2 + calc_spaces_for_indent(pos2);
-      if (starts_with_sign(*field)) --pos1;
-      pos2 = pos1 + field->length();
-      columns_.push_back(pos1);
+      const __m128i v =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos + 16*i));
+      const __m128i is_lf = _mm_cmpeq_epi8(v, lf);
+      const __m128i t = _mm_sub_epi8(v, tab);
+      const __m128i is_ctrl = _mm_cmpeq_epi8(_mm_min_epu8(t, four), t);
+      const __m128i is_blank = _mm_andnot_si128(is_lf,
+        _mm_or_si128(is_ctrl, _mm_cmpeq_epi8(v, sp)));
+      newline_ |= to_mask(_mm_movemask_epi8(is_lf)) << (16*i);
+      blank_   |= to_mask(_mm_movemask_epi8(is_blank)) << (16*i);
+      hash_    |= to_mask(_mm_movemask_epi8(_mm_cmpeq_epi8(v, hs))) << (16*i);
     }
+#else
+    for (std::ptrdiff_t i = 0; i < window_size_; ++i)
+    { classify(pos[i], static_cast<boost::uint64_t>(1) << i); }
+#endif
   }
 
-  /**
-   * Comments the %Line. This function prefixes the %Line with a
-   * \c "#" and packetizes all its elements into one.
-   */
-  void
-  comment()
-  { if (!empty()) str("#" + str()); }
-
-  /**
-   * Uncomments the %Line. This function removes the first character
-   * of the %Line if it is a \c "#" and splits the former comment into
-   * the corresponding number of fields.
-   */
   void
-  uncomment()
+  classify(char c, boost::uint64_t bit)
   {
-    if (!empty() && is_comment(front()))
-    {
-      front().erase(0, 1);
-      str(str());
-    }
+    if (c == '\n') newline_ |= bit;
+    else if (is_blank(c)) blank_ |= bit;
+    else if (c == '#') hash_ |= bit;
   }
 
+  static boost::uint64_t
+  to_mask(int movemask)
+  { return static_cast<boost::uint32_t>(movemask); }
+
 private:
-  bool
-  contains_comment() const
-  { return std::find_if(rbegin(), rend(), is_comment) != rend(); }
+  const char* last_;
+  const char* base_;
+  boost::uint64_t newline_;
+  boost::uint64_t blank_;
+  boost::uint64_t hash_;
+};
 
-  static std::size_t
-  calc_spaces_for_indent(const std::size_t& pos)
-  {
-    std::size_t width = shift_width_ - (pos % shift_width_);
-    if (width < min_width_) width += shift_width_;
-    return width;
+/**
+ * \brief Locates the next field of a SLHA line.
+ * \param scanner Classifier of the buffer that contains the line.
+ * \param pos Current scan position, advanced past the found field.
+ * \param field_first Set to the beginning of the found field.
+ * \param field_last Set to one past the end of the found field.
+ * \return false if the end of the line was reached before a field
+ *   was found. \p pos then points to the terminating \c '\\n' or
+ *   to the end of the buffer.
+ *
+ * Fields are separated by blanks, a \c '#' starts a comment that
+ * extends (without trailing blanks) up to the end of the line, and a
+ * \c '\\n' or the end of the buffer ends the line.
+ */
+inline bool
+next_field(char_scanner& scanner, const char*& pos,
+           const char*& field_first, const char*& field_last)
+{
+  pos = scanner.find(pos, ~char_scanner::blank);
+  if (pos == scanner.last() || *pos == '\n') return false;
+
+  field_first = pos;
+  if (*pos == '#')
+  {
+    pos = scanner.find(pos + 1, char_scanner::newline);
+    field_last = pos;
+    while (is_blank(field_last[-1])) --field_last;
   }
+  else
+  {
+    pos = scanner.find(pos + 1, char_scanner::newline | char_scanner::blank |
+                                char_scanner::hash);
+    field_last = pos;
+  }
+  return true;
+}
 
-  static bool
-  is_block_specifier(const value_type& field)
+/**
+ * Read-only view of the content of a file.
+ * On POSIX systems the file is mapped into memory, otherwise (or if
+ * the file cannot be mapped, e.g. because it is a pipe) its content
+ * is read into an internal buffer. The file is unmapped when the
+ * %mapped_file is destroyed.
+ */
+class mapped_file
+{
+public:
+  explicit
+  mapped_file(const std::string& path)
+    : data_(0), size_(0), mapped_(false), is_open_(false), buffer_()
   {
-    static const std::size_t specifier_length = 5;
-    if (field.length() != specifier_length) return false;
+#ifdef SLHAEA_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) return;
 
-    const value_type field_upper = detail::to_upper_copy(field);
-    return (field_upper == "BLOCK") || (field_upper == "DECAY");
-  }
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+      void* addr = ::mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED)
+      {
+        data_ = static_cast<const char*>(addr);
+        size_ = static_cast<std::size_t>(st.st_size);
+        mapped_ = true;
+      }
+    }
+    ::close(fd);
+#endif
+    if (mapped_)
+    {
+      is_open_ = true;
+      return;
+    }
 
-  static bool
-  is_comment(const value_type& field)
-  { return !field.empty() && field[0] == '#'; }
+    std::ifstream ifs(path.c_str(), std::ios_base::in | std::ios_base::binary);
+    if (!ifs) return;
+    buffer_.assign(std::istreambuf_iterator<char>(ifs),
+                   std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.length();
+    is_open_ = true;
+  }
 
-  template<class T> Line&
-  insert_fundamental_type(const T& arg)
+  ~mapped_file()
   {
-    static const int digits = std::numeric_limits<T>::digits10;
-    return *this << to_string(arg, digits);
+#ifdef SLHAEA_MMAP
+    if (mapped_) ::munmap(const_cast<char*>(data_), size_);
+#endif
   }
 
-  static bool
-  starts_with_sign(const value_type& field)
-  { return !field.empty() && (field[0] == '-' || field[0] == '+'); }
+  bool
+  is_open() const
+  { return is_open_; }
+
+  const char*
+  begin() const
+  { return data_; }
+
+  const char*
+  end() const
+  { return data_ + size_; }
 
 private:
-  impl_type impl_;
-  std::vector<std::size_t> columns_;
+  mapped_file(const mapped_file&);
+  mapped_file& operator=(const mapped_file&);
 
-  static const std::size_t shift_width_ = 4;
-  static const std::size_t min_width_   = 2;
+private:
+  const char* data_;
+  std::size_t size_;
+  bool mapped_;
+  bool is_open_;
+  std::string buffer_;
 };
 
-template<> inline Line&
-Line::operator<< <float>(const float& number)
+/**
+ * Returns true if the line that starts at \p pos is a block
+ * definition (see Line::is_block_def()). The line is inspected in
+ * place without splitting it into fields.
+ */
+inline bool
+is_block_def_line(const char* pos, const char* last)
 {
-  insert_fundamental_type(number);
-  return *this;
+  while (pos != last && is_blank(*pos)) ++pos;
+  if (last - pos < 6 || !is_block_specifier(pos, pos + 5) ||
+      !is_blank(pos[5])) return false;
+
+  pos += 5;
+  while (pos != last && is_blank(*pos)) ++pos;
+  return pos != last && *pos != '\n' && *pos != '#';
 }
 
-template<> inline Line&
-Line::operator<< <double>(const double& number)
+/**
+ * Returns the beginning of the first block definition in the
+ * character range [\p first, \p last) that starts at or after \p pos,
+ * or \p last if there is none.
+ */
+inline const char*
+find_next_block_def(const char* pos, const char* first, const char* last)
 {
-  insert_fundamental_type(number);
-  return *this;
+  if ((pos == first || pos[-1] == '\n') && is_block_def_line(pos, last))
+  { return pos; }
+
+  char_scanner scanner(pos, last);
+  while ((pos = scanner.find(pos, char_scanner::newline)) != last)
+  { if (is_block_def_line(++pos, last)) return pos; }
+  return last;
 }
 
-template<> inline Line&
-Line::operator<< <long double>(const long double& number)
+/**
+ * Splits the lines in the buffer of \p scanner from \p pos on into
+ * fields, stores views of them in \p fields and passes them to the
+ * callbacks of \p handler (see SLHAea::parse()). The lines are
+ * classified in the same way as by Line::is_block_def() and
+ * Line::is_comment_line().
+ */
+template<class Handler> void
+parse_lines(char_scanner& scanner, const char* pos, Handler& handler,
+            std::vector<boost::string_ref>& fields)
 {
-  insert_fundamental_type(number);
-  return *this;
+  const char* field_first = pos;
+  const char* field_last = pos;
+
+  while (pos != scanner.last())
+  {
+    fields.clear();
+    while (next_field(scanner, pos, field_first, field_last))
+    {
+      fields.push_back(
+        boost::string_ref(field_first, field_last - field_first));
+    }
+    if (pos != scanner.last()) ++pos;
+
+    if (fields.empty()) continue;
+    const boost::string_ref& front = fields.front();
+
+    if (front[0] == '#')
+    { handler.on_comment(front); }
+    else if (fields.size() > 1 && fields[1][0] != '#' &&
+             is_block_specifier(front.begin(), front.end()))
+    { handler.on_block_def(fields[1], fields); }
+    else
+    { handler.on_data_line(fields); }
+  }
 }
 
+/** Field of a Line together with its column in the formatted line. */
+struct line_field
+{
+  line_field() : text(), column(0) {}
+
+  explicit
+  line_field(const std::string& str) : text(str), column(0) {}
+
+  line_field(const char* first, const char* last, std::size_t col)
+    : text(first, last), column(col) {}
+
+  std::string text;
+  std::size_t column;
+};
 
 /**
- * Container of Lines that resembles a block in a SLHA structure.
- * This class is a named container of Lines that resembles a block in
- * a SLHA structure. Unlike a block in a SLHA structure, a %Block can
- * contain any number of block definitions or it can be completely
- * empty.
+ * Random access iterator that presents a sequence of line_fields as
+ * a sequence of their texts.
+ */
+template<class Value, class FieldIterator>
+class field_iterator
+  : public boost::iterator_adaptor<field_iterator<Value, FieldIterator>,
+                                   FieldIterator, Value>
+{
+private:
+  typedef boost::iterator_adaptor<field_iterator<Value, FieldIterator>,
+                                  FieldIterator, Value> base_type;
+
+public:
+  field_iterator() : base_type() {}
+
+  explicit
+  field_iterator(const FieldIterator& it) : base_type(it) {}
+
+  template<class OtherValue, class OtherIterator>
+  field_iterator(const field_iterator<OtherValue, OtherIterator>& other,
+    typename boost::enable_if_convertible<OtherIterator,
+      FieldIterator>::type* = 0)
+    : base_type(other.base()) {}
+
+  // NOTE: iterator_adaptor's operator[] would return a proxy object
+  //   here, but callers expect a real reference as with the iterators
+  //   of std::vector.
+  typename base_type::reference
+  operator[](typename base_type::difference_type n) const
+  { return this->base_reference()[n].text; }
+
+private:
+  friend class boost::iterator_core_access;
+
+  typename base_type::reference
+  dereference() const
+  { return this->base_reference()->text; }
+};
+
+} // namespace detail
+
+
+// forward declarations
+class Line;
+class Block;
+class Coll;
+struct Key;
+class KeyHandle;
+template<class T> class Matrix;
+class BlockReader;
+class SpectrumReader;
+
+inline std::ostream& operator<<(std::ostream& os, const Line& line);
+inline bool operator==(const Line& a, const Line& b);
+inline std::ostream& operator<<(std::ostream& os, const Block& block);
+inline std::ostream& operator<<(std::ostream& os, const Coll& coll);
+inline std::ostream& operator<<(std::ostream& os, const Key& key);
+
+
+/**
+ * Container of strings that represents a line in a SLHA structure.
+ * This class is a container of strings that represents a line in a
+ * SLHA structure. The elements of a %Line are the so called fields of
+ * an ordinary SLHA line, which are its whitespace-separated
+ * substrings and the comment. For example, if a %Line is constructed
+ * from the string <tt>" 1 2 0.123 # a comment"</tt> its elements
+ * would be \c "1", \c "2", \c "0.123", and \c "# a comment".
+ * Array-style access to the elements with integer indices is provided
+ * by the operator[]() and at() functions. %Line also provides
+ * introspective functions to find out whether it is a comment or data
+ * line for example. Introspective functions that check if an element
+ * is a block specifier (\c "BLOCK" or \c "DECAY") always perform
+ * case-insensitive comparisons.
  *
- * Access to the elements of the %Block is provided by the
- * operator[]() and at() functions. These take one or more strings
- * resp. ints as argument(s) and compare them against the first
- * strings of the contained Lines (the ints are converted to strings
- * before comparison). The first Line that matches the provided
- * arguments is then returned, or if no matching Line is found, an
- * empty Line is appended to the %Block (operator[]()) or
- * \c std::out_of_range is thrown (at()). The special argument
- * \c "(any)" will be considered equal to all strings in the Lines.
- * For example, <tt>at("(any)", "2")</tt> returns the first Line whose
- * second element is \c "2".
+ * In addition to storing the fields of a SLHA line, a %Line also
+ * stores its formatting (the exact position of the fields in the
+ * line). A formatted representation of a %Line can be produced with
+ * str() const. The reformat() function clears the previous formatting
+ * and indents all elements with an appropriate number of spaces.
+ *
+ * A %Line that was read with Coll::read_verbatim also keeps its
+ * original text, which str() const and write_to() return unchanged
+ * until the %Line is modified. All functions that give write access
+ * to the fields discard the original text, even if the fields are
+ * only read through the returned references. The comparison operators
+ * ignore the original text and compare the fields and their
+ * formatting.
  */
-class Block
+class Line
 {
 private:
-  typedef std::vector<Line> impl_type;
+  typedef std::vector<detail::line_field> impl_type;
 
 public:
-  typedef std::vector<std::string>          key_type;
-  typedef Line                              value_type;
-  typedef Line&                             reference;
-  typedef const Line&                       const_reference;
-  typedef impl_type::iterator               iterator;
-  typedef impl_type::const_iterator         const_iterator;
-  typedef impl_type::reverse_iterator       reverse_iterator;
-  typedef impl_type::const_reverse_iterator const_reverse_iterator;
-  typedef impl_type::pointer                pointer;
-  typedef impl_type::const_pointer          const_pointer;
+  typedef std::string                       value_type;
+  typedef std::string&                      reference;
+  typedef const std::string&                const_reference;
+  typedef detail::field_iterator<value_type,
+            impl_type::iterator>            iterator;
+  typedef detail::field_iterator<const value_type,
+            impl_type::const_iterator>      const_iterator;
+  typedef std::reverse_iterator<iterator>   reverse_iterator;
+  typedef std::reverse_iterator<const_iterator>
+                                            const_reverse_iterator;
+  typedef std::string*                      pointer;
+  typedef const std::string*                const_pointer;
   typedef impl_type::difference_type        difference_type;
   typedef impl_type::size_type              size_type;
 
@@ -750,1783 +1723,5266 @@ public:
   //   operator for this class are just fine, so we don't need to
   //   write our own.
 
-  /**
-   * \brief Constructs an empty %Block.
-   * \param name Name of the %Block.
-   */
-  explicit
-  Block(const std::string& name = "") : name_(name), impl_() {}
+  /** Constructs an empty %Line. */
+  Line()
+    : impl_(), extras_(), data_size_(0), kind_(empty_line),
+      format_(number_format::digits10()) {}
 
   /**
-   * \brief Constructs a %Block with content from an input stream.
-   * \param is Input stream to read content from.
-   * \sa read()
+   * \brief Constructs a %Line from a string.
+   * \param line String whose fields are used as content of the %Line.
+   * \sa str()
    */
-  explicit
-  Block(std::istream& is) : name_(), impl_()
-  { read(is); }
+  Line(const std::string& line)
+    : impl_(), extras_(), data_size_(0), kind_(empty_line),
+      format_(number_format::digits10())
+  { str(line); }
 
   /**
-   * \brief Constructs a %Block with content from a string.
-   * \param block String to read content from.
+   * \brief Assigns content from a string to the %Line.
+   * \param line String whose fields are used as content of the %Line.
+   * \return Reference to \c *this.
+   *
+   * This function is an alias for str().
    */
-  static Block
-  from_str(const std::string& block)
+  Line&
+  operator=(const std::string& line)
   {
-    std::istringstream input(block);
-    return Block(input);
+    str(line);
+    return *this;
   }
 
   /**
-   * \brief Sets the name of the %Block.
-   * \param newName New name of the %Block.
+   * \brief Appends a string to the end of the %Line.
+   * \param arg String that is appended to the %Line.
+   * \return Reference to \c *this.
    *
-   * Notice that this function only changes a property of the %Block.
-   * No contained Line (in particular no block definition) is changed.
+   * This function is an alias for append().
    */
-  void
-  name(const std::string& newName)
-  { name_ = newName; }
-
-  /** Returns the name of the %Block. */
-  const std::string&
-  name() const
-  { return name_; }
+  Line&
+  operator+=(const std::string& arg)
+  {
+    append(arg);
+    return *this;
+  }
 
   /**
-   * \brief Changes the name and definition of the %Block.
-   * \param newName New name of the %Block.
+   * \brief Inserts an element at the end of the %Line.
+   * \param field Element that is inserted at the end of the %Line.
+   * \return Reference to \c *this.
    *
-   * In contrast to name() this function changes the name of the
-   * %Block and its first block definition (if it exists).
+   * This function inserts an element at the end of the %Line. If the
+   * the %Line contains a comment, \p field is only appended to the
+   * last element and thus size() remains unchanged.
    */
-  void
-  rename(const std::string& newName)
+  template<class T> Line&
+  operator<<(const T& field)
   {
-    name(newName);
-    iterator block_def = find_block_def();
-    if (block_def != end()) (*block_def)[1] = newName;
+    return insert(field,
+      detail::number_tag<detail::number_kind<T>::value>());
   }
 
   /**
-   * \brief Assigns content from an input stream to the %Block.
-   * \param is Input stream to read content from.
+   * \brief Selects the format of floating-point numbers.
+   * \param format Format of the floating-point numbers that are
+   *   inserted into the %Line afterwards.
    * \return Reference to \c *this.
    *
-   * This function reads non-empty lines from \p is, transforms them
-   * into Lines and adds them to the end of the %Block. Lines from
-   * \p is are read until the second block definition is encountered
-   * or until the end of the stream, whatever comes first. If \p is
-   * contains a block definition and the current name of the %Block is
-   * empty, it is changed accordingly.
+   * The format is kept by clear() and str() and copied with the
+   * %Line.
    */
-  Block&
-  read(std::istream& is)
+  Line&
+  operator<<(const number_format& format)
   {
-    std::string line_str;
-    value_type line;
-
-    std::size_t def_count = 0;
-    bool nameless = name().empty();
+    format_ = format;
+    return *this;
+  }
 
-    while (std::getline(is, line_str))
-    {
-      if (detail::is_all_whitespace(line_str)) continue;
-
-      line.str(line_str);
-      if (line.is_block_def())
-      {
-        if (++def_count > 1)
-        {
-          is.seekg(-static_cast<std::ptrdiff_t>(line_str.length() + 1), std::ios_base::cur);
-          break;
-        }
-        if (nameless)
-        {
-          name(line[1]);
-          nameless = false;
-        }
-      }
-      push_back(line);
-    }
-    return *this;
-  }
+  /**
+   * Returns the format of the floating-point numbers that are
+   * inserted into the %Line.
+   */
+  number_format
+  format() const
+  { return format_; }
 
   /**
-   * \brief Assigns content from a string to the %Block.
-   * \param block String that is used as content for the %Block.
+   * \brief Appends a string to the end of the %Line.
+   * \param arg String that is appended to the %Line.
    * \return Reference to \c *this.
    *
-   * This function clears the name and content of the %Block and adds
-   * every non-empty line found in \p block as Line to the end of the
-   * %Block. If \p block contains a block definition, the name of the
-   * %Block is set accordingly. If \p block contains more than two
-   * block definitions, only the lines before the second block
-   * definition are added to the %Block.
+   * This function appends \p arg to the output of str() const and
+   * uses this temporary string as input for str(). Based on the
+   * temporary string, size() is increased or remains unchanged.
    */
-  Block&
-  str(const std::string& block)
+  Line&
+  append(const std::string& arg)
   {
-    std::istringstream input(block);
-    clear();
-    read(input);
+    str(str() + arg);
     return *this;
   }
 
-  /** Returns a string representation of the %Block. */
-  std::string
-  str() const
-  {
-    std::ostringstream output;
-    output << *this;
-    return output.str();
-  }
-
-  // element access
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key First strings of the Line to be located.
-   * \return Read/write reference to sought-after Line.
+   * \brief Assigns content to the %Line based on a string.
+   * \param line String whose fields are used as content of the %Line.
+   * \return Reference to \c *this.
    *
-   * This function takes a key (which is a vector of strings) and
-   * locates the Line whose first strings are equal to the strings in
-   * \p key. If no such Line exists, this function creates an empty
-   * Line at the end of the %Block and returns a reference to it.
-   */
-  reference
-  operator[](const key_type& key)
-  {
-    iterator line = find(key);
-    if (line != end()) return *line;
-
-    push_back(value_type());
-    return back();
-  }
-
-  /**
-   * \brief Locates a Line in the %Block.
-   * \param key Integers that are used to locate the Line.
-   * \return Read/write reference to sought-after Line.
+   * This function parses \p line and sets the found fields as content
+   * of the %Line. If \p line contains newlines, everything after the
+   * first newline is ignored.
    *
-   * This function takes a key (which is a vector of ints) and locates
-   * the Line whose first strings are equal to the to strings
-   * converted ints in \p key. If no such Line exists, this function
-   * creates an empty Line at the end of the %Block and returns a
-   * reference to it.
+   * The exact formatting of \p line is stored internally and can be
+   * reproduced with str() const.
    */
-  reference
-  operator[](const std::vector<int>& key)
-  { return (*this)[cont_to_key(key)]; }
+  Line&
+  str(const std::string& line)
+  { return str(line.data(), line.data() + line.length()); }
 
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key String that is used to locate the Line.
-   * \return Read/write reference to sought-after Line.
+   * \brief Assigns content to the %Line based on a character range.
+   * \param first, last Pointers to the initial and final positions
+   *   of the characters that are parsed.
+   * \return Reference to \c *this.
    *
-   * This function locates the Line whose first string is equal to
-   * \p key. If no such Line exists, this function creates an empty
-   * Line at the end of the %Block and returns a reference to it.
+   * This function is equivalent to str(const std::string&) but parses
+   * a caller-provided buffer directly. The range is scanned once and
+   * the fields are copied straight into the %Line, reusing the
+   * storage of its previous elements where possible.
    */
-  reference
-  operator[](const std::string& key)
-  { return (*this)[key_type(1, key)]; }
+  Line&
+  str(const char* first, const char* last)
+  {
+    detail::char_scanner scanner(first, last);
+    parse(scanner, first);
+    return *this;
+  }
 
-  /**
-   * \brief Locates a Line in the %Block.
-   * \param key Integer that is used to locate the Line.
-   * \return Read/write reference to sought-after Line.
-   *
-   * This function locates the Line whose first string is equal to the
-   * to string converted \p key. If no such Line exists, this function
-   * creates an empty Line at the end of the %Block and returns a
-   * reference to it.
-   */
-  reference
-  operator[](int key)
-  { return (*this)[key_type(1, to_string(key))]; }
+  /** Returns a formatted string representation of the %Line. */
+  std::string
+  str() const
+  {
+    std::string result;
+    if (!empty())
+    {
+      result.reserve(impl_.back().column + impl_.back().text.length() +
+                     impl_.size());
+    }
+    write_to(result);
+    return result;
+  }
 
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key First strings of the Line to be located.
-   * \return Read/write reference to sought-after Line.
-   * \throw std::out_of_range If \p key does not match any Line.
-   *
-   * This function takes a key (which is a vector of strings) and
-   * locates the Line whose first strings are equal to the strings in
-   * \p key. If no such Line exists, \c std::out_of_range is thrown.
+   * \brief Appends the formatted string representation of the %Line
+   *   to a string.
+   * \param str String to which the %Line is appended.
+   * \return Reference to \p str.
    */
-  reference
-  at(const key_type& key)
-  {
-    iterator line = find(key);
-    if (line != end()) return *line;
-
-    throw std::out_of_range(
-      "SLHAea::Block::at(‘" + boost::join(key, ",") + "’)");
-  }
+  std::string&
+  append_to(std::string& str) const
+  { return write_to(str); }
 
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key First strings of the Line to be located.
-   * \return Read-only (constant) reference to sought-after Line.
-   * \throw std::out_of_range If \p key does not match any Line.
+   * \brief Writes the formatted string representation of the %Line
+   *   to a sink.
+   * \param sink Object with a member function
+   *   <tt>append(const char*, std::size_t)</tt> (like std::string)
+   *   that the characters are passed to.
+   * \return Reference to \p sink.
    *
-   * This function takes a key (which is a vector of strings) and
-   * locates the Line whose first strings are equal to the strings in
-   * \p key. If no such Line exists, \c std::out_of_range is thrown.
-   */
-  const_reference
-  at(const key_type& key) const
+   * The characters are the same as those of str() const. Every field
+   * is written at its column if the previous fields leave room for it
+   * and one space after the previous field otherwise. An unmodified
+   * %Line that was read with Coll::read_verbatim is written as it was
+   * read.
+   */
+  template<class Sink> Sink&
+  write_to(Sink& sink) const
   {
-    const_iterator line = find(key);
-    if (line != end()) return *line;
-
-    throw std::out_of_range(
-      "SLHAea::Block::at(‘" + boost::join(key, ",") + "’)");
+    if (extras_.has_source())
+    {
+      sink.append(extras_.source_data(), extras_.source_size());
+      return sink;
+    }
+    return write_formatted(sink);
   }
 
+  // element access
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key Integers that are used to locate the Line.
-   * \return Read/write reference to sought-after Line.
-   * \throw std::out_of_range If \p key does not match any Line.
+   * \brief Subscript access to the strings contained in the %Line.
+   * \param n Index of the string which should be accessed.
+   * \return Read/write reference to the accessed string.
    *
-   * This function takes a vector of ints and locates the Line whose
-   * first strings are equal to the to strings converted ints in
-   * \p key. If no such Line exists, \c std::out_of_range is thrown.
+   * This operator allows for easy, array-style, data access. Note
+   * that data access with this operator is unchecked and out_of_range
+   * lookups are not defined. (For checked lookups see at().)
    */
   reference
-  at(const std::vector<int>& key)
-  { return at(cont_to_key(key)); }
+  operator[](size_type n)
+  {
+    kind_ = unknown_line;
+    extras_.invalidate_value(n);
+    extras_.clear_source();
+    return impl_[n].text;
+  }
 
   /**
-   * \brief Locates a Line in the %Block.
-   * \param key Integers that are used to locate the Line.
-   * \return Read-only (constant) reference to sought-after Line.
-   * \throw std::out_of_range If \p key does not match any Line.
+   * \brief Subscript access to the strings contained in the %Line.
+   * \param n Index of the string which should be accessed.
+   * \return Read-only (constant) reference to the accessed string.
    *
-   * This function takes a vector of ints and locates the Line whose
-   * first strings are equal to the to strings converted ints in
-   * \p key. If no such Line exists, \c std::out_of_range is thrown.
+   * This operator allows for easy, array-style, data access. Note
+   * that data access with this operator is unchecked and out_of_range
+   * lookups are not defined. (For checked lookups see at().)
    */
   const_reference
-  at(const std::vector<int>& key) const
-  { return at(cont_to_key(key)); }
+  operator[](size_type n) const
+  { return impl_[n].text; }
 
   /**
-   * \brief Locates a Line in the %Block.
-   * \param s0, s1, s2, s3, s4 First strings of the Line to be
-   *   located.
-   * \return Read/write reference to sought-after Line.
-   * \throw std::out_of_range If provided strings do not match any
-   *   Line.
-   *
-   * This function takes up to five strings and locates the Line whose
-   * first strings are equal to all provided non-empty strings. If no
-   * such Line exists, \c std::out_of_range is thrown.
+   * \brief Provides access to the strings contained in the %Line.
+   * \param n Index of the string which should be accessed.
+   * \return Read/write reference to the accessed string.
+   * \throw std::out_of_range If \p n is an invalid index.
    */
   reference
-  at(const std::string& s0,      const std::string& s1 = "",
-     const std::string& s2 = "", const std::string& s3 = "",
-     const std::string& s4 = "")
-  { return at(strings_to_key(s0, s1, s2, s3, s4)); }
+  at(size_type n)
+  {
+    kind_ = unknown_line;
+    extras_.invalidate_value(n);
+    extras_.clear_source();
+    return impl_.at(n).text;
+  }
 
   /**
-   * \brief Locates a Line in the %Block.
-   * \param s0, s1, s2, s3, s4 First strings of the Line to be
-   *   located.
-   * \return Read-only (constant) reference to sought-after Line.
-   * \throw std::out_of_range If provided strings do not match any
-   *   Line.
-   *
-   * This function takes up to five strings and locates the Line whose
-   * first strings are equal to all provided non-empty strings. If no
-   * such Line exists, \c std::out_of_range is thrown.
+   * \brief Provides access to the strings contained in the %Line.
+   * \param n Index of the string which should be accessed.
+   * \return Read-only (constant) reference to the accessed string.
+   * \throw std::out_of_range If \p n is an invalid index.
    */
   const_reference
-  at(const std::string& s0,      const std::string& s1 = "",
-     const std::string& s2 = "", const std::string& s3 = "",
-     const std::string& s4 = "") const
-  { return at(strings_to_key(s0, s1, s2, s3, s4)); }
+  at(size_type n) const
+  { return impl_.at(n).text; }
 
   /**
-   * \brief Locates a Line in the %Block.
-   * \param i0, i1, i2, i3, i4 Integers that are used to locate the
-   *   Line.
-   * \return Read/write reference to sought-after Line.
-   * \throw std::out_of_range If provided ints do not match any
-   *   Line.
+   * \brief Converts a string contained in the %Line to another type.
+   * \param n Index of the string which should be converted.
+   * \return The string converted to \p T with to<T>().
+   * \throw std::out_of_range If \p n is an invalid index.
+   * \throw boost::bad_lexical_cast If the string cannot be converted
+   *   to \p T.
    *
-   * This function takes up to five ints and locates the Line whose
-   * first strings are equal to all provided to string converted ints.
-   * If no such Line exists, \c std::out_of_range is thrown.
-   */
-  reference
-  at(int i0, int i1 = no_index_, int i2 = no_index_,
-             int i3 = no_index_, int i4 = no_index_)
-  { return at(ints_to_key(i0, i1, i2, i3, i4)); }
-
-  /**
-   * \brief Locates a Line in the %Block.
-   * \param i0, i1, i2, i3, i4 Integers that are used to locate the
-   *   Line.
-   * \return Read-only (constant) reference to sought-after Line.
-   * \throw std::out_of_range If provided ints do not match any Line.
+   * Conversions to \c double are cached, so that the string is only
+   * converted once. The cached value is discarded by all functions
+   * that give write access to the string.
    *
-   * This function takes up to five ints and locates the Line whose
-   * first strings are equal to all provided to string converted ints.
-   * If no such Line exists, \c std::out_of_range is thrown.
+   * Storing the value modifies the %Line also if it is const. The
+   * same %Line must therefore not be converted to \c double with this
+   * function from several threads at the same time. Use
+   * to<double>(line[n]), which does not cache, for concurrent reads.
    */
-  const_reference
-  at(int i0, int i1 = no_index_, int i2 = no_index_,
-             int i3 = no_index_, int i4 = no_index_) const
-  { return at(ints_to_key(i0, i1, i2, i3, i4)); }
+  template<class T> T
+  as(size_type n) const
+  { return to<T>(at(n)); }
 
   /**
-   * Returns a read/write reference to the first element of the
-   * %Block.
+   * Returns a read/write reference to the first element of the %Line.
    */
   reference
   front()
-  { return impl_.front(); }
+  {
+    kind_ = unknown_line;
+    extras_.invalidate_value(0);
+    extras_.clear_source();
+    return impl_.front().text;
+  }
 
   /**
    * Returns a read-only (constant) reference to the first element of
-   * the %Block.
+   * the %Line.
    */
   const_reference
   front() const
-  { return impl_.front(); }
+  { return impl_.front().text; }
 
   /**
-   * Returns a read/write reference to the last element of the %Block.
+   * Returns a read/write reference to the last element of the %Line.
    */
   reference
   back()
-  { return impl_.back(); }
+  {
+    kind_ = unknown_line;
+    extras_.invalidate_value(size() - 1);
+    extras_.clear_source();
+    return impl_.back().text;
+  }
 
   /**
    * Returns a read-only (constant) reference to the last element of
-   * the %Block.
+   * the %Line.
    */
   const_reference
   back() const
-  { return impl_.back(); }
+  { return impl_.back().text; }
 
   // iterators
   /**
    * Returns a read/write iterator that points to the first element in
-   * the %Block. Iteration is done in ordinary element order.
+   * the %Line. Iteration is done in ordinary element order.
    */
   iterator
   begin()
-  { return impl_.begin(); }
+  {
+    kind_ = unknown_line;
+    extras_.clear_values();
+    extras_.clear_source();
+    return iterator(impl_.begin());
+  }
 
   /**
    * Returns a read-only (constant) iterator that points to the first
-   * element in the %Block. Iteration is done in ordinary element
+   * element in the %Line. Iteration is done in ordinary element
    * order.
    */
   const_iterator
   begin() const
-  { return impl_.begin(); }
+  { return const_iterator(impl_.begin()); }
 
   /**
    * Returns a read-only (constant) iterator that points to the first
-   * element in the %Block. Iteration is done in ordinary element
+   * element in the %Line. Iteration is done in ordinary element
    * order.
    */
   const_iterator
   cbegin() const
-  { return impl_.begin(); }
+  { return const_iterator(impl_.begin()); }
 
   /**
    * Returns a read/write iterator that points one past the last
-   * element in the %Block. Iteration is done in ordinary element
+   * element in the %Line. Iteration is done in ordinary element
    * order.
    */
   iterator
   end()
-  { return impl_.end(); }
+  {
+    kind_ = unknown_line;
+    extras_.clear_values();
+    extras_.clear_source();
+    return iterator(impl_.end());
+  }
 
   /**
    * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Block. Iteration is done in ordinary element
+   * last element in the %Line. Iteration is done in ordinary element
    * order.
    */
   const_iterator
   end() const
-  { return impl_.end(); }
+  { return const_iterator(impl_.end()); }
 
   /**
    * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Block. Iteration is done in ordinary element
+   * last element in the %Line. Iteration is done in ordinary element
    * order.
    */
   const_iterator
   cend() const
-  { return impl_.end(); }
+  { return const_iterator(impl_.end()); }
 
   /**
    * Returns a read/write reverse iterator that points to the last
-   * element in the %Block. Iteration is done in reverse element
-   * order.
+   * element in the %Line. Iteration is done in reverse element order.
    */
   reverse_iterator
   rbegin()
-  { return impl_.rbegin(); }
+  { return reverse_iterator(end()); }
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Block. Iteration is done in reverse
+   * the last element in the %Line. Iteration is done in reverse
    * element order.
    */
   const_reverse_iterator
   rbegin() const
-  { return impl_.rbegin(); }
+  { return const_reverse_iterator(end()); }
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Block. Iteration is done in reverse
+   * the last element in the %Line. Iteration is done in reverse
    * element order.
    */
   const_reverse_iterator
   crbegin() const
-  { return impl_.rbegin(); }
+  { return const_reverse_iterator(end()); }
 
   /**
    * Returns a read/write reverse iterator that points to one before
-   * the first element in the %Block. Iteration is done in reverse
+   * the first element in the %Line. Iteration is done in reverse
    * element order.
    */
   reverse_iterator
   rend()
-  { return impl_.rend(); }
+  { return reverse_iterator(begin()); }
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Block. Iteration is done
-   * in reverse element order.
+   * one before the first element in the %Line. Iteration is done in
+   * reverse element order.
    */
   const_reverse_iterator
   rend() const
-  { return impl_.rend(); }
+  { return const_reverse_iterator(begin()); }
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Block. Iteration is done
-   * in reverse element order.
+   * one before the first element in the %Line. Iteration is done in
+   * reverse element order.
    */
   const_reverse_iterator
   crend() const
-  { return impl_.rend(); }
-
-  // lookup
-  /**
-   * \brief Tries to locate a Line in the %Block.
-   * \param key First strings of the Line to be located.
-   * \return Read/write iterator pointing to sought-after element, or
-   *   end() if not found.
-   *
-   * This function takes a key (which is a vector of strings) and
-   * tries to locate the Line whose first strings are equal to the
-   * strings in \p key. If successful the function returns a
-   * read/write iterator pointing to the sought after Line. If
-   * unsuccessful it returns end().
-   */
-  iterator
-  find(const key_type& key)
-  { return std::find_if(begin(), end(), key_matches(key)); }
-
-  /**
-   * \brief Tries to locate a Line in the %Block.
-   * \param key First strings of the Line to be located.
-   * \return Read-only (constant) iterator pointing to sought-after
-   *   element, or end() const if not found.
-   *
-   * This function takes a key (which is a vector of strings) and
-   * tries to locate the Line whose first strings are equal to the
-   * strings in \p key. If successful the function returns a read-only
-   * (constant) iterator pointing to the sought after Line. If
-   * unsuccessful it returns end() const.
-   */
-  const_iterator
-  find(const key_type& key) const
-  { return std::find_if(begin(), end(), key_matches(key)); }
-
-  /**
-   * \brief Tries to locate a Line in a range.
-   * \param first, last Input iterators to the initial and final
-   *   positions in a sequence.
-   * \param key First strings of the Line to be located.
-   * \return Iterator pointing to sought-after element, or \p last if
-   *   not found.
-   *
-   * This function tries to locate in the range [\p first, \p last)
-   * the Line whose first strings are equal to the strings in \p key.
-   * If successful the function returns an iterator pointing to the
-   * sought after Line. If unsuccessful it returns \p last.
-   */
-  template<class InputIterator> static InputIterator
-  find(InputIterator first, InputIterator last, const key_type& key)
-  { return std::find_if(first, last, key_matches(key)); }
+  { return const_reverse_iterator(begin()); }
 
+  // introspection
   /**
-   * Returns a read/write iterator that points to the first Line in
-   * the %Block which is a block definition. If the %Block does not
-   * contain a block definition, end() is returned.
+   * Returns true if the %Line begins with \c "BLOCK" or \c "DECAY"
+   * followed by a block name.
    */
-  iterator
-  find_block_def()
-  {
-    return std::find_if(begin(), end(),
-      MEM_FN(&value_type::is_block_def));
-  }
+  bool
+  is_block_def() const
+  { return kind() == block_def_line; }
 
-  /**
-   * Returns a read-only (constant) iterator that points to the first
-   * Line in the %Block which is a block definition. If the %Block
-   * does not contain a block definition, end() const is returned.
-   */
-  const_iterator
-  find_block_def() const
-  {
-    return std::find_if(begin(), end(),
-      MEM_FN(&value_type::is_block_def));
-  }
+  /** Returns true if the %Line begins with \c "#". */
+  bool
+  is_comment_line() const
+  { return kind() == comment_line; }
 
-  // introspection
   /**
-   * \brief Counts all Lines that match a given key.
-   * \param key First strings of the Lines that will be counted.
-   * \return Number of lines whose first strings equal \p key.
+   * Returns true if the %Line is not empty and if it does not begin
+   * with \c "#", \c "BLOCK" or \c "DECAY".
    */
-  size_type
-  count(const key_type& key) const
-  { return std::count_if(begin(), end(), key_matches(key)); }
+  bool
+  is_data_line() const
+  { return kind() == data_line; }
 
   // capacity
-  /** Returns the number of elements in the %Block. */
+  /** Returns the number of elements in the %Line. */
   size_type
   size() const
   { return impl_.size(); }
 
-  /** Returns the number of data Lines in the %Block. */
+  /**
+   * Returns the number of elements without the comment in the %Line.
+   */
   size_type
   data_size() const
   {
-    return std::count_if(begin(), end(),
-      MEM_FN(&value_type::is_data_line));
+    if (kind_ != unknown_line) return data_size_;
+    boost::uint32_t data_size = 0;
+    compute_kind(data_size);
+    return data_size;
   }
 
-  /** Returns the size() of the largest possible %Block. */
+  /** Returns the size() of the largest possible %Line. */
   size_type
   max_size() const
   { return impl_.max_size(); }
 
-  /** Returns true if the %Block is empty. */
+  /** Returns true if the %Line is empty. */
   bool
   empty() const
   { return impl_.empty(); }
 
   // modifiers
   /**
-   * \brief Adds a Line to the end of the %Block.
-   * \param line Line to be added.
-   *
-   * This function creates an element at the end of the %Block and
-   * assigns the given \p line to it.
+   * \brief Swaps data with another %Line.
+   * \param line %Line to be swapped with.
    */
   void
-  push_back(const value_type& line)
-  { impl_.push_back(line); }
+  swap(Line& line)
+  {
+    impl_.swap(line.impl_);
+    extras_.swap(line.extras_);
+    std::swap(data_size_, line.data_size_);
+    std::swap(kind_, line.kind_);
+    std::swap(format_, line.format_);
+  }
+
+  /** Erases all the elements in the %Line. */
+  void
+  clear()
+  {
+    impl_.clear();
+    extras_.clear_values();
+    extras_.clear_source();
+    classify();
+  }
+
+  /** Reformats the string representation of the %Line. */
+  void
+  reformat()
+  {
+    extras_.clear_source();
+    if (empty()) return;
+
+    impl_type::iterator field = impl_.begin();
+    std::size_t pos1 = 0, pos2 = 0;
+
+    if (is_block_specifier(field->text))
+    {
+      pos1 = 0;
+      pos2 = pos1 + field->text.length();
+      field->column = pos1;
+
+      if (++field == impl_.end()) return;
+
+      pos1 = pos2 + 1;
+      pos2 = pos1 + field->text.length();
+      field->column = pos1;
+    }
+    else if (is_comment(field->text))
+    {
+      pos1 = 0;
+      pos2 = pos1 + field->text.length();
+      field->column = pos1;
+    }
+    else
+    {
+      pos1 = shift_width_;
+      pos2 = pos1 + field->text.length();
+      field->column = pos1;
+    }
+
+    while (++field != impl_.end())
+    {
+      pos1 = pos2 + calc_spaces_for_indent(pos2);
+      if (starts_with_sign(field->text)) --pos1;
+      pos2 = pos1 + field->text.length();
+      field->column = pos1;
+    }
+  }
 
   /**
-   * \brief Adds a Line to the end of the %Block.
-   * \param line String that is used to construct the Line that will
-   *   be added.
-   *
-   * This function creates an element at the end of the %Block and
-   * assigns the Line that is constructed from \p line to it.
+   * Comments the %Line. This function prefixes the %Line with a
+   * \c "#" and packetizes all its elements into one.
    */
   void
-  push_back(const std::string& line)
-  { impl_.push_back(value_type(line)); }
+  comment()
+  { if (!empty()) str("#" + str()); }
 
   /**
-   * Removes the last element. This function shrinks the size() of the
-   * %Block by one.
+   * Uncomments the %Line. This function removes the first character
+   * of the %Line if it is a \c "#" and splits the former comment into
+   * the corresponding number of fields.
    */
   void
-  pop_back()
-  { impl_.pop_back(); }
+  uncomment()
+  {
+    if (!empty() && is_comment(front()))
+    {
+      front().erase(0, 1);
+      str(str());
+    }
+  }
+
+private:
+  friend class Block;
+  friend class Coll;
+  friend class BlockReader;
+  friend bool operator==(const Line& a, const Line& b);
 
   /**
-   * \brief Inserts a Line before given \p position.
-   * \param position Iterator into the %Block.
-   * \param line Line to be inserted.
-   * \return Iterator pointing to the inserted element.
-   *
-   * This function inserts a copy of \p line before the specified
-   * \p position and thus enlarges the %Block by one.
+   * Assigns the fields of the line that starts at \p first to the
+   * %Line and returns the beginning of the next line (or the end of
+   * the buffer of \p scanner). If \p keep_source is true, the text of
+   * the line without the newline is kept as original text.
    */
-  iterator
-  insert(iterator position, const value_type& line)
-  { return impl_.insert(position, line); }
+  const char*
+  parse(detail::char_scanner& scanner, const char* first,
+        bool keep_source = false)
+  {
+    const char* pos = first;
+    const char* field_first = first;
+    const char* field_last = first;
+    size_type n = 0;
+
+    while (detail::next_field(scanner, pos, field_first, field_last))
+    {
+      const std::size_t column = static_cast<std::size_t>(field_first - first);
+      if (n < impl_.size())
+      {
+        impl_[n].text.assign(field_first, field_last);
+        impl_[n].column = column;
+      }
+      else
+      { impl_.push_back(detail::line_field(field_first, field_last, column)); }
+      ++n;
+    }
+
+    impl_.resize(n);
+    extras_.clear_values();
+    if (keep_source && n != 0) extras_.assign_source(first, pos);
+    else extras_.clear_source();
+    classify();
+    return (pos == scanner.last()) ? pos : pos + 1;
+  }
 
   /**
-   * \brief Inserts a range into the %Block.
-   * \param position Iterator into the %Block.
-   * \param first, last Input iterators to the initial and final
-   *   positions in a sequence.
-   *
-   * This function inserts copies of the Lines in the range
-   * [\p first, \p last) into the %Block before the specified
-   * \p position and thus enlarges the %Block accordingly.
+   * Writes the fields at their columns to \p sink, ignoring the
+   * original text.
    */
-  template<class InputIterator> void
-  insert(iterator position, InputIterator first, InputIterator last)
-  { impl_.insert(position, first, last); }
+  template<class Sink> Sink&
+  write_formatted(Sink& sink) const
+  {
+    std::size_t length = 0;
+    for (impl_type::const_iterator field = impl_.begin();
+         field != impl_.end(); ++field)
+    {
+      detail::append_spaces(sink, padding(field, length));
+      sink.append(field->text.data(), field->text.length());
+    }
+    return sink;
+  }
 
   /**
-   * \brief Erases element at given \p position.
-   * \param position Iterator pointing to the element to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function erases the element at the given \p position and
-   * thus shortens the %Block by one.
-   */
-  iterator
-  erase(iterator position)
-  { return impl_.erase(position); }
-
-  /**
-   * \brief Erases a range of elements.
-   * \param first Iterator pointing to the first element to be erased.
-   * \param last Iterator pointing to one past the last element to be
-   *   erased.
-   * \return Iterator pointing to the element pointed to by \p last
-   *   prior to erasing (or end()).
-   *
-   * This function erases the elements in the range [\p first,
-   * \p last) and shortens the %Block accordingly.
+   * Returns the number of spaces that write_formatted() writes before
+   * \p field and advances \p length past it.
    */
-  iterator
-  erase(iterator first, iterator last)
-  { return impl_.erase(first, last); }
+  std::size_t
+  padding(impl_type::const_iterator field, std::size_t& length) const
+  {
+    // NOTE: Fields that do not fit at their column still get one
+    //   space, which is not counted in length. This is how the
+    //   formatting has always been computed.
+    const std::size_t spaces =
+      (field->column + 1 > length) ? field->column + 1 - length : 0;
+    length += spaces + field->text.length();
+    const std::size_t width = std::max<std::size_t>(spaces, 1);
+    return (field == impl_.begin()) ? width - 1 : width;
+  }
 
   /**
-   * \brief Erases first Line that matches the provided key.
-   * \param key First strings of the Line to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function takes a key (which is a vector of strings) and
-   * erases the first Line whose first strings are equal to the strings
-   * in \p key. If the %Block contains such Line, the function returns
-   * an iterator pointing to the next element (or end()). If no such
-   * Line exists, end() is returned.
+   * Returns true if write_formatted() writes the fields of the %Line
+   * and of \p line, which must have equal fields, at the same
+   * positions. Only the columns are compared, nothing is written.
    */
-  iterator
-  erase_first(const key_type& key)
+  bool
+  same_formatting(const Line& line) const
   {
-    iterator line = find(key);
-    return (line != end()) ? erase(line) : line;
+    std::size_t length = 0, other_length = 0;
+    for (impl_type::const_iterator field = impl_.begin(),
+           other = line.impl_.begin(); field != impl_.end(); ++field, ++other)
+    {
+      if (padding(field, length) != line.padding(other, other_length))
+      { return false; }
+    }
+    return true;
   }
 
   /**
-   * \brief Erases last Line that matches the provided key.
-   * \param key First strings of the Line to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function takes a key (which is a vector of strings) and
-   * erases the last Line whose first strings are equal to the strings
-   * in \p key. If the %Block contains such Line, the function returns
-   * an iterator pointing to the next element (or end()). If no such
-   * Line exists, end() is returned.
+   * Returns the name of a block definition without discarding the
+   * original text like operator[]() would.
    */
-  iterator
-  erase_last(const key_type& key)
+  const value_type&
+  block_name() const
+  { return impl_[1].text; }
+
+  // Kinds of Lines. unknown_line means that the Line may have been
+  // changed through a reference and must be classified again.
+  enum line_kind
   {
-    reverse_iterator line = find(rbegin(), rend(), key);
-    return (line != rend()) ? erase((++line).base()) : end();
-  }
+    unknown_line, empty_line, comment_line, block_def_line,
+    block_specifier_line, data_line
+  };
 
   /**
-   * \brief Erases all Lines that match the provided key.
-   * \param key First strings of the Lines to be erased.
-   * \return The number of Lines erased.
-   *
-   * This function takes a key (which is a vector of strings) and
-   * erases all Lines whose first strings are equal to the strings
-   * in \p key.
+   * Returns the kind of the %Line. If the %Line is unclassified, its
+   * kind is computed without storing it, so that const functions
+   * never write to the %Line.
    */
-  size_type
-  erase(const key_type& key)
+  line_kind
+  kind() const
   {
-    const key_matches pred(key);
-    size_type erased_count = 0;
-
-    for (iterator line = begin(); line != end();)
-    {
-      if (pred(*line))
-      {
-        line = erase(line);
-        ++erased_count;
-      }
-      else ++line;
-    }
-    return erased_count;
+    if (kind_ != unknown_line) return static_cast<line_kind>(kind_);
+    boost::uint32_t data_size = 0;
+    return compute_kind(data_size);
   }
 
-  /**
-   * \brief Swaps data with another %Block.
-   * \param block %Block to be swapped with.
-   */
+  /** Stores the kind and data size of the %Line. */
   void
-  swap(Block& block)
+  classify()
+  { kind_ = static_cast<boost::uint8_t>(compute_kind(data_size_)); }
+
+  line_kind
+  compute_kind(boost::uint32_t& data_size) const
   {
-    name_.swap(block.name_);
-    impl_.swap(block.impl_);
+    data_size = static_cast<boost::uint32_t>(std::distance(impl_.begin(),
+      std::find_if(impl_.begin(), impl_.end(), field_is_comment)));
+
+    if (empty()) return empty_line;
+    if (is_comment(impl_[0].text)) return comment_line;
+    if (!is_block_specifier(impl_[0].text)) return data_line;
+    if (size() >= 2 && !is_comment(impl_[1].text)) return block_def_line;
+    return block_specifier_line;
   }
 
-  /**
-   * Erases all the elements in the %Block and set its name to an
-   * empty string.
-   */
-  void
-  clear()
+  bool
+  contains_comment() const
+  { return data_size() != size(); }
+
+  static std::size_t
+  calc_spaces_for_indent(const std::size_t& pos)
   {
-    name_.clear();
-    impl_.clear();
+    std::size_t width = shift_width_ - (pos % shift_width_);
+    if (width < min_width_) width += shift_width_;
+    return width;
   }
 
-  /**
-   * \brief Reformats all Lines in the %Block.
-   * \sa Line::reformat()
-   */
-  void
-  reformat()
-  { std::for_each(begin(), end(), MEM_FN(&value_type::reformat)); }
+  static bool
+  is_block_specifier(const value_type& field)
+  {
+    return detail::is_block_specifier(field.data(),
+                                      field.data() + field.length());
+  }
 
-  /**
-   * \brief Comments all Lines in the %Block.
-   * \sa Line::comment()
-   */
-  void
-  comment()
-  { std::for_each(begin(), end(), MEM_FN(&value_type::comment)); }
+  static bool
+  is_comment(const value_type& field)
+  { return !field.empty() && field[0] == '#'; }
 
-  /**
-   * \brief Uncomments all Lines in the %Block.
-   * \sa Line::uncomment()
-   */
-  void
-  uncomment()
-  { std::for_each(begin(), end(), MEM_FN(&value_type::uncomment)); }
+  static bool
+  field_is_comment(const detail::line_field& field)
+  { return is_comment(field.text); }
 
-  /** Unary predicate that checks if a provided key matches a Line. */
-  struct key_matches
+  template<class T, int Kind> Line&
+  insert(const T& field, detail::number_tag<Kind>)
   {
-    explicit
-    key_matches(const key_type& key) : key_(key) {}
+    std::string field_str = to_string(field);
+    detail::trim_right(field_str);
+    if (field_str.empty()) return *this;
 
-    bool
-    operator()(const value_type& line) const
+    if (contains_comment())
+    { back() += field_str; }
+    else
     {
-      return (key_.empty() || key_.size() > line.size()) ? false :
-        std::equal(key_.begin(), key_.end(), line.begin(), parts_equal);
+      detail::trim_left(field_str);
+      impl_.push_back(detail::line_field(field_str));
+      classify();
+      reformat();
     }
+    return *this;
+  }
 
-    void
-    set_key(const key_type& key)
-    { key_ = key; }
-
-  private:
-    static bool
-    parts_equal(const std::string& key_part, const std::string& field)
-    { return (key_part == "(any)") || boost::iequals(key_part, field); }
-
-  private:
-    key_type key_;
-  };
-
-private:
-  template<class Container> static key_type
-  cont_to_key(const Container& cont)
+  template<class T> Line&
+  insert(const T& field, detail::number_tag<1>)
   {
-    key_type key;
-    key.reserve(cont.size());
-    std::string (*to_string)(const typename Container::value_type&) =
-      boost::lexical_cast<std::string, typename Container::value_type>;
-    std::transform(cont.begin(), cont.end(), std::back_inserter(key),
-      to_string);
-    return key;
+    char buffer[std::numeric_limits<T>::digits10 + 3];
+    return insert_chars(buffer,
+                        write_number(buffer, buffer + sizeof(buffer), field));
   }
 
-  static key_type
-  strings_to_key(const std::string& s0, const std::string& s1,
-                 const std::string& s2, const std::string& s3,
-                 const std::string& s4)
+  template<class T> Line&
+  insert_fundamental_type(const T& arg)
   {
-    key_type key;
-    key.reserve(5);
-    if (s0.empty()) { return key; } key.push_back(s0);
-    if (s1.empty()) { return key; } key.push_back(s1);
-    if (s2.empty()) { return key; } key.push_back(s2);
-    if (s3.empty()) { return key; } key.push_back(s3);
-    if (s4.empty()) { return key; } key.push_back(s4);
-    return key;
+    char buffer[64];
+    const char* last = format_.write(buffer, buffer + sizeof(buffer), arg);
+    if (last != 0) return insert_chars(buffer, last);
+
+    const std::string str = format_.str(arg);
+    return insert_chars(str.data(), str.data() + str.length());
   }
 
-  static key_type
-  ints_to_key(int i0, int i1, int i2, int i3, int i4)
+  /**
+   * Inserts the characters in [\p first, \p last), which must not
+   * contain blanks, like operator<<() without converting them to a
+   * string first.
+   */
+  Line&
+  insert_chars(const char* first, const char* last)
   {
-    key_type key;
-    key.reserve(5);
-    if (i0 == no_index_) { return key; } key.push_back(to_string(i0));
-    if (i1 == no_index_) { return key; } key.push_back(to_string(i1));
-    if (i2 == no_index_) { return key; } key.push_back(to_string(i2));
-    if (i3 == no_index_) { return key; } key.push_back(to_string(i3));
-    if (i4 == no_index_) { return key; } key.push_back(to_string(i4));
-    return key;
+    if (contains_comment())
+    { back().append(first, last); }
+    else
+    {
+      // Lines built with operator<<() usually get several fields.
+      if (impl_.capacity() == 0) impl_.reserve(4);
+      impl_.push_back(detail::line_field(first, last, 0));
+      classify();
+      reformat();
+    }
+    return *this;
   }
 
+  static bool
+  starts_with_sign(const value_type& field)
+  { return !field.empty() && (field[0] == '-' || field[0] == '+'); }
+
 private:
-  std::string name_;
   impl_type impl_;
-  static const int no_index_ = -32768;
+  // NOTE: The values returned by as<double>() are cached in extras_
+  //   and invalidated like the classification below, except that the
+  //   references and iterators in question are those obtained before
+  //   the last call of as<double>(). The original text in extras_ is
+  //   only set by parse() and is discarded by every function that
+  //   gives write access to the fields or changes their columns,
+  //   which is the dirty flag of the original text.
+  mutable detail::line_extras extras_;
+  // NOTE: The classification of the %Line is stored in data_size_ and
+  //   kind_ by parse() and the modifiers and reset by all functions
+  //   that give write access to the fields. An unclassified %Line is
+  //   classified again on every call of an introspective function, but
+  //   never stored there. It is not reset if fields are changed through
+  //   references or iterators that were obtained before the last
+  //   classification.
+  boost::uint32_t data_size_;
+  boost::uint8_t kind_;
+  number_format format_;
+
+  static const std::size_t shift_width_ = 4;
+  static const std::size_t min_width_   = 2;
 };
 
+template<> inline Line&
+Line::operator<< <float>(const float& number)
+{
+  insert_fundamental_type(number);
+  return *this;
+}
 
-/**
- * Container of Blocks that resembles a complete SLHA structure.
- * This class is a container of Blocks that resembles a complete SLHA
- * structure. Its name is an abbreviation of "collection" since it is
- * a collection of Blocks. The elements of %Coll objects can be
- * accessed via their names (which are always compared
- * case-insensitive) with the operator[]() and at() functions and
- * access to single fields, Lines and Blocks via the Key type is
- * provided by the field(), line() and block() functions. To fill this
- * container, the functions read() or str() can be used which read
- * data from an input stream or a string, respectively.
- */
-class Coll
+template<> inline Line&
+Line::operator<< <double>(const double& number)
 {
-private:
-  typedef std::deque<Block> impl_type;
+  insert_fundamental_type(number);
+  return *this;
+}
 
-public:
-  typedef std::string                       key_type;
-  typedef Block                             value_type;
-  typedef Block&                            reference;
-  typedef const Block&                      const_reference;
-  typedef impl_type::iterator               iterator;
-  typedef impl_type::const_iterator         const_iterator;
-  typedef impl_type::reverse_iterator       reverse_iterator;
-  typedef impl_type::const_reverse_iterator const_reverse_iterator;
-  typedef impl_type::pointer                pointer;
-  typedef impl_type::const_pointer          const_pointer;
-  typedef impl_type::difference_type        difference_type;
-  typedef impl_type::size_type              size_type;
+template<> inline Line&
+Line::operator<< <long double>(const long double& number)
+{
+  insert_fundamental_type(number);
+  return *this;
+}
 
-  // NOTE: The compiler-generated copy constructor and assignment
-  //   operator for this class are just fine, so we don't need to
-  //   write our own.
+template<> inline double
+Line::as<double>(size_type n) const
+{
+  if (const double* cached = extras_.find_value(n)) return *cached;
+  const double value = to<double>(at(n));
+  extras_.store_value(n, value);
+  return value;
+}
 
-  /** Constructs an empty %Coll. */
-  Coll() : impl_() {}
+
+/**
+ * Container of Lines that resembles a block in a SLHA structure.
+ * This class is a named container of Lines that resembles a block in
+ * a SLHA structure. Unlike a block in a SLHA structure, a %Block can
+ * contain any number of block definitions or it can be completely
+ * empty.
+ *
+ * Access to the elements of the %Block is provided by the
+ * operator[]() and at() functions. These take one or more strings
+ * resp. ints as argument(s) and compare them against the first
+ * strings of the contained Lines (the ints are converted to strings
+ * before comparison). The first Line that matches the provided
+ * arguments is then returned, or if no matching Line is found, an
+ * empty Line is appended to the %Block (operator[]()) or
+ * \c std::out_of_range is thrown (at()). The special argument
+ * \c "(any)" will be considered equal to all strings in the Lines.
+ * For example, <tt>at("(any)", "2")</tt> returns the first Line whose
+ * second element is \c "2".
+ *
+ * A %Block that was read with Coll::read_lazy parses its Lines on the
+ * first access, also if it is accessed through a const reference.
+ * Such a %Block must therefore not be read from several threads at
+ * the same time before it has been accessed once.
+ */
+class Block
+{
+private:
+  typedef std::vector<Line> impl_type;
+
+public:
+  typedef std::vector<std::string>          key_type;
+  typedef Line                              value_type;
+  typedef Line&                             reference;
+  typedef const Line&                       const_reference;
+  typedef impl_type::iterator               iterator;
+  typedef impl_type::const_iterator         const_iterator;
+  typedef impl_type::reverse_iterator       reverse_iterator;
+  typedef impl_type::const_reverse_iterator const_reverse_iterator;
+  typedef impl_type::pointer                pointer;
+  typedef impl_type::const_pointer          const_pointer;
+  typedef impl_type::difference_type        difference_type;
+  typedef impl_type::size_type              size_type;
+
+  class key_pattern;
+
+  /** Storage schemes of the matrices returned by as_matrix(). */
+  enum matrix_storage
+  {
+    /** Elements without a data Line are zero. */
+    general_matrix,
+
+    /**
+     * Elements without a data Line equal the transposed element, so
+     * that only the upper (or lower) triangle needs to be stored.
+     */
+    symmetric_matrix
+  };
+
+  // NOTE: The compiler-generated copy constructor and assignment
+  //   operator for this class are just fine, so we don't need to
+  //   write our own.
 
   /**
-   * \brief Constructs a %Coll with content from an input stream.
+   * \brief Constructs an empty %Block.
+   * \param name Name of the %Block.
+   */
+  explicit
+  Block(const std::string& name = "")
+    : name_(name), impl_(), source_(), source_first_(0), source_last_(0),
+      verbatim_(false), index_(), indexed_lines_(0), use_index_(false),
+      generation_() {}
+
+  /**
+   * \brief Constructs a %Block with content from an input stream.
    * \param is Input stream to read content from.
    * \sa read()
    */
   explicit
-  Coll(std::istream& is) : impl_()
+  Block(std::istream& is)
+    : name_(), impl_(), source_(), source_first_(0), source_last_(0),
+      verbatim_(false), index_(), indexed_lines_(0), use_index_(false),
+      generation_()
   { read(is); }
 
   /**
-   * \brief Constructs a %Coll with content from a string.
-   * \param coll String to read content from.
+   * \brief Constructs a %Block with content from a string.
+   * \param block String to read content from.
    */
-  static Coll
-  from_str(const std::string& coll)
+  static Block
+  from_str(const std::string& block)
   {
-    std::istringstream input(coll);
-    return Coll(input);
+    Block result;
+    result.read(block.data(), block.data() + block.length());
+    return result;
   }
 
   /**
-   * \brief Assigns content from an input stream to the %Coll.
+   * \brief Sets the name of the %Block.
+   * \param newName New name of the %Block.
+   *
+   * Notice that this function only changes a property of the %Block.
+   * No contained Line (in particular no block definition) is changed.
+   */
+  void
+  name(const std::string& newName)
+  { name_ = newName; }
+
+  /** Returns the name of the %Block. */
+  const std::string&
+  name() const
+  { return name_; }
+
+  /**
+   * \brief Changes the name and definition of the %Block.
+   * \param newName New name of the %Block.
+   *
+   * In contrast to name() this function changes the name of the
+   * %Block and its first block definition (if it exists).
+   */
+  void
+  rename(const std::string& newName)
+  {
+    name(newName);
+    iterator block_def = find_block_def();
+    if (block_def != end())
+    {
+      (*block_def)[1] = newName;
+      block_def->classify();
+      modified();
+    }
+  }
+
+  /**
+   * \brief Assigns content from an input stream to the %Block.
    * \param is Input stream to read content from.
-   * \returns Reference to \c *this.
+   * \return Reference to \c *this.
    *
    * This function reads non-empty lines from \p is, transforms them
-   * into Lines, which are collected into the corresponding Blocks
-   * that are added to the %Coll.
+   * into Lines and adds them to the end of the %Block. Lines from
+   * \p is are read until the second block definition is encountered
+   * or until the end of the stream, whatever comes first. If \p is
+   * contains a block definition and the current name of the %Block is
+   * empty, it is changed accordingly.
+   *
+   * The stream is repositioned to the beginning of the second block
+   * definition, so that it can be read again. If \p is does not
+   * support this (e.g. if it reads from a pipe), its \c failbit is
+   * set. Use BlockReader to read such streams Block by Block.
    */
-  Coll&
+  Block&
   read(std::istream& is)
   {
     std::string line_str;
-    Line line;
+    value_type line;
 
-    const size_type orig_size = size();
-    pointer block = push_back_named_block("");
+    std::size_t def_count = 0;
+    bool nameless = name().empty();
 
-    while (std::getline(is, line_str))
-    {
-      if (detail::is_all_whitespace(line_str)) continue;
+    // The position of the current line is computed from the characters
+    // read so far, since calling tellg() for every line would make the
+    // stream buffer seek for each of them.
+    const std::streampos start = is.tellg();
+    std::streamoff line_offset = 0;
 
+    for (; std::getline(is, line_str);
+         line_offset += static_cast<std::streamoff>(line_str.length() + 1))
+    {
       line.str(line_str);
-      if (line.is_block_def()) block = push_back_named_block(line[1]);
-      block->push_back(line);
-    }
+      if (line.empty()) continue;
 
-    erase_if_empty("", orig_size);
+      if (line.is_block_def())
+      {
+        if (++def_count > 1)
+        {
+          // The last line need not end with a newline, in which case
+          // eofbit is set and would make seekg() fail.
+          is.clear(is.rdstate() & ~std::ios_base::eofbit);
+          if (start == std::streampos(-1)) is.seekg(start);
+          else is.seekg(start + line_offset);
+          break;
+        }
+        if (nameless)
+        {
+          name(line.block_name());
+          nameless = false;
+        }
+      }
+      push_back(line);
+    }
     return *this;
   }
 
   /**
-   * \brief Assigns content from a string to the %Coll.
-   * \param coll String that is used as content for the %Coll.
-   * \returns Reference to \c *this.
+   * \brief Assigns content from a character range to the %Block.
+   * \param first, last Pointers to the initial and final positions
+   *   of the characters that are read.
+   * \return Reference to \c *this.
+   *
+   * This function is equivalent to read(std::istream&) but parses the
+   * lines directly from the provided buffer.
    */
-  Coll&
-  str(const std::string& coll)
+  Block&
+  read(const char* first, const char* last)
   {
-    std::istringstream input(coll);
-    clear();
-    read(input);
+    read_lines(first, last);
     return *this;
   }
 
-  /** Returns a string representation of the %Coll. */
-  std::string
-  str() const
-  {
-    std::ostringstream output;
-    output << *this;
-    return output.str();
-  }
-
-  // element access
   /**
-   * \brief Locates a Block in the %Coll.
-   * \param blockName Name of the Block to be located.
-   * \return Read/write reference to sought-after Block.
+   * \brief Assigns content from a file to the %Block.
+   * \param path Path of the file to read content from.
+   * \return Reference to \c *this.
+   * \throw std::runtime_error If the file cannot be opened.
    *
-   * This function locates the first Block whose name equals
-   * \p blockName. If no such Block is present, an empty Block with
-   * this name is added to the end of the %Coll and a reference to it
-   * is then returned.
+   * This function is equivalent to read(std::istream&) with an input
+   * file stream for \p path. On POSIX systems the file is mapped into
+   * memory and parsed without a stream in between. The mapping is
+   * released before this function returns.
    */
-  reference
-  operator[](const key_type& blockName)
+  Block&
+  read_file(const std::string& path)
   {
-    iterator block = find(blockName);
-    if (block != end()) return *block;
+    const detail::mapped_file file(path);
+    if (!file.is_open())
+    { throw std::runtime_error("SLHAea::Block::read_file(‘" + path + "’)"); }
 
-    push_back(value_type(blockName));
-    return back();
+    return read(file.begin(), file.end());
   }
 
   /**
-   * \brief Locates a Block in the %Coll.
-   * \param blockName Name of the Block to be located.
-   * \return Read/write reference to sought-after Block.
-   * \throw std::out_of_range If no Block with the name \p blockName
-   *   exists.
+   * \brief Assigns content from a string to the %Block.
+   * \param block String that is used as content for the %Block.
+   * \return Reference to \c *this.
+   *
+   * This function clears the name and content of the %Block and adds
+   * every non-empty line found in \p block as Line to the end of the
+   * %Block. If \p block contains a block definition, the name of the
+   * %Block is set accordingly. If \p block contains more than two
+   * block definitions, only the lines before the second block
+   * definition are added to the %Block.
    */
-  reference
-  at(const key_type& blockName)
+  Block&
+  str(const std::string& block)
   {
-    iterator block = find(blockName);
-    if (block != end()) return *block;
+    clear();
+    return read(block.data(), block.data() + block.length());
+  }
 
-    throw std::out_of_range("SLHAea::Coll::at(‘" + blockName + "’)");
+  /** Returns a string representation of the %Block. */
+  std::string
+  str() const
+  {
+    std::string result;
+    detail::append_formatted(result, *this);
+    return result;
+  }
+
+  /** Returns the number of characters of str() const. */
+  std::size_t
+  formatted_length() const
+  {
+    detail::length_sink sink;
+    return write_to(sink).length();
   }
 
   /**
-   * \brief Locates a Block in the %Coll.
-   * \param blockName Name of the Block to be located.
-   * \return Read-only (constant) reference to sought-after Block.
-   * \throw std::out_of_range If no Block with the name \p blockName
-   *   exists.
+   * \brief Appends the string representation of the %Block to a
+   *   string.
+   * \param str String to which the %Block is appended.
+   * \return Reference to \p str.
    */
-  const_reference
-  at(const key_type& blockName) const
-  {
-    const_iterator block = find(blockName);
-    if (block != end()) return *block;
+  std::string&
+  append_to(std::string& str) const
+  { return detail::append_formatted(str, *this); }
 
-    throw std::out_of_range("SLHAea::Coll::at(‘" + blockName + "’)");
+  /**
+   * \brief Writes the string representation of the %Block to a sink.
+   * \param sink Object with a member function
+   *   <tt>append(const char*, std::size_t)</tt> (like std::string)
+   *   that the characters are passed to.
+   * \return Reference to \p sink.
+   *
+   * Every Line is written with Line::write_to() and followed by a
+   * newline. A %Block whose lines have not been parsed yet is written
+   * verbatim.
+   */
+  template<class Sink> Sink&
+  write_to(Sink& sink) const
+  {
+    if (source_)
+    {
+      sink.append(source_first_, source_last_ - source_first_);
+      if (source_last_[-1] != '\n') sink.append("\n", 1);
+      return sink;
+    }
+    for (impl_type::const_iterator line = impl_.begin();
+         line != impl_.end(); ++line)
+    {
+      line->write_to(sink);
+      sink.append("\n", 1);
+    }
+    return sink;
   }
 
+  // element access
   /**
-   * \brief Locates a Block in the %Coll.
-   * \param key First strings of the block definition of the Block
-   *   to be located.
-   * \return Read/write reference to sought-after Block.
-   * \throw std::out_of_range If \p key does not match any block
-   *   definition.
+   * \brief Locates a Line in the %Block.
+   * \param key First strings of the Line to be located.
+   * \return Read/write reference to sought-after Line.
    *
-   * This functions takes a vector of strings and locates the Block
-   * whose first strings of the block definition are equal to the
-   * strings in \p key. If no such Block exists, \c std::out_of_range
-   * is thrown.
+   * This function takes a key (which is a vector of strings) and
+   * locates the Line whose first strings are equal to the strings in
+   * \p key. If no such Line exists, this function creates an empty
+   * Line at the end of the %Block and returns a reference to it.
    */
   reference
-  at(const value_type::key_type& key)
+  operator[](const key_type& key)
   {
-    iterator block = find(key);
-    if (block != end()) return *block;
+    iterator line = find(key);
+    if (line != end()) return *line;
 
-    throw std::out_of_range(
-      "SLHAea::Coll::at(‘" + boost::join(key, ",") + "’)");
+    push_back(value_type());
+    return back();
   }
 
   /**
-   * \brief Locates a Block in the %Coll.
-   * \param key First strings of the block definition of the Block
-   *   to be located.
-   * \return Read-only (constant) reference to sought-after Block.
-   * \throw std::out_of_range If \p key does not match any block
-   *   definition.
+   * \brief Locates a Line in the %Block.
+   * \param key Integers that are used to locate the Line.
+   * \return Read/write reference to sought-after Line.
    *
-   * This functions takes a vector of strings and locates the Block
-   * whose first strings of the block definition are equal to the
-   * strings in \p key. If no such Block exists, \c std::out_of_range
-   * is thrown.
+   * This function takes a key (which is a vector of ints) and locates
+   * the Line whose first strings are equal to the to strings
+   * converted ints in \p key. If no such Line exists, this function
+   * creates an empty Line at the end of the %Block and returns a
+   * reference to it.
+   */
+  reference
+  operator[](const std::vector<int>& key)
+  {
+    const int* first = key.empty() ? 0 : &key[0];
+    return find_or_append(first, first + key.size());
+  }
+
+  /**
+   * \brief Locates a Line in the %Block.
+   * \param key String that is used to locate the Line.
+   * \return Read/write reference to sought-after Line.
+   *
+   * This function locates the Line whose first string is equal to
+   * \p key. If no such Line exists, this function creates an empty
+   * Line at the end of the %Block and returns a reference to it.
+   */
+  reference
+  operator[](const std::string& key)
+  { return (*this)[key_type(1, key)]; }
+
+  /**
+   * \brief Locates a Line in the %Block.
+   * \param key Integer that is used to locate the Line.
+   * \return Read/write reference to sought-after Line.
+   *
+   * This function locates the Line whose first string is equal to the
+   * to string converted \p key. If no such Line exists, this function
+   * creates an empty Line at the end of the %Block and returns a
+   * reference to it.
+   */
+  reference
+  operator[](int key)
+  { return find_or_append(&key, &key + 1); }
+
+  /**
+   * \brief Locates a Line in the %Block.
+   * \param key First strings of the Line to be located.
+   * \return Read/write reference to sought-after Line.
+   * \throw std::out_of_range If \p key does not match any Line.
+   *
+   * This function takes a key (which is a vector of strings) and
+   * locates the Line whose first strings are equal to the strings in
+   * \p key. If no such Line exists, \c std::out_of_range is thrown.
+   */
+  reference
+  at(const key_type& key)
+  {
+    iterator line = find(key);
+    if (line != end()) return *line;
+
+    throw std::out_of_range(
+      "SLHAea::Block::at(‘" + boost::join(key, ",") + "’)");
+  }
+
+  /**
+   * \brief Locates a Line in the %Block.
+   * \param key First strings of the Line to be located.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If \p key does not match any Line.
+   *
+   * This function takes a key (which is a vector of strings) and
+   * locates the Line whose first strings are equal to the strings in
+   * \p key. If no such Line exists, \c std::out_of_range is thrown.
    */
   const_reference
-  at(const value_type::key_type& key) const
+  at(const key_type& key) const
   {
-    const_iterator block = find(key);
-    if (block != end()) return *block;
+    const_iterator line = find(key);
+    if (line != end()) return *line;
 
     throw std::out_of_range(
-      "SLHAea::Coll::at(‘" + boost::join(key, ",") + "’)");
+      "SLHAea::Block::at(‘" + boost::join(key, ",") + "’)");
   }
 
   /**
-   * Returns a read/write reference to the first element of the %Coll.
+   * \brief Locates a Line in the %Block.
+   * \param key Integers that are used to locate the Line.
+   * \return Read/write reference to sought-after Line.
+   * \throw std::out_of_range If \p key does not match any Line.
+   *
+   * This function takes a vector of ints and locates the Line whose
+   * first strings are equal to the to strings converted ints in
+   * \p key. If no such Line exists, \c std::out_of_range is thrown.
    */
   reference
-  front()
-  { return impl_.front(); }
+  at(const std::vector<int>& key)
+  {
+    const int* first = key.empty() ? 0 : &key[0];
+    return lines()[find_or_throw(first, first + key.size())];
+  }
 
   /**
-   * Returns a read-only (constant) reference to the first element of
-   * the %Coll.
+   * \brief Locates a Line in the %Block.
+   * \param key Integers that are used to locate the Line.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If \p key does not match any Line.
+   *
+   * This function takes a vector of ints and locates the Line whose
+   * first strings are equal to the to strings converted ints in
+   * \p key. If no such Line exists, \c std::out_of_range is thrown.
    */
   const_reference
-  front() const
-  { return impl_.front(); }
+  at(const std::vector<int>& key) const
+  {
+    const int* first = key.empty() ? 0 : &key[0];
+    return lines()[find_or_throw(first, first + key.size())];
+  }
 
   /**
-   * Returns a read/write reference to the last element of the %Coll.
+   * \brief Locates a Line in the %Block.
+   * \param s0, s1, s2, s3, s4 First strings of the Line to be
+   *   located.
+   * \return Read/write reference to sought-after Line.
+   * \throw std::out_of_range If provided strings do not match any
+   *   Line.
+   *
+   * This function takes up to five strings and locates the Line whose
+   * first strings are equal to all provided non-empty strings. If no
+   * such Line exists, \c std::out_of_range is thrown.
    */
   reference
-  back()
-  { return impl_.back(); }
+  at(const std::string& s0,      const std::string& s1 = "",
+     const std::string& s2 = "", const std::string& s3 = "",
+     const std::string& s4 = "")
+  { return at(strings_to_key(s0, s1, s2, s3, s4)); }
 
   /**
-   * Returns a read-only (constant) reference to the last element of
-   * the %Coll.
+   * \brief Locates a Line in the %Block.
+   * \param s0, s1, s2, s3, s4 First strings of the Line to be
+   *   located.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If provided strings do not match any
+   *   Line.
+   *
+   * This function takes up to five strings and locates the Line whose
+   * first strings are equal to all provided non-empty strings. If no
+   * such Line exists, \c std::out_of_range is thrown.
    */
   const_reference
-  back() const
-  { return impl_.back(); }
+  at(const std::string& s0,      const std::string& s1 = "",
+     const std::string& s2 = "", const std::string& s3 = "",
+     const std::string& s4 = "") const
+  { return at(strings_to_key(s0, s1, s2, s3, s4)); }
 
-  // (nested) element access via Key
   /**
-   * \brief Accesses a Block in the %Coll.
-   * \param key Key that refers to the Block that should be accessed.
-   * \return Read/write reference to the Block referred to by \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing
-   *   Block.
+   * \brief Locates a Line in the %Block.
+   * \param i0, i1, i2, i3, i4 Integers that are used to locate the
+   *   Line.
+   * \return Read/write reference to sought-after Line.
+   * \throw std::out_of_range If provided ints do not match any
+   *   Line.
+   *
+   * This function takes up to five ints and locates the Line whose
+   * first strings are equal to all provided to string converted ints.
+   * If no such Line exists, \c std::out_of_range is thrown.
    */
   reference
-  block(const Key& key);
+  at(int i0, int i1 = no_index_, int i2 = no_index_,
+             int i3 = no_index_, int i4 = no_index_)
+  {
+    const int key[] = { i0, i1, i2, i3, i4 };
+    return lines()[find_or_throw(key, key + int_key_size(key))];
+  }
 
   /**
-   * \brief Accesses a Block in the %Coll.
-   * \param key Key that refers to the Block that should be accessed.
-   * \return Read-only (constant) reference to the Block referred to
-   *   by \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing
-   *   Block.
+   * \brief Locates a Line in the %Block.
+   * \param i0, i1, i2, i3, i4 Integers that are used to locate the
+   *   Line.
+   * \return Read-only (constant) reference to sought-after Line.
+   * \throw std::out_of_range If provided ints do not match any Line.
+   *
+   * This function takes up to five ints and locates the Line whose
+   * first strings are equal to all provided to string converted ints.
+   * If no such Line exists, \c std::out_of_range is thrown.
    */
   const_reference
-  block(const Key& key) const;
+  at(int i0, int i1 = no_index_, int i2 = no_index_,
+             int i3 = no_index_, int i4 = no_index_) const
+  {
+    const int key[] = { i0, i1, i2, i3, i4 };
+    return lines()[find_or_throw(key, key + int_key_size(key))];
+  }
 
   /**
-   * \brief Accesses a single Line in the %Coll.
-   * \param key Key that refers to the Line that should be accessed.
-   * \return Read/write reference to the Line referred to by \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing Line.
+   * Returns a read/write reference to the first element of the
+   * %Block.
    */
-  Block::reference
-  line(const Key& key);
+  reference
+  front()
+  { return lines().front(); }
 
   /**
-   * \brief Accesses a single Line in the %Coll.
-   * \param key Key that refers to the Line that should be accessed.
-   * \return Read-only (constant) reference to the Line referred to by
-   *   \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing Line.
+   * Returns a read-only (constant) reference to the first element of
+   * the %Block.
    */
-  Block::const_reference
-  line(const Key& key) const;
+  const_reference
+  front() const
+  { return lines().front(); }
 
   /**
-   * \brief Accesses a single field in the %Coll.
-   * \param key Key that refers to the field that should be accessed.
-   * \return Read/write reference to the field referred to by \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing
-   *   field.
+   * Returns a read/write reference to the last element of the %Block.
    */
-  Line::reference
-  field(const Key& key);
+  reference
+  back()
+  { return lines().back(); }
 
   /**
-   * \brief Accesses a single field in the %Coll.
-   * \param key Key that refers to the field that should be accessed.
-   * \return Read-only (constant) reference to the field referred to
-   *   by \p key.
-   * \throw std::out_of_range If \p key refers to a non-existing
-   *   field.
+   * Returns a read-only (constant) reference to the last element of
+   * the %Block.
    */
-  Line::const_reference
-  field(const Key& key) const;
+  const_reference
+  back() const
+  { return lines().back(); }
 
   // iterators
   /**
    * Returns a read/write iterator that points to the first element in
-   * the %Coll. Iteration is done in ordinary element order.
+   * the %Block. Iteration is done in ordinary element order.
    */
   iterator
   begin()
-  { return impl_.begin(); }
+  { return lines().begin(); }
 
   /**
    * Returns a read-only (constant) iterator that points to the first
-   * element in the %Coll. Iteration is done in ordinary element
+   * element in the %Block. Iteration is done in ordinary element
    * order.
    */
   const_iterator
   begin() const
-  { return impl_.begin(); }
+  { return lines().begin(); }
 
   /**
    * Returns a read-only (constant) iterator that points to the first
-   * element in the %Coll. Iteration is done in ordinary element
+   * element in the %Block. Iteration is done in ordinary element
    * order.
    */
   const_iterator
   cbegin() const
-  { return impl_.begin(); }
+  { return lines().begin(); }
 
   /**
    * Returns a read/write iterator that points one past the last
-   * element in the %Coll. Iteration is done in ordinary element
+   * element in the %Block. Iteration is done in ordinary element
    * order.
    */
   iterator
   end()
-  { return impl_.end(); }
+  { return lines().end(); }
 
   /**
    * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Coll. Iteration is done in ordinary element
+   * last element in the %Block. Iteration is done in ordinary element
    * order.
    */
   const_iterator
   end() const
-  { return impl_.end(); }
+  { return lines().end(); }
 
   /**
    * Returns a read-only (constant) iterator that points one past the
-   * last element in the %Coll. Iteration is done in ordinary element
+   * last element in the %Block. Iteration is done in ordinary element
    * order.
    */
   const_iterator
   cend() const
-  { return impl_.end(); }
+  { return lines().end(); }
 
   /**
    * Returns a read/write reverse iterator that points to the last
-   * element in the %Coll. Iteration is done in reverse element order.
+   * element in the %Block. Iteration is done in reverse element
+   * order.
    */
   reverse_iterator
   rbegin()
-  { return impl_.rbegin(); }
+  { return lines().rbegin(); }
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Coll. Iteration is done in reverse
+   * the last element in the %Block. Iteration is done in reverse
    * element order.
    */
   const_reverse_iterator
   rbegin() const
-  { return impl_.rbegin(); }
+  { return lines().rbegin(); }
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * the last element in the %Coll. Iteration is done in reverse
+   * the last element in the %Block. Iteration is done in reverse
    * element order.
    */
   const_reverse_iterator
   crbegin() const
-  { return impl_.rbegin(); }
+  { return lines().rbegin(); }
 
   /**
    * Returns a read/write reverse iterator that points to one before
-   * the first element in the %Coll. Iteration is done in reverse
+   * the first element in the %Block. Iteration is done in reverse
    * element order.
    */
   reverse_iterator
   rend()
-  { return impl_.rend(); }
+  { return lines().rend(); }
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Coll. Iteration is done in
-   * reverse element order.
+   * one before the first element in the %Block. Iteration is done
+   * in reverse element order.
    */
   const_reverse_iterator
   rend() const
-  { return impl_.rend(); }
+  { return lines().rend(); }
 
   /**
    * Returns a read-only (constant) reverse iterator that points to
-   * one before the first element in the %Coll. Iteration is done in
-   * reverse element order.
+   * one before the first element in the %Block. Iteration is done
+   * in reverse element order.
    */
   const_reverse_iterator
   crend() const
-  { return impl_.rend(); }
+  { return lines().rend(); }
 
   // lookup
   /**
-   * \brief Tries to locate a Block in the %Coll.
-   * \param blockName Name of the Block to be located.
+   * \brief Tries to locate a Line in the %Block.
+   * \param key First strings of the Line to be located.
    * \return Read/write iterator pointing to sought-after element, or
    *   end() if not found.
    *
-   * This function takes a key and tries to locate the Block whose
-   * name matches \p blockName. If successful the function returns a
-   * read/write iterator pointing to the sought after Block. If
+   * This function takes a key (which is a vector of strings) and
+   * tries to locate the Line whose first strings are equal to the
+   * strings in \p key. If successful the function returns a
+   * read/write iterator pointing to the sought after Line. If
    * unsuccessful it returns end().
    */
   iterator
-  find(const key_type& blockName)
-  { return std::find_if(begin(), end(), key_matches(blockName)); }
+  find(const key_type& key)
+  {
+    if (use_index_ && is_indexable(key)) return begin() + find_in_index(key);
+    return std::find_if(begin(), end(), key_matches(key));
+  }
 
   /**
-   * \brief Tries to locate a Block in the %Coll.
-   * \param blockName Name of the Block to be located.
+   * \brief Tries to locate a Line in the %Block.
+   * \param key First strings of the Line to be located.
    * \return Read-only (constant) iterator pointing to sought-after
    *   element, or end() const if not found.
    *
-   * This function takes a key and tries to locate the Block whose
-   * name matches \p blockName. If successful the function returns a
-   * read-only (constant) iterator pointing to the sought after Block.
-   * If unsuccessful it returns end() const.
+   * This function takes a key (which is a vector of strings) and
+   * tries to locate the Line whose first strings are equal to the
+   * strings in \p key. If successful the function returns a read-only
+   * (constant) iterator pointing to the sought after Line. If
+   * unsuccessful it returns end() const.
    */
   const_iterator
-  find(const key_type& blockName) const
-  { return std::find_if(begin(), end(), key_matches(blockName)); }
+  find(const key_type& key) const
+  {
+    if (use_index_ && is_indexable(key)) return begin() + find_in_index(key);
+    return std::find_if(begin(), end(), key_matches(key));
+  }
 
   /**
-   * \brief Tries to locate a Block in a range.
+   * \brief Tries to locate a Line in a range.
    * \param first, last Input iterators to the initial and final
    *   positions in a sequence.
-   * \param blockName Name of the Block to be located.
+   * \param key First strings of the Line to be located.
    * \return Iterator pointing to sought-after element, or \p last if
    *   not found.
    *
    * This function tries to locate in the range [\p first, \p last)
-   * the Block whose name matches \p blockName. If successful the
-   * function returns an iterator pointing to the sought after Block.
-   * If unsuccessful it returns \p last.
+   * the Line whose first strings are equal to the strings in \p key.
+   * If successful the function returns an iterator pointing to the
+   * sought after Line. If unsuccessful it returns \p last.
    */
   template<class InputIterator> static InputIterator
-  find(InputIterator first, InputIterator last, const key_type& blockName)
-  { return std::find_if(first, last, key_matches(blockName)); }
+  find(InputIterator first, InputIterator last, const key_type& key)
+  { return std::find_if(first, last, key_matches(key)); }
 
   /**
-   * \brief Tries to locate a Block in the %Coll.
-   * \param key First strings of the block definition of the Block
-   *   to be located.
+   * \brief Tries to locate a Line in the %Block.
+   * \param pattern Precompiled key of the Line to be located.
    * \return Read/write iterator pointing to sought-after element, or
    *   end() if not found.
    *
-   * This functions takes a vector of strings and tries to locate the
-   * Block whose first strings of the block definition are equal to
-   * the strings in \p key. If successful the function returns a
-   * read/write iterator pointing to the sought after Block. If
-   * unsuccessful it returns end().
+   * This function returns an iterator pointing to the first Line that
+   * matches \p pattern. The index of Lines is not used.
    */
   iterator
-  find(const value_type::key_type& key)
-  { return std::find_if(begin(), end(), key_matches_block_def(key)); }
+  find(const key_pattern& pattern)
+  { return std::find_if(begin(), end(), pattern); }
 
   /**
-   * \brief Tries to locate a Block in the %Coll.
-   * \param key First strings of the block definition of the Block
-   *   to be located.
+   * \brief Tries to locate a Line in the %Block.
+   * \param pattern Precompiled key of the Line to be located.
    * \return Read-only (constant) iterator pointing to sought-after
    *   element, or end() const if not found.
    *
-   * This functions takes a vector of strings and tries to locate the
-   * Block whose first strings of the block definition are equal to
-   * the strings in \p key. If successful the function returns a
-   * read-only (constant) iterator pointing to the sought after Block.
-   * If unsuccessful it returns end() const.
+   * This function returns an iterator pointing to the first Line that
+   * matches \p pattern. The index of Lines is not used.
    */
   const_iterator
-  find(const value_type::key_type& key) const
-  { return std::find_if(begin(), end(), key_matches_block_def(key)); }
+  find(const key_pattern& pattern) const
+  { return std::find_if(begin(), end(), pattern); }
 
   /**
-   * \brief Tries to locate a Block in a range.
+   * Returns a read/write iterator that points to the first Line in
+   * the %Block which is a block definition. If the %Block does not
+   * contain a block definition, end() is returned.
+   */
+  iterator
+  find_block_def()
+  {
+    return std::find_if(begin(), end(),
+      MEM_FN(&value_type::is_block_def));
+  }
+
+  /**
+   * Returns a read-only (constant) iterator that points to the first
+   * Line in the %Block which is a block definition. If the %Block
+   * does not contain a block definition, end() const is returned.
+   */
+  const_iterator
+  find_block_def() const
+  {
+    return std::find_if(begin(), end(),
+      MEM_FN(&value_type::is_block_def));
+  }
+
+  // introspection
+  /**
+   * \brief Counts all Lines that match a given key.
+   * \param key First strings of the Lines that will be counted.
+   * \return Number of lines whose first strings equal \p key.
+   */
+  size_type
+  count(const key_type& key) const
+  { return std::count_if(begin(), end(), key_matches(key)); }
+
+  /**
+   * \brief Counts all Lines that match a precompiled key.
+   * \param pattern Precompiled key of the Lines that will be counted.
+   * \return Number of lines that match \p pattern.
+   */
+  size_type
+  count(const key_pattern& pattern) const
+  { return std::count_if(begin(), end(), pattern); }
+
+  /**
+   * \brief Enables or disables the index of Lines.
+   * \param enable If true, the index is enabled and rebuilt.
+   *
+   * With the index, find(const key_type&) and the functions that use
+   * it (at() and operator[]()) look up Lines by their first strings
+   * in constant average time instead of comparing the keys with all
+   * Lines. Keys that contain \c "(any)" or more than five strings are
+   * still compared with all Lines. Lines added to the end of the
+   * %Block (e.g. by push_back() or operator[]()) are added to the
+   * index on the next lookup and the index is rebuilt on the next
+   * lookup after any other modification of the %Block. Other changes
+   * of Lines through references or iterators are only noticed if they
+   * affect the Line found by a lookup, so after such changes the index
+   * should be rebuilt by calling this function again.
+   *
+   * The index is built and updated by the lookups themselves, also
+   * if they are called on a const %Block. A %Block with enabled index
+   * must therefore not be read from several threads at the same time.
+   */
+  void
+  use_index(bool enable = true)
+  {
+    use_index_ = enable;
+    index_.clear();
+  }
+
+  /** Returns true if the index of Lines is enabled. */
+  bool
+  uses_index() const
+  { return use_index_; }
+
+  // conversion
+  /**
+   * \brief Converts the data Lines to a dense matrix.
+   * \param rank Number of index fields in each data Line (1, 2 or 3).
+   * \param storage Whether missing elements are zero or mirrored.
+   * \return Matrix that contains the values of the data Lines.
+   * \throw std::invalid_argument If a data Line does not start with
+   *   \p rank positive integers followed by a value, or if \p storage
+   *   is symmetric_matrix and \p rank is not 2.
+   * \throw boost::bad_lexical_cast If a value cannot be converted to
+   *   \p T.
+   *
+   * See Matrix for details.
+   */
+  template<class T> Matrix<T>
+  as_matrix(size_type rank = 2,
+            matrix_storage storage = general_matrix) const;
+
+  // capacity
+  /** Returns the number of elements in the %Block. */
+  size_type
+  size() const
+  { return lines().size(); }
+
+  /** Returns the number of data Lines in the %Block. */
+  size_type
+  data_size() const
+  {
+    return std::count_if(begin(), end(),
+      MEM_FN(&value_type::is_data_line));
+  }
+
+  /** Returns the size() of the largest possible %Block. */
+  size_type
+  max_size() const
+  { return impl_.max_size(); }
+
+  /** Returns true if the %Block is empty. */
+  bool
+  empty() const
+  { return lines().empty(); }
+
+  // modifiers
+  /**
+   * \brief Adds a Line to the end of the %Block.
+   * \param line Line to be added.
+   *
+   * This function creates an element at the end of the %Block and
+   * assigns the given \p line to it.
+   */
+  void
+  push_back(const value_type& line)
+  { lines().push_back(line); }
+
+  /**
+   * \brief Adds a Line to the end of the %Block.
+   * \param line String that is used to construct the Line that will
+   *   be added.
+   *
+   * This function creates an element at the end of the %Block and
+   * assigns the Line that is constructed from \p line to it.
+   */
+  void
+  push_back(const std::string& line)
+  { lines().push_back(value_type(line)); }
+
+  /**
+   * Removes the last element. This function shrinks the size() of the
+   * %Block by one.
+   */
+  void
+  pop_back()
+  {
+    lines().pop_back();
+    modified();
+  }
+
+  /**
+   * \brief Inserts a Line before given \p position.
+   * \param position Iterator into the %Block.
+   * \param line Line to be inserted.
+   * \return Iterator pointing to the inserted element.
+   *
+   * This function inserts a copy of \p line before the specified
+   * \p position and thus enlarges the %Block by one.
+   */
+  iterator
+  insert(iterator position, const value_type& line)
+  {
+    modified();
+    return impl_.insert(position, line);
+  }
+
+  /**
+   * \brief Inserts a range into the %Block.
+   * \param position Iterator into the %Block.
    * \param first, last Input iterators to the initial and final
    *   positions in a sequence.
-   * \param key First strings of the block definition of the Block
-   *   to be located.
-   * \return Iterator pointing to sought-after element, or \p last if
-   *   not found.
    *
-   * This function tries to locate in the range [\p first, \p last)
-   * the Block whose first strings of the block definition are equal
-   * to the strings in \p key. If successful the function returns an
-   * iterator pointing to the sought after Block. If unsuccessful it
-   * returns \p last.
+   * This function inserts copies of the Lines in the range
+   * [\p first, \p last) into the %Block before the specified
+   * \p position and thus enlarges the %Block accordingly.
    */
-  template<class InputIterator> static InputIterator
-  find(InputIterator first, InputIterator last,
-       const value_type::key_type& key)
-  { return std::find_if(first, last, key_matches_block_def(key)); }
+  template<class InputIterator> void
+  insert(iterator position, InputIterator first, InputIterator last)
+  {
+    modified();
+    impl_.insert(position, first, last);
+  }
+
+  /**
+   * \brief Erases element at given \p position.
+   * \param position Iterator pointing to the element to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function erases the element at the given \p position and
+   * thus shortens the %Block by one.
+   */
+  iterator
+  erase(iterator position)
+  {
+    modified();
+    return impl_.erase(position);
+  }
+
+  /**
+   * \brief Erases a range of elements.
+   * \param first Iterator pointing to the first element to be erased.
+   * \param last Iterator pointing to one past the last element to be
+   *   erased.
+   * \return Iterator pointing to the element pointed to by \p last
+   *   prior to erasing (or end()).
+   *
+   * This function erases the elements in the range [\p first,
+   * \p last) and shortens the %Block accordingly.
+   */
+  iterator
+  erase(iterator first, iterator last)
+  {
+    modified();
+    return impl_.erase(first, last);
+  }
+
+  /**
+   * \brief Erases first Line that matches the provided key.
+   * \param key First strings of the Line to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function takes a key (which is a vector of strings) and
+   * erases the first Line whose first strings are equal to the strings
+   * in \p key. If the %Block contains such Line, the function returns
+   * an iterator pointing to the next element (or end()). If no such
+   * Line exists, end() is returned.
+   */
+  iterator
+  erase_first(const key_type& key)
+  {
+    iterator line = find(key);
+    return (line != end()) ? erase(line) : line;
+  }
+
+  /**
+   * \brief Erases last Line that matches the provided key.
+   * \param key First strings of the Line to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function takes a key (which is a vector of strings) and
+   * erases the last Line whose first strings are equal to the strings
+   * in \p key. If the %Block contains such Line, the function returns
+   * an iterator pointing to the next element (or end()). If no such
+   * Line exists, end() is returned.
+   */
+  iterator
+  erase_last(const key_type& key)
+  {
+    reverse_iterator line = find(rbegin(), rend(), key);
+    return (line != rend()) ? erase((++line).base()) : end();
+  }
+
+  /**
+   * \brief Erases all Lines that match the provided key.
+   * \param key First strings of the Lines to be erased.
+   * \return The number of Lines erased.
+   *
+   * This function takes a key (which is a vector of strings) and
+   * erases all Lines whose first strings are equal to the strings
+   * in \p key.
+   */
+  size_type
+  erase(const key_type& key)
+  { return erase_matching(key_matches(key)); }
+
+  /**
+   * \brief Erases all Lines that match a precompiled key.
+   * \param pattern Precompiled key of the Lines to be erased.
+   * \return The number of Lines erased.
+   */
+  size_type
+  erase(const key_pattern& pattern)
+  { return erase_matching(pattern); }
+
+  /**
+   * \brief Swaps data with another %Block.
+   * \param block %Block to be swapped with.
+   */
+  void
+  swap(Block& block)
+  {
+    name_.swap(block.name_);
+    impl_.swap(block.impl_);
+    source_.swap(block.source_);
+    std::swap(source_first_, block.source_first_);
+    std::swap(source_last_, block.source_last_);
+    std::swap(verbatim_, block.verbatim_);
+    index_.swap(block.index_);
+    std::swap(indexed_lines_, block.indexed_lines_);
+    std::swap(use_index_, block.use_index_);
+    generation_.swap(block.generation_);
+  }
+
+  /**
+   * Erases all the elements in the %Block and set its name to an
+   * empty string.
+   */
+  void
+  clear()
+  {
+    name_.clear();
+    impl_.clear();
+    source_.reset();
+    modified();
+  }
+
+  /**
+   * \brief Reformats all Lines in the %Block.
+   * \sa Line::reformat()
+   */
+  void
+  reformat()
+  { std::for_each(begin(), end(), MEM_FN(&value_type::reformat)); }
+
+  /**
+   * \brief Comments all Lines in the %Block.
+   * \sa Line::comment()
+   */
+  void
+  comment()
+  {
+    std::for_each(begin(), end(), MEM_FN(&value_type::comment));
+    modified();
+  }
+
+  /**
+   * \brief Uncomments all Lines in the %Block.
+   * \sa Line::uncomment()
+   */
+  void
+  uncomment()
+  {
+    std::for_each(begin(), end(), MEM_FN(&value_type::uncomment));
+    modified();
+  }
+
+  /** Unary predicate that checks if a provided key matches a Line. */
+  struct key_matches
+  {
+    explicit
+    key_matches(const key_type& key) : key_(key) {}
+
+    bool
+    operator()(const value_type& line) const
+    {
+      return (key_.empty() || key_.size() > line.size()) ? false :
+        std::equal(key_.begin(), key_.end(), line.begin(), parts_equal);
+    }
+
+    void
+    set_key(const key_type& key)
+    { key_ = key; }
+
+  private:
+    static bool
+    parts_equal(const std::string& key_part, const std::string& field)
+    { return (key_part == "(any)") || boost::iequals(key_part, field); }
+
+  private:
+    key_type key_;
+  };
+
+  /**
+   * Unary predicate that checks if a precompiled key matches a Line.
+   * A %key_pattern matches the same Lines as key_matches with the
+   * same key, but analyzes the key only once: \c "(any)" parts are
+   * dropped, the other parts are converted to upper case and parts
+   * without letters (like numbers) are compared byte by byte. This
+   * makes it faster if the same key is matched against many Lines.
+   */
+  class key_pattern
+  {
+  public:
+    explicit
+    key_pattern(const key_type& key) : parts_(), size_(key.size())
+    {
+      for (size_type pos = 0; pos < key.size(); ++pos)
+      {
+        if (key[pos] == "(any)") continue;
+
+        part p;
+        p.pos = pos;
+        p.text = detail::to_upper_copy(key[pos]);
+        p.caseless = p.text == key[pos] &&
+          detail::to_lower_copy(key[pos]) == key[pos];
+        parts_.push_back(p);
+      }
+    }
+
+    bool
+    operator()(const value_type& line) const
+    {
+      if (size_ == 0 || size_ > line.size()) return false;
+
+      for (std::vector<part>::const_iterator p = parts_.begin();
+           p != parts_.end(); ++p)
+      {
+        const std::string& field = line[p->pos];
+        if (field.length() != p->text.length()) return false;
+        if (p->caseless)
+        {
+          if (field != p->text) return false;
+        }
+        else if (!std::equal(field.begin(), field.end(), p->text.begin(),
+                             upper_equal)) return false;
+      }
+      return true;
+    }
+
+  private:
+    static bool
+    upper_equal(char field_char, char upper_char)
+    {
+      return std::toupper(static_cast<unsigned char>(field_char)) ==
+        static_cast<unsigned char>(upper_char);
+    }
+
+    struct part
+    {
+      size_type pos;
+      std::string text;
+      bool caseless;
+    };
+
+  private:
+    std::vector<part> parts_;
+    size_type size_;
+  };
+
+private:
+  friend class Coll;
+  friend class KeyHandle;
+  template<class T> friend class Matrix;
+  friend std::ostream& operator<<(std::ostream&, const Block&);
+
+  /**
+   * Makes the lines in [\p first, \p last) the content of the %Block
+   * without parsing them. \p block_def must be the first of these
+   * lines and \p source must keep them alive. Until the %Block is
+   * accessed, it only contains \p block_def. If \p verbatim is true,
+   * the Lines keep their original text when they are parsed.
+   */
+  void
+  defer_read(const value_type& block_def,
+             const boost::shared_ptr<const void>& source,
+             const char* first, const char* last, bool verbatim)
+  {
+    impl_.assign(1, block_def);
+    modified();
+    source_ = source;
+    source_first_ = first;
+    source_last_ = last;
+    verbatim_ = verbatim;
+  }
+
+  /** Returns the Lines of the %Block after parsing deferred lines. */
+  impl_type&
+  lines() const
+  {
+    if (source_) parse_source();
+    return impl_;
+  }
+
+  void
+  parse_source() const
+  {
+    detail::char_scanner scanner(source_first_, source_last_);
+    value_type line;
+
+    impl_.clear();
+    for (const char* pos = source_first_; pos != source_last_;)
+    {
+      pos = line.parse(scanner, pos, verbatim_);
+      if (!line.empty()) impl_.push_back(line);
+    }
+    source_.reset();
+  }
+
+  /**
+   * Unary predicate that checks if a key of ints matches a Line
+   * without converting the ints to strings.
+   */
+  struct int_key_matches
+  {
+    int_key_matches(const int* first, const int* last)
+      : first_(first), last_(last) {}
+
+    bool
+    operator()(const value_type& line) const
+    {
+      if (first_ == last_ || size() > line.size()) return false;
+      value_type::const_iterator field = line.begin();
+      for (const int* i = first_; i != last_; ++i, ++field)
+      { if (!detail::equals_int(*field, *i)) return false; }
+      return true;
+    }
+
+    size_type
+    size() const
+    { return last_ - first_; }
+
+    const int* first_;
+    const int* last_;
+  };
+
+  /**
+   * Returns the position of the first Line whose first strings equal
+   * the ints in [\p first, \p last), or size() if there is none.
+   */
+  size_type
+  find_position(const int* first, const int* last) const
+  {
+    const int_key_matches key(first, last);
+    if (use_index_ && is_indexable(key)) return find_in_index(key);
+    return std::find_if(begin(), end(), key) - begin();
+  }
+
+  size_type
+  find_or_throw(const int* first, const int* last) const
+  {
+    const size_type pos = find_position(first, last);
+    if (pos != size()) return pos;
+
+    throw std::out_of_range("SLHAea::Block::at(‘" +
+      boost::join(cont_to_key(std::vector<int>(first, last)), ",") + "’)");
+  }
+
+  reference
+  find_or_append(const int* first, const int* last)
+  {
+    const size_type pos = find_position(first, last);
+    if (pos != size()) return lines()[pos];
+
+    push_back(value_type());
+    return back();
+  }
+
+  /** Returns the number of ints in \p key before the first no_index_. */
+  static size_type
+  int_key_size(const int* key)
+  {
+    size_type size = 0;
+    while (size < 5 && key[size] != no_index_) ++size;
+    return size;
+  }
+
+  template<class Predicate> size_type
+  erase_matching(const Predicate& pred)
+  {
+    size_type erased_count = 0;
+
+    for (iterator line = begin(); line != end();)
+    {
+      if (pred(*line))
+      {
+        line = erase(line);
+        ++erased_count;
+      }
+      else ++line;
+    }
+    return erased_count;
+  }
+
+  /**
+   * Invalidates the index and all KeyHandles that refer to Lines in
+   * the %Block. This must be called after each modification that may
+   * move or change Lines, except for appending Lines.
+   */
+  void
+  modified()
+  {
+    index_.clear();
+    generation_.increment();
+  }
+
+  static bool
+  is_indexable(const key_type& key)
+  {
+    return !key.empty() && key.size() <= max_index_key_size_ &&
+      std::find(key.begin(), key.end(), "(any)") == key.end();
+  }
+
+  static bool
+  is_indexable(const int_key_matches& key)
+  { return key.size() != 0 && key.size() <= max_index_key_size_; }
+
+  /** Appends the strings of \p key, joined by spaces, to \p joined. */
+  static void
+  join_key(std::string& joined, const key_type& key)
+  {
+    for (key_type::const_iterator part = key.begin(); part != key.end();
+         ++part)
+    {
+      if (part != key.begin()) joined += ' ';
+      joined += *part;
+    }
+  }
+
+  static void
+  join_key(std::string& joined, const int_key_matches& key)
+  {
+    char buffer[11];
+    for (const int* i = key.first_; i != key.last_; ++i)
+    {
+      if (i != key.first_) joined += ' ';
+      joined.append(detail::int_to_chars(*i, buffer + 11), buffer + 11);
+    }
+  }
+
+  static bool
+  matches_index_entry(const key_type& key, const value_type& line)
+  {
+    return key.size() <= line.size() &&
+      std::equal(key.begin(), key.end(), line.begin(), detail::iequal_to());
+  }
+
+  static bool
+  matches_index_entry(const int_key_matches& key, const value_type& line)
+  { return key(line); }
+
+  /**
+   * Returns the position of the first Line that matches \p key
+   * according to the index, or size() if there is none.
+   */
+  template<class Key> size_type
+  find_in_index(const Key& key) const
+  {
+    if (index_.size() < key.size()) build_index(key.size());
+    else
+    {
+      for (; indexed_lines_ < size(); ++indexed_lines_)
+      { add_to_index(indexed_lines_); }
+    }
+
+    std::string joined;
+    join_key(joined, key);
+
+    const index_type& index = index_[key.size() - 1];
+    index_type::const_iterator entry = index.find(joined);
+    if (entry == index.end()) return size();
+
+    // Lines may have been changed through references since the index
+    // was built.
+    if (entry->second < size() &&
+        matches_index_entry(key, impl_[entry->second]))
+    { return entry->second; }
+    build_index(key.size());
+    entry = index_[key.size() - 1].find(joined);
+    if (entry == index_[key.size() - 1].end()) return size();
+    if (matches_index_entry(key, impl_[entry->second])) return entry->second;
+
+    // Keys whose strings contain spaces can be joined to the same
+    // string as other keys.
+    return find_without_index(key);
+  }
+
+  size_type
+  find_without_index(const key_type& key) const
+  { return std::find_if(begin(), end(), key_matches(key)) - begin(); }
+
+  size_type
+  find_without_index(const int_key_matches& key) const
+  { return std::find_if(begin(), end(), key) - begin(); }
+
+  /** Builds the index for all keys with up to \p key_size strings. */
+  void
+  build_index(size_type key_size) const
+  {
+    index_.clear();
+    index_.resize(key_size);
+    for (indexed_lines_ = 0; indexed_lines_ < size(); ++indexed_lines_)
+    { add_to_index(indexed_lines_); }
+  }
+
+  void
+  add_to_index(size_type pos) const
+  {
+    const value_type& line = impl_[pos];
+    const size_type key_size = std::min(index_.size(), line.size());
+    std::string joined;
+    for (size_type i = 0; i < key_size; ++i)
+    {
+      if (i != 0) joined += ' ';
+      joined += line[i];
+      index_[i].insert(std::make_pair(joined, pos));
+    }
+  }
+
+  const char*
+  read_lines(const char* first, const char* last, bool verbatim = false)
+  {
+    detail::char_scanner scanner(first, last);
+    value_type line;
+
+    std::size_t def_count = 0;
+    bool nameless = name().empty();
+
+    for (const char* pos = first; pos != last;)
+    {
+      const char* next = line.parse(scanner, pos, verbatim);
+      if (!line.empty())
+      {
+        if (line.is_block_def())
+        {
+          if (++def_count > 1)
+          {
+            shrink_to_fit();
+            return pos;
+          }
+          if (nameless)
+          {
+            name(line.block_name());
+            nameless = false;
+          }
+        }
+        push_back(line);
+      }
+      pos = next;
+    }
+    shrink_to_fit();
+    return last;
+  }
+
+  /**
+   * Releases the unused capacity of the vector of Lines, which can be
+   * up to half of it after reading. The Lines are swapped into the
+   * new vector, so their fields are not copied.
+   */
+  void
+  shrink_to_fit()
+  {
+    if (impl_.capacity() == impl_.size()) return;
+    impl_type lines(impl_.size());
+    for (size_type i = 0; i < impl_.size(); ++i) lines[i].swap(impl_[i]);
+    impl_.swap(lines);
+  }
+
+  template<class Container> static key_type
+  cont_to_key(const Container& cont)
+  {
+    key_type key;
+    key.reserve(cont.size());
+    std::string (*to_string)(const typename Container::value_type&) =
+      boost::lexical_cast<std::string, typename Container::value_type>;
+    std::transform(cont.begin(), cont.end(), std::back_inserter(key),
+      to_string);
+    return key;
+  }
+
+  static key_type
+  strings_to_key(const std::string& s0, const std::string& s1,
+                 const std::string& s2, const std::string& s3,
+                 const std::string& s4)
+  {
+    key_type key;
+    key.reserve(5);
+    if (s0.empty()) { return key; } key.push_back(s0);
+    if (s1.empty()) { return key; } key.push_back(s1);
+    if (s2.empty()) { return key; } key.push_back(s2);
+    if (s3.empty()) { return key; } key.push_back(s3);
+    if (s4.empty()) { return key; } key.push_back(s4);
+    return key;
+  }
+
+private:
+  std::string name_;
+  // NOTE: If the %Block was read with Coll::read_lazy, its lines are
+  //   parsed from [source_first_, source_last_) on first access. This
+  //   is why impl_ and source_ are modified by const functions.
+  mutable impl_type impl_;
+  mutable boost::shared_ptr<const void> source_;
+  const char* source_first_;
+  const char* source_last_;
+  bool verbatim_;
+
+  // index_[n] maps the case-insensitive first n+1 strings of the first
+  // indexed_lines_ Lines (joined by spaces) to the position of the
+  // first such Line. It is empty if the index is disabled or must be
+  // rebuilt.
+  typedef boost::unordered_map<std::string, size_type,
+                               detail::ihash, detail::iequal_to> index_type;
+  mutable std::vector<index_type> index_;
+  mutable size_type indexed_lines_;
+  bool use_index_;
+  detail::generation_counter generation_;
+  static const size_type max_index_key_size_ = 5;
+  static const int no_index_ = -32768;
+};
+
+
+/**
+ * Dense matrix of the values of a Block.
+ * This class holds the values of a Block whose data Lines have the
+ * form <tt>i j value</tt> (or <tt>i value</tt> and <tt>i j k
+ * value</tt> for rank 1 and 3, respectively) in a contiguous array in
+ * row-major order. The indices start at 1 and the extent of each
+ * dimension is the largest index of this dimension in the Block.
+ * Elements without a data Line are zero, or, if the %Matrix was
+ * created with Block::symmetric_matrix, equal to their transposed
+ * elements. If an element appears in several Lines, the last one is
+ * used.
+ *
+ * A %Matrix remembers the Block it was created from. update() creates
+ * it again if Lines were added to, removed from or reordered in the
+ * Block since then, but changes of single fields through references
+ * or iterators are not noticed.
+ */
+template<class T>
+class Matrix
+{
+public:
+  typedef T                                       value_type;
+  typedef const T&                                const_reference;
+  typedef const T*                                const_pointer;
+  typedef typename std::vector<T>::const_iterator const_iterator;
+  typedef std::size_t                             size_type;
+
+  /**
+   * Largest number of elements of a %Matrix. assign() rejects Blocks
+   * whose indices would need more elements.
+   */
+  static const size_type max_elements = 1UL << 26;
+
+  /** \brief Constructs an empty %Matrix. */
+  Matrix()
+    : block_(0), rank_(0), storage_(Block::general_matrix),
+      block_size_(0), generation_(0) {}
+
+  /**
+   * \brief Constructs a %Matrix from the data Lines of a Block.
+   * \param block Block whose values are stored in the %Matrix.
+   * \param rank Number of index fields in each data Line (1, 2 or 3).
+   * \param storage Whether missing elements are zero or mirrored.
+   * \throw std::invalid_argument If a data Line does not start with
+   *   \p rank positive integers followed by a value, if its indices
+   *   would need more than max_elements elements, or if \p storage
+   *   is Block::symmetric_matrix and \p rank is not 2.
+   * \throw boost::bad_lexical_cast If a value cannot be converted to
+   *   \p T.
+   */
+  explicit
+  Matrix(const Block& block, size_type rank = 2,
+         Block::matrix_storage storage = Block::general_matrix)
+    : block_(0), rank_(0), storage_(storage), block_size_(0),
+      generation_(0)
+  { assign(block, rank, storage); }
+
+  /**
+   * \brief Replaces the content with the data Lines of a Block.
+   * \param block Block whose values are stored in the %Matrix.
+   * \param rank Number of index fields in each data Line (1, 2 or 3).
+   * \param storage Whether missing elements are zero or mirrored.
+   * \throw std::invalid_argument If a data Line does not start with
+   *   \p rank positive integers followed by a value, if its indices
+   *   would need more than max_elements elements, or if \p storage
+   *   is Block::symmetric_matrix and \p rank is not 2.
+   * \throw boost::bad_lexical_cast If a value cannot be converted to
+   *   \p T.
+   */
+  void
+  assign(const Block& block, size_type rank = 2,
+         Block::matrix_storage storage = Block::general_matrix)
+  {
+    if (rank < 1 || rank > 3)
+    {
+      throw std::invalid_argument("SLHAea::Matrix::assign(" +
+        to_string(rank) + ")");
+    }
+    if (storage == Block::symmetric_matrix && rank != 2)
+    {
+      throw std::invalid_argument("SLHAea::Matrix::assign(" +
+        to_string(rank) + ", symmetric_matrix)");
+    }
+
+    std::vector<size_type> indices;
+    std::vector<T> values;
+    size_type extents[3] = {0, 0, 0};
+    size_type index = 0;
+    size_type size = 0;
+
+    for (Block::const_iterator line = block.begin(); line != block.end();
+         ++line)
+    {
+      if (!line->is_data_line()) continue;
+      if (line->size() <= rank) throw_bad_line(*line);
+
+      for (size_type dim = 0; dim < rank; ++dim)
+      {
+        if (!detail::parse_index((*line)[dim], index)) throw_bad_line(*line);
+        indices.push_back(index);
+        extents[dim] = std::max(extents[dim], index);
+      }
+      if (storage == Block::symmetric_matrix)
+      { extents[0] = extents[1] = std::max(extents[0], extents[1]); }
+      if (!element_count(extents, rank, size)) throw_bad_line(*line);
+      values.push_back(to<T>((*line)[rank]));
+    }
+
+    std::vector<size_type> dims(extents, extents + rank);
+    if (values.empty()) size = 0;
+
+    std::vector<T> data(size, T());
+    std::vector<bool> is_set(storage == Block::symmetric_matrix ? size : 0);
+    for (size_type i = 0; i < values.size(); ++i)
+    {
+      const size_type* idx = &indices[i * rank];
+      size_type offset = idx[0] - 1;
+      for (size_type dim = 1; dim < rank; ++dim)
+      { offset = offset * extents[dim] + (idx[dim] - 1); }
+      data[offset] = values[i];
+
+      if (storage == Block::symmetric_matrix)
+      {
+        is_set[offset] = true;
+        const size_type mirror = (idx[1] - 1) * extents[1] + (idx[0] - 1);
+        if (!is_set[mirror]) data[mirror] = values[i];
+      }
+    }
+
+    data_.swap(data);
+    extents_.swap(dims);
+    block_ = &block;
+    rank_ = rank;
+    storage_ = storage;
+    block_size_ = block.size();
+    generation_ = block.generation_.value();
+  }
+
+  /**
+   * \brief Creates the %Matrix again if its Block was modified.
+   * \return true if the %Matrix was created again.
+   *
+   * The Block must still exist. Only the modifications of the Block
+   * that change its size or invalidate KeyHandles are noticed.
+   */
+  bool
+  update()
+  {
+    if (block_ == 0 || (block_->generation_.value() == generation_ &&
+                        block_->size() == block_size_)) return false;
+    assign(*block_, rank_, storage_);
+    return true;
+  }
+
+  // element access
+  /**
+   * \brief Accesses an element of a %Matrix of rank 1.
+   * \param i Index (starting at 1) of the element.
+   * \return Read-only (constant) reference to the element.
+   *
+   * The index is not checked, use at() for checked access.
+   */
+  const_reference
+  operator()(size_type i) const
+  { return data_[i - 1]; }
+
+  /**
+   * \brief Accesses an element of a %Matrix of rank 2.
+   * \param i Row (starting at 1) of the element.
+   * \param j Column (starting at 1) of the element.
+   * \return Read-only (constant) reference to the element.
+   *
+   * The indices are not checked, use at() for checked access.
+   */
+  const_reference
+  operator()(size_type i, size_type j) const
+  { return data_[(i - 1) * extents_[1] + (j - 1)]; }
+
+  /**
+   * \brief Accesses an element of a %Matrix of rank 3.
+   * \param i First index (starting at 1) of the element.
+   * \param j Second index (starting at 1) of the element.
+   * \param k Third index (starting at 1) of the element.
+   * \return Read-only (constant) reference to the element.
+   *
+   * The indices are not checked, use at() for checked access.
+   */
+  const_reference
+  operator()(size_type i, size_type j, size_type k) const
+  { return data_[((i - 1) * extents_[1] + (j - 1)) * extents_[2] + (k - 1)]; }
+
+  /**
+   * \brief Accesses an element of the %Matrix with bounds checking.
+   * \param i First index (starting at 1) of the element.
+   * \param j Second index (starting at 1) of the element, only used if
+   *   rank() is at least 2.
+   * \param k Third index (starting at 1) of the element, only used if
+   *   rank() is 3.
+   * \return Read-only (constant) reference to the element.
+   * \throw std::out_of_range If the number of given indices is not
+   *   rank() or an index is not in [1, extent()].
+   */
+  const_reference
+  at(size_type i, size_type j = 0, size_type k = 0) const
+  {
+    const size_type idx[3] = {i, j, k};
+    size_type offset = 0;
+    for (size_type dim = 0; dim < 3; ++dim)
+    {
+      if (dim < rank_ ? (idx[dim] < 1 || idx[dim] > extents_[dim])
+                      : idx[dim] != 0)
+      {
+        throw std::out_of_range("SLHAea::Matrix::at(" + to_string(i) +
+          "," + to_string(j) + "," + to_string(k) + ")");
+      }
+      if (dim < rank_) offset = offset * extents_[dim] + (idx[dim] - 1);
+    }
+    return data_[offset];
+  }
+
+  /**
+   * Returns a pointer to the first element of the contiguous,
+   * row-major array of elements.
+   */
+  const_pointer
+  data() const
+  { return data_.empty() ? 0 : &data_[0]; }
+
+  // iterators
+  /** Returns a const iterator to the first element in row-major order. */
+  const_iterator
+  begin() const
+  { return data_.begin(); }
+
+  /** Returns a const iterator to one past the last element. */
+  const_iterator
+  end() const
+  { return data_.end(); }
+
+  // introspection
+  /** Returns the number of indices of each element. */
+  size_type
+  rank() const
+  { return rank_; }
+
+  /**
+   * \brief Returns the number of elements in a dimension.
+   * \param dim Dimension (starting at 0), which must be less than
+   *   rank().
+   */
+  size_type
+  extent(size_type dim) const
+  { return extents_[dim]; }
+
+  /** Returns the number of rows (the extent of dimension 0). */
+  size_type
+  rows() const
+  { return rank_ < 1 ? 0 : extents_[0]; }
+
+  /** Returns the number of columns (the extent of dimension 1). */
+  size_type
+  cols() const
+  { return rank_ < 2 ? 1 : extents_[1]; }
+
+  /** Returns the total number of elements. */
+  size_type
+  size() const
+  { return data_.size(); }
+
+  /** Returns true if the %Matrix has no elements. */
+  bool
+  empty() const
+  { return data_.empty(); }
+
+private:
+  /**
+   * Stores the product of the first \p rank \p extents in \p size.
+   * Returns false if the product exceeds max_elements or max_size()
+   * of the element vector.
+   */
+  static bool
+  element_count(const size_type* extents, size_type rank, size_type& size)
+  {
+    const size_type limit =
+      std::min<size_type>(max_elements, std::vector<T>().max_size());
+    size = 1;
+    for (size_type dim = 0; dim < rank; ++dim)
+    {
+      if (extents[dim] > limit / size) return false;
+      size *= extents[dim];
+    }
+    return true;
+  }
+
+  static void
+  throw_bad_line(const Line& line)
+  { throw std::invalid_argument("SLHAea::Matrix::assign(‘" + line.str() + "’)"); }
+
+private:
+  std::vector<T> data_;
+  std::vector<size_type> extents_;
+  const Block* block_;
+  size_type rank_;
+  Block::matrix_storage storage_;
+  Block::size_type block_size_;
+  unsigned long generation_;
+};
+
+
+template<class T> const typename Matrix<T>::size_type
+Matrix<T>::max_elements;
+
+template<class T> inline Matrix<T>
+Block::as_matrix(size_type rank, matrix_storage storage) const
+{ return Matrix<T>(*this, rank, storage); }
+
+
+/**
+ * Container of Blocks that resembles a complete SLHA structure.
+ * This class is a container of Blocks that resembles a complete SLHA
+ * structure. Its name is an abbreviation of "collection" since it is
+ * a collection of Blocks. The elements of %Coll objects can be
+ * accessed via their names (which are always compared
+ * case-insensitive) with the operator[]() and at() functions and
+ * access to single fields, Lines and Blocks via the Key type is
+ * provided by the field(), line() and block() functions. To fill this
+ * container, the functions read() or str() can be used which read
+ * data from an input stream or a string, respectively.
+ *
+ * Const member functions do not modify a %Coll unless it was read
+ * with read_lazy, in which case the Blocks are parsed on first
+ * access, or its index of Block names is enabled with use_index(),
+ * which lookups build and rebuild. Such a %Coll must not be read from
+ * several threads at the same time.
+ */
+class Coll
+{
+private:
+  typedef std::deque<Block> impl_type;
+
+public:
+  typedef std::string                       key_type;
+  typedef Block                             value_type;
+  typedef Block&                            reference;
+  typedef const Block&                      const_reference;
+  typedef impl_type::iterator               iterator;
+  typedef impl_type::const_iterator         const_iterator;
+  typedef impl_type::reverse_iterator       reverse_iterator;
+  typedef impl_type::const_reverse_iterator const_reverse_iterator;
+  typedef impl_type::pointer                pointer;
+  typedef impl_type::const_pointer          const_pointer;
+  typedef impl_type::difference_type        difference_type;
+  typedef impl_type::size_type              size_type;
+
+  /**
+   * Flags that select how read(const char*, const char*, int) and
+   * read_file() parse their input. Flags can be combined with \c |.
+   */
+  enum read_flags
+  {
+    /** Parse all lines in the calling thread. */
+    read_default  = 0,
+
+    /**
+     * Split the input at block definitions and parse the parts on
+     * all available hardware threads. The resulting %Coll is the
+     * same as with read_default. This flag has no effect if SLHAea
+     * is compiled without C++11 or with SLHAEA_NO_THREADS defined.
+     */
+    read_parallel = 1,
+
+    /**
+     * Locate only the block definitions and defer parsing the lines
+     * of every Block until it is accessed for the first time. Blocks
+     * that are never accessed are written verbatim by operator<<().
+     * The Blocks share the input (a copy of it or the mapped file),
+     * which is released with the last of them. Since accessing such
+     * a Block modifies it, also through a const reference, it must
+     * not be accessed from several threads at the same time until it
+     * has been accessed once. This flag overrides read_parallel.
+     */
+    read_lazy     = 2,
+
+    /**
+     * Keep the original text of every Line, so that Lines that are
+     * not modified are written exactly as they were read (including
+     * tabs, trailing blanks and carriage returns). This makes writing
+     * back a %Coll in which only a few fields were changed almost as
+     * fast as copying the input. See Line for which functions discard
+     * the original text.
+     */
+    read_verbatim = 4
+  };
+
+  // NOTE: The compiler-generated copy constructor and assignment
+  //   operator for this class are just fine, so we don't need to
+  //   write our own.
+
+  /** Constructs an empty %Coll. */
+  Coll()
+    : impl_(), index_(), index_valid_(false), use_index_(false),
+      generation_() {}
+
+  /**
+   * \brief Constructs a %Coll with content from an input stream.
+   * \param is Input stream to read content from.
+   * \sa read()
+   */
+  explicit
+  Coll(std::istream& is)
+    : impl_(), index_(), index_valid_(false), use_index_(false),
+      generation_()
+  { read(is); }
+
+  /**
+   * \brief Constructs a %Coll with content from a string.
+   * \param coll String to read content from.
+   */
+  static Coll
+  from_str(const std::string& coll)
+  {
+    Coll result;
+    result.read(coll.data(), coll.data() + coll.length());
+    return result;
+  }
+
+  /**
+   * \brief Assigns content from an input stream to the %Coll.
+   * \param is Input stream to read content from.
+   * \returns Reference to \c *this.
+   *
+   * This function reads non-empty lines from \p is, transforms them
+   * into Lines, which are collected into the corresponding Blocks
+   * that are added to the %Coll.
+   */
+  Coll&
+  read(std::istream& is)
+  {
+    std::string line_str;
+    Line line;
+
+    const size_type orig_size = size();
+    pointer block = push_back_named_block("");
+
+    while (std::getline(is, line_str))
+    {
+      line.str(line_str);
+      if (line.empty()) continue;
+
+      if (line.is_block_def())
+      {
+        block->shrink_to_fit();
+        block = push_back_named_block(line.block_name());
+      }
+      block->push_back(line);
+    }
+
+    block->shrink_to_fit();
+    erase_if_empty("", orig_size);
+    return *this;
+  }
+
+  /**
+   * \brief Assigns content from a character range to the %Coll.
+   * \param first, last Pointers to the initial and final positions
+   *   of the characters that are read.
+   * \param flags Combination of read_flags.
+   * \returns Reference to \c *this.
+   *
+   * This function is equivalent to read(std::istream&) but parses the
+   * lines directly from the provided buffer.
+   */
+  Coll&
+  read(const char* first, const char* last, int flags = read_default)
+  {
+    const bool verbatim = (flags & read_verbatim) != 0;
+    if (flags & read_lazy)
+    {
+      // The Blocks may outlive the provided buffer, so they refer to
+      // a copy of it.
+      const boost::shared_ptr<const std::string>
+        copy(new std::string(first, last));
+      return read_lazily(copy, copy->data(), copy->data() + copy->length(),
+                         verbatim);
+    }
+#ifdef SLHAEA_THREADS
+    if (flags & read_parallel) return read_in_parallel(first, last, flags);
+#endif
+    detail::char_scanner scanner(first, last);
+    Line line;
+
+    const size_type orig_size = size();
+    pointer block = push_back_named_block("");
+
+    for (const char* pos = first; pos != last;)
+    {
+      pos = line.parse(scanner, pos, verbatim);
+      if (line.empty()) continue;
+
+      if (line.is_block_def())
+      {
+        block->shrink_to_fit();
+        block = push_back_named_block(line.block_name());
+      }
+      block->push_back(line);
+    }
+
+    block->shrink_to_fit();
+    erase_if_empty("", orig_size);
+    return *this;
+  }
+
+  /**
+   * \brief Assigns content from a file to the %Coll.
+   * \param path Path of the file to read content from.
+   * \param flags Combination of read_flags.
+   * \returns Reference to \c *this.
+   * \throw std::runtime_error If the file cannot be opened.
+   *
+   * This function is equivalent to read(std::istream&) with an input
+   * file stream for \p path. On POSIX systems the file is mapped into
+   * memory and parsed without a stream in between. The mapping is
+   * released before this function returns, or with the last Block
+   * that refers to it if \p flags contains read_lazy.
+   */
+  Coll&
+  read_file(const std::string& path, int flags = read_default)
+  {
+    const boost::shared_ptr<const detail::mapped_file>
+      file(new detail::mapped_file(path));
+    if (!file->is_open())
+    { throw std::runtime_error("SLHAea::Coll::read_file(‘" + path + "’)"); }
+
+    if (flags & read_lazy)
+    {
+      return read_lazily(file, file->begin(), file->end(),
+                         (flags & read_verbatim) != 0);
+    }
+    return read(file->begin(), file->end(), flags);
+  }
+
+  /**
+   * \brief Adds selected Blocks from a character range to the %Coll.
+   * \param first, last Pointers to the initial and final positions
+   *   of the characters that are read.
+   * \param pred Unary predicate that is called with the block
+   *   definition (a Line) of every Block in the range.
+   * \returns Reference to \c *this.
+   *
+   * This function is equivalent to read(const char*, const char*, int)
+   * except that it only adds the Blocks whose block definition
+   * satisfies \p pred. Lines of other Blocks and lines that precede
+   * the first block definition are skipped without being parsed. For
+   * example, Block::key_matches can be used as \p pred to select
+   * Blocks by the first fields of their block definition.
+   */
+  template<class Predicate>
+  typename boost::disable_if<boost::is_convertible<Predicate, int>,
+                             Coll&>::type
+  read(const char* first, const char* last, Predicate pred)
+  {
+    predicate_filter<Predicate> filter(pred);
+    return read_filtered(first, last, filter);
+  }
+
+  /**
+   * \brief Adds selected Blocks from a character range to the %Coll.
+   * \param first, last Pointers to the initial and final positions
+   *   of the characters that are read.
+   * \param blockNames Names of the Blocks that are added.
+   * \returns Reference to \c *this.
+   *
+   * This function is equivalent to read(const char*, const char*,
+   * Predicate) with a predicate that selects the Blocks whose names
+   * are in \p blockNames (compared case-insensitive, see
+   * key_matches). Only the first Block with each of the names is
+   * added and reading stops as soon as all of them have been found.
+   */
+  Coll&
+  read(const char* first, const char* last,
+       const std::vector<key_type>& blockNames)
+  {
+    names_filter filter(blockNames);
+    return read_filtered(first, last, filter);
+  }
+
+  /**
+   * \brief Adds selected Blocks from a file to the %Coll.
+   * \param path Path of the file to read content from.
+   * \param pred Unary predicate that is called with the block
+   *   definition (a Line) of every Block in the file.
+   * \returns Reference to \c *this.
+   * \throw std::runtime_error If the file cannot be opened.
+   * \sa read(const char*, const char*, Predicate)
+   */
+  template<class Predicate>
+  typename boost::disable_if<boost::is_convertible<Predicate, int>,
+                             Coll&>::type
+  read_file(const std::string& path, Predicate pred)
+  {
+    const detail::mapped_file file(path);
+    if (!file.is_open())
+    { throw std::runtime_error("SLHAea::Coll::read_file(‘" + path + "’)"); }
+
+    return read(file.begin(), file.end(), pred);
+  }
+
+  /**
+   * \brief Adds selected Blocks from a file to the %Coll.
+   * \param path Path of the file to read content from.
+   * \param blockNames Names of the Blocks that are added.
+   * \returns Reference to \c *this.
+   * \throw std::runtime_error If the file cannot be opened.
+   * \sa read(const char*, const char*, const std::vector<key_type>&)
+   */
+  Coll&
+  read_file(const std::string& path, const std::vector<key_type>& blockNames)
+  {
+    const detail::mapped_file file(path);
+    if (!file.is_open())
+    { throw std::runtime_error("SLHAea::Coll::read_file(‘" + path + "’)"); }
+
+    return read(file.begin(), file.end(), blockNames);
+  }
+
+  /**
+   * \brief Assigns content from a string to the %Coll.
+   * \param coll String that is used as content for the %Coll.
+   * \returns Reference to \c *this.
+   */
+  Coll&
+  str(const std::string& coll)
+  {
+    clear();
+    return read(coll.data(), coll.data() + coll.length());
+  }
+
+  /** Returns a string representation of the %Coll. */
+  std::string
+  str() const
+  {
+    std::string result;
+    detail::append_formatted(result, *this);
+    return result;
+  }
+
+  /**
+   * Returns the number of characters of str() const. This writes the
+   * whole %Coll once without storing it, so it is only worth calling
+   * if the exact size is needed in advance.
+   */
+  std::size_t
+  formatted_length() const
+  {
+    detail::length_sink sink;
+    return write_to(sink).length();
+  }
+
+  /**
+   * \brief Appends the string representation of the %Coll to a
+   *   string.
+   * \param str String to which the %Coll is appended.
+   * \return Reference to \p str.
+   *
+   * The %Coll is written in one pass directly into \p str. Reusing
+   * \p str for several %Colls avoids allocating the output buffer
+   * again for each of them, and writing it with a single call of
+   * std::fwrite() or std::ostream::write() is the fastest way to
+   * output a %Coll.
+   */
+  std::string&
+  append_to(std::string& str) const
+  { return detail::append_formatted(str, *this); }
+
+  /**
+   * \brief Writes the string representation of the %Coll to a sink.
+   * \param sink Object with a member function
+   *   <tt>append(const char*, std::size_t)</tt> (like std::string)
+   *   that the characters are passed to.
+   * \return Reference to \p sink.
+   *
+   * All Blocks are written in one pass with Block::write_to().
+   */
+  template<class Sink> Sink&
+  write_to(Sink& sink) const
+  {
+    for (impl_type::const_iterator block = impl_.begin();
+         block != impl_.end(); ++block) block->write_to(sink);
+    return sink;
+  }
+
+  // element access
+  /**
+   * \brief Locates a Block in the %Coll.
+   * \param blockName Name of the Block to be located.
+   * \return Read/write reference to sought-after Block.
+   *
+   * This function locates the first Block whose name equals
+   * \p blockName. If no such Block is present, an empty Block with
+   * this name is added to the end of the %Coll and a reference to it
+   * is then returned.
+   */
+  reference
+  operator[](const key_type& blockName)
+  {
+    iterator block = find(blockName);
+    if (block != end()) return *block;
+
+    push_back(value_type(blockName));
+    return back();
+  }
+
+  /**
+   * \brief Locates a Block in the %Coll.
+   * \param blockName Name of the Block to be located.
+   * \return Read/write reference to sought-after Block.
+   * \throw std::out_of_range If no Block with the name \p blockName
+   *   exists.
+   */
+  reference
+  at(const key_type& blockName)
+  {
+    iterator block = find(blockName);
+    if (block != end()) return *block;
+
+    throw std::out_of_range("SLHAea::Coll::at(‘" + blockName + "’)");
+  }
+
+  /**
+   * \brief Locates a Block in the %Coll.
+   * \param blockName Name of the Block to be located.
+   * \return Read-only (constant) reference to sought-after Block.
+   * \throw std::out_of_range If no Block with the name \p blockName
+   *   exists.
+   */
+  const_reference
+  at(const key_type& blockName) const
+  {
+    const_iterator block = find(blockName);
+    if (block != end()) return *block;
+
+    throw std::out_of_range("SLHAea::Coll::at(‘" + blockName + "’)");
+  }
+
+  /**
+   * \brief Locates a Block in the %Coll.
+   * \param key First strings of the block definition of the Block
+   *   to be located.
+   * \return Read/write reference to sought-after Block.
+   * \throw std::out_of_range If \p key does not match any block
+   *   definition.
+   *
+   * This functions takes a vector of strings and locates the Block
+   * whose first strings of the block definition are equal to the
+   * strings in \p key. If no such Block exists, \c std::out_of_range
+   * is thrown.
+   */
+  reference
+  at(const value_type::key_type& key)
+  {
+    iterator block = find(key);
+    if (block != end()) return *block;
+
+    throw std::out_of_range(
+      "SLHAea::Coll::at(‘" + boost::join(key, ",") + "’)");
+  }
+
+  /**
+   * \brief Locates a Block in the %Coll.
+   * \param key First strings of the block definition of the Block
+   *   to be located.
+   * \return Read-only (constant) reference to sought-after Block.
+   * \throw std::out_of_range If \p key does not match any block
+   *   definition.
+   *
+   * This functions takes a vector of strings and locates the Block
+   * whose first strings of the block definition are equal to the
+   * strings in \p key. If no such Block exists, \c std::out_of_range
+   * is thrown.
+   */
+  const_reference
+  at(const value_type::key_type& key) const
+  {
+    const_iterator block = find(key);
+    if (block != end()) return *block;
+
+    throw std::out_of_range(
+      "SLHAea::Coll::at(‘" + boost::join(key, ",") + "’)");
+  }
+
+  /**
+   * Returns a read/write reference to the first element of the %Coll.
+   */
+  reference
+  front()
+  { return impl_.front(); }
+
+  /**
+   * Returns a read-only (constant) reference to the first element of
+   * the %Coll.
+   */
+  const_reference
+  front() const
+  { return impl_.front(); }
+
+  /**
+   * Returns a read/write reference to the last element of the %Coll.
+   */
+  reference
+  back()
+  { return impl_.back(); }
+
+  /**
+   * Returns a read-only (constant) reference to the last element of
+   * the %Coll.
+   */
+  const_reference
+  back() const
+  { return impl_.back(); }
+
+  // (nested) element access via Key
+  /**
+   * \brief Accesses a Block in the %Coll.
+   * \param key Key that refers to the Block that should be accessed.
+   * \return Read/write reference to the Block referred to by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing
+   *   Block.
+   */
+  reference
+  block(const Key& key);
+
+  /**
+   * \brief Accesses a Block in the %Coll.
+   * \param key Key that refers to the Block that should be accessed.
+   * \return Read-only (constant) reference to the Block referred to
+   *   by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing
+   *   Block.
+   */
+  const_reference
+  block(const Key& key) const;
+
+  /**
+   * \brief Accesses a single Line in the %Coll.
+   * \param key Key that refers to the Line that should be accessed.
+   * \return Read/write reference to the Line referred to by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing Line.
+   */
+  Block::reference
+  line(const Key& key);
+
+  /**
+   * \brief Accesses a single Line in the %Coll.
+   * \param key Key that refers to the Line that should be accessed.
+   * \return Read-only (constant) reference to the Line referred to by
+   *   \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing Line.
+   */
+  Block::const_reference
+  line(const Key& key) const;
+
+  /**
+   * \brief Accesses a single field in the %Coll.
+   * \param key Key that refers to the field that should be accessed.
+   * \return Read/write reference to the field referred to by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing
+   *   field.
+   */
+  Line::reference
+  field(const Key& key);
+
+  /**
+   * \brief Accesses a single field in the %Coll.
+   * \param key Key that refers to the field that should be accessed.
+   * \return Read-only (constant) reference to the field referred to
+   *   by \p key.
+   * \throw std::out_of_range If \p key refers to a non-existing
+   *   field.
+   */
+  Line::const_reference
+  field(const Key& key) const;
+
+  /**
+   * \brief Accesses many fields in the %Coll at once.
+   * \param keys Keys that refer to the fields that should be accessed.
+   * \param result Output iterator to which the results are written.
+   * \return Iterator pointing to one past the last written element.
+   *
+   * For each Key in \p keys, this function writes a read-only pointer
+   * to the field that field(const Key&) const would return to
+   * \p result, or a null pointer if the Key refers to a non-existing
+   * field. The results are written in the order of \p keys. The Keys
+   * are grouped by Block and the Lines of each Block are visited at
+   * most once, so that the cost is proportional to the size of the
+   * %Coll and not to the number of Keys times its size.
+   */
+  template<class OutputIterator> OutputIterator
+  fields(const std::vector<Key>& keys, OutputIterator result) const
+  {
+    std::vector<Line::const_pointer> found;
+    find_fields(keys, found);
+    return std::copy(found.begin(), found.end(), result);
+  }
+
+  /**
+   * \brief Converts many fields in the %Coll at once.
+   * \param keys Keys that refer to the fields that should be converted.
+   * \param result Output iterator to which the results are written.
+   * \return Iterator pointing to one past the last written element.
+   *
+   * This function looks up the fields like fields() and writes for
+   * each Key in \p keys a \c boost::optional<T> to \p result that
+   * contains the field converted to \c T by to(), or nothing if the
+   * Key refers to a non-existing field or if the conversion fails.
+   */
+  template<class T, class OutputIterator> OutputIterator
+  get_many(const std::vector<Key>& keys, OutputIterator result) const
+  {
+    std::vector<Line::const_pointer> found;
+    find_fields(keys, found);
+    for (std::size_t i = 0; i < found.size(); ++i, ++result)
+    {
+      boost::optional<T> value;
+      if (found[i])
+      {
+        try { value = to<T>(*found[i]); }
+        catch (const boost::bad_lexical_cast&) {}
+      }
+      *result = value;
+    }
+    return result;
+  }
+
+  // iterators
+  /**
+   * Returns a read/write iterator that points to the first element in
+   * the %Coll. Iteration is done in ordinary element order.
+   */
+  iterator
+  begin()
+  { return impl_.begin(); }
+
+  /**
+   * Returns a read-only (constant) iterator that points to the first
+   * element in the %Coll. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  begin() const
+  { return impl_.begin(); }
+
+  /**
+   * Returns a read-only (constant) iterator that points to the first
+   * element in the %Coll. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  cbegin() const
+  { return impl_.begin(); }
+
+  /**
+   * Returns a read/write iterator that points one past the last
+   * element in the %Coll. Iteration is done in ordinary element
+   * order.
+   */
+  iterator
+  end()
+  { return impl_.end(); }
+
+  /**
+   * Returns a read-only (constant) iterator that points one past the
+   * last element in the %Coll. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  end() const
+  { return impl_.end(); }
+
+  /**
+   * Returns a read-only (constant) iterator that points one past the
+   * last element in the %Coll. Iteration is done in ordinary element
+   * order.
+   */
+  const_iterator
+  cend() const
+  { return impl_.end(); }
+
+  /**
+   * Returns a read/write reverse iterator that points to the last
+   * element in the %Coll. Iteration is done in reverse element order.
+   */
+  reverse_iterator
+  rbegin()
+  { return impl_.rbegin(); }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * the last element in the %Coll. Iteration is done in reverse
+   * element order.
+   */
+  const_reverse_iterator
+  rbegin() const
+  { return impl_.rbegin(); }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * the last element in the %Coll. Iteration is done in reverse
+   * element order.
+   */
+  const_reverse_iterator
+  crbegin() const
+  { return impl_.rbegin(); }
+
+  /**
+   * Returns a read/write reverse iterator that points to one before
+   * the first element in the %Coll. Iteration is done in reverse
+   * element order.
+   */
+  reverse_iterator
+  rend()
+  { return impl_.rend(); }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * one before the first element in the %Coll. Iteration is done in
+   * reverse element order.
+   */
+  const_reverse_iterator
+  rend() const
+  { return impl_.rend(); }
+
+  /**
+   * Returns a read-only (constant) reverse iterator that points to
+   * one before the first element in the %Coll. Iteration is done in
+   * reverse element order.
+   */
+  const_reverse_iterator
+  crend() const
+  { return impl_.rend(); }
+
+  // lookup
+  /**
+   * \brief Tries to locate a Block in the %Coll.
+   * \param blockName Name of the Block to be located.
+   * \return Read/write iterator pointing to sought-after element, or
+   *   end() if not found.
+   *
+   * This function takes a key and tries to locate the Block whose
+   * name matches \p blockName. If successful the function returns a
+   * read/write iterator pointing to the sought after Block. If
+   * unsuccessful it returns end().
+   */
+  iterator
+  find(const key_type& blockName)
+  {
+    if (use_index_) return begin() + find_in_index(blockName);
+    return std::find_if(begin(), end(), key_matches(blockName));
+  }
+
+  /**
+   * \brief Tries to locate a Block in the %Coll.
+   * \param blockName Name of the Block to be located.
+   * \return Read-only (constant) iterator pointing to sought-after
+   *   element, or end() const if not found.
+   *
+   * This function takes a key and tries to locate the Block whose
+   * name matches \p blockName. If successful the function returns a
+   * read-only (constant) iterator pointing to the sought after Block.
+   * If unsuccessful it returns end() const.
+   */
+  const_iterator
+  find(const key_type& blockName) const
+  {
+    if (use_index_) return begin() + find_in_index(blockName);
+    return std::find_if(begin(), end(), key_matches(blockName));
+  }
+
+  /**
+   * \brief Tries to locate a Block in a range.
+   * \param first, last Input iterators to the initial and final
+   *   positions in a sequence.
+   * \param blockName Name of the Block to be located.
+   * \return Iterator pointing to sought-after element, or \p last if
+   *   not found.
+   *
+   * This function tries to locate in the range [\p first, \p last)
+   * the Block whose name matches \p blockName. If successful the
+   * function returns an iterator pointing to the sought after Block.
+   * If unsuccessful it returns \p last.
+   */
+  template<class InputIterator> static InputIterator
+  find(InputIterator first, InputIterator last, const key_type& blockName)
+  { return std::find_if(first, last, key_matches(blockName)); }
+
+  /**
+   * \brief Tries to locate a Block in the %Coll.
+   * \param key First strings of the block definition of the Block
+   *   to be located.
+   * \return Read/write iterator pointing to sought-after element, or
+   *   end() if not found.
+   *
+   * This functions takes a vector of strings and tries to locate the
+   * Block whose first strings of the block definition are equal to
+   * the strings in \p key. If successful the function returns a
+   * read/write iterator pointing to the sought after Block. If
+   * unsuccessful it returns end().
+   */
+  iterator
+  find(const value_type::key_type& key)
+  { return std::find_if(begin(), end(), key_matches_block_def(key)); }
+
+  /**
+   * \brief Tries to locate a Block in the %Coll.
+   * \param key First strings of the block definition of the Block
+   *   to be located.
+   * \return Read-only (constant) iterator pointing to sought-after
+   *   element, or end() const if not found.
+   *
+   * This functions takes a vector of strings and tries to locate the
+   * Block whose first strings of the block definition are equal to
+   * the strings in \p key. If successful the function returns a
+   * read-only (constant) iterator pointing to the sought after Block.
+   * If unsuccessful it returns end() const.
+   */
+  const_iterator
+  find(const value_type::key_type& key) const
+  { return std::find_if(begin(), end(), key_matches_block_def(key)); }
+
+  /**
+   * \brief Tries to locate a Block in a range.
+   * \param first, last Input iterators to the initial and final
+   *   positions in a sequence.
+   * \param key First strings of the block definition of the Block
+   *   to be located.
+   * \return Iterator pointing to sought-after element, or \p last if
+   *   not found.
+   *
+   * This function tries to locate in the range [\p first, \p last)
+   * the Block whose first strings of the block definition are equal
+   * to the strings in \p key. If successful the function returns an
+   * iterator pointing to the sought after Block. If unsuccessful it
+   * returns \p last.
+   */
+  template<class InputIterator> static InputIterator
+  find(InputIterator first, InputIterator last,
+       const value_type::key_type& key)
+  { return std::find_if(first, last, key_matches_block_def(key)); }
+
+  // introspection
+  /**
+   * \brief Counts all Blocks with a given name.
+   * \param blockName Name of the Blocks that will be counted.
+   * \return Number of blocks whose name equals \p blockName.
+   */
+  size_type
+  count(const key_type& blockName) const
+  {
+    if (use_index_)
+    {
+      if (!index_valid_) build_index();
+      index_type::const_iterator entry = index_.find(blockName);
+      return (entry == index_.end()) ? 0 : entry->second.second;
+    }
+    return std::count_if(begin(), end(), key_matches(blockName));
+  }
+
+  /**
+   * \brief Enables or disables the index of Block names.
+   * \param enable If true, the index is enabled and rebuilt.
+   *
+   * With the index, find(const key_type&) and the functions that use
+   * it (at(), operator[](), count(), block(), line() and field())
+   * look up Blocks by name in constant average time instead of
+   * comparing the names of all Blocks. The index is updated by
+   * push_back() and rebuilt on the next lookup after any other
+   * modification of the %Coll. Changes of the names of Blocks through
+   * references or iterators are not noticed, so after such changes
+   * the index must be rebuilt by calling this function again.
+   *
+   * The index is built and rebuilt by the lookups themselves, also if
+   * they are called on a const %Coll. A %Coll with enabled index must
+   * therefore not be read from several threads at the same time.
+   */
+  void
+  use_index(bool enable = true)
+  {
+    use_index_ = enable;
+    index_valid_ = false;
+    index_.clear();
+  }
+
+  /** Returns true if the index of Block names is enabled. */
+  bool
+  uses_index() const
+  { return use_index_; }
+
+  // capacity
+  /** Returns the number of elements in the %Coll. */
+  size_type
+  size() const
+  { return impl_.size(); }
+
+  /** Returns the size() of the largest possible %Coll. */
+  size_type
+  max_size() const
+  { return impl_.max_size(); }
+
+  /** Returns true if the %Coll is empty. */
+  bool
+  empty() const
+  { return impl_.empty(); }
+
+  // modifiers
+  /**
+   * \brief Adds a Block to the end of the %Coll.
+   * \param block Block to be added.
+   *
+   * This function creates an element at the end of the %Coll and
+   * assigns the given \p block to it.
+   */
+  void
+  push_back(const value_type& block)
+  {
+    impl_.push_back(block);
+    add_to_index(impl_.size() - 1);
+  }
+
+  /**
+   * \brief Adds a Block to the end of the %Coll.
+   * \param blockString String that is used to construct the Block
+   *   that will be added.
+   *
+   * This function creates an element at the end of the %Coll and
+   * assigns the Block that is constructed from \p blockString to it.
+   */
+  void
+  push_back(const std::string& blockString)
+  {
+    value_type block;
+    block.str(blockString);
+    push_back(block);
+  }
+
+  /**
+   * \brief Adds a Block to the begin of the %Coll.
+   * \param block Block to be added.
+   *
+   * This function creates an element at the begin of the %Coll and
+   * assigns the given \p block to it.
+   */
+  void
+  push_front(const value_type& block)
+  {
+    impl_.push_front(block);
+    modified();
+  }
+
+  /**
+   * \brief Adds a Block to the begin of the %Coll.
+   * \param blockString String that is used to construct the Block
+   *   that will be added.
+   *
+   * This function creates an element at the begin of the %Coll and
+   * assigns the Block that is constructed from \p blockString to it.
+   */
+  void
+  push_front(const std::string& blockString)
+  {
+    value_type block;
+    block.str(blockString);
+    push_front(block);
+  }
+
+  /**
+   * Removes the last element. This function shrinks the size() of the
+   * %Coll by one.
+   */
+  void
+  pop_back()
+  {
+    impl_.pop_back();
+    modified();
+  }
+
+  /**
+   * \brief Inserts a Block before given \p position.
+   * \param position Iterator into the %Coll.
+   * \param block Block to be inserted.
+   * \return Iterator pointing to the inserted element.
+   *
+   * This function inserts a copy of \p block before the specified
+   * \p position and thus enlarges the %Coll by one.
+   */
+  iterator
+  insert(iterator position, const value_type& block)
+  {
+    modified();
+    return impl_.insert(position, block);
+  }
+
+  /**
+   * \brief Inserts a range into the %Coll.
+   * \param position Iterator into the %Coll.
+   * \param first, last Input iterators to the initial and final
+   *   positions in a sequence.
+   *
+   * This function inserts copies of the Blocks in the range
+   * [\p first, \p last) into the %Coll before the specified
+   * \p position and thus enlarges the %Coll accordingly.
+   */
+  template<class InputIterator> void
+  insert(iterator position, InputIterator first, InputIterator last)
+  {
+    modified();
+    impl_.insert(position, first, last);
+  }
+
+  /**
+   * \brief Erases element at given \p position.
+   * \param position Iterator pointing to the element to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function erases the element at the given \p position and
+   * thus shortens the %Coll by one.
+   */
+  iterator
+  erase(iterator position)
+  {
+    modified();
+    return impl_.erase(position);
+  }
+
+  /**
+   * \brief Erases a range of elements.
+   * \param first Iterator pointing to the first element to be erased.
+   * \param last Iterator pointing to one past the last element to be
+   *   erased.
+   * \return Iterator pointing to the element pointed to by \p last
+   *   prior to erasing (or end()).
+   *
+   * This function erases the elements in the range [\p first,
+   * \p last) and shortens the %Coll accordingly.
+   */
+  iterator
+  erase(iterator first, iterator last)
+  {
+    modified();
+    return impl_.erase(first, last);
+  }
+
+  /**
+   * \brief Erases first Block with a given name.
+   * \param blockName Name of the Block to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function takes a key and erases the first Block whose name
+   * matches \p blockName. If the %Coll contains such Block, the
+   * function returns an iterator pointing to the next element (or
+   * end()). If no such Block exists, end() is returned.
+   */
+  iterator
+  erase_first(const key_type& blockName)
+  {
+    iterator block = find(blockName);
+    return (block != end()) ? erase(block) : block;
+  }
+
+  /**
+   * \brief Erases last Block with a given name.
+   * \param blockName Name of the Block to be erased.
+   * \return Iterator pointing to the next element (or end()).
+   *
+   * This function takes a key and erases the last Block whose name
+   * matches \p blockName. If the %Coll contains such Block, the
+   * function returns an iterator pointing to the next element (or
+   * end()). If no such Block exists, end() is returned.
+   */
+  iterator
+  erase_last(const key_type& blockName)
+  {
+    reverse_iterator block = find(rbegin(), rend(), blockName);
+    return (block != rend()) ? erase((++block).base()) : end();
+  }
+
+  /**
+   * \brief Erases all Blocks with a given name.
+   * \param blockName Name of the Blocks to be erased.
+   * \return The number of Blocks erased.
+   */
+  size_type
+  erase(const key_type& blockName)
+  {
+    const key_matches pred(blockName);
+    size_type erased_count = 0;
+
+    for (iterator block = begin(); block != end();)
+    {
+      if (pred(*block))
+      {
+        block = erase(block);
+        ++erased_count;
+      }
+      else ++block;
+    }
+    return erased_count;
+  }
+
+  /**
+   * \brief Swaps data with another %Coll.
+   * \param coll %Coll to be swapped with.
+   */
+  void
+  swap(Coll& coll)
+  {
+    impl_.swap(coll.impl_);
+    index_.swap(coll.index_);
+    std::swap(index_valid_, coll.index_valid_);
+    std::swap(use_index_, coll.use_index_);
+    generation_.swap(coll.generation_);
+  }
+
+  /** Erases all the elements in the %Coll. */
+  void
+  clear()
+  {
+    impl_.clear();
+    modified();
+  }
+
+  /**
+   * \brief Reformats all Blocks in the %Coll.
+   * \sa Block::reformat()
+   */
+  void
+  reformat()
+  { std::for_each(begin(), end(), MEM_FN(&value_type::reformat)); }
+
+  /**
+   * \brief Comments all Blocks in the %Coll.
+   * \sa Block::comment()
+   */
+  void
+  comment()
+  { std::for_each(begin(), end(), MEM_FN(&value_type::comment)); }
+
+  /**
+   * \brief Uncomments all Blocks in the %Coll.
+   * \sa Block::uncomment()
+   */
+  void
+  uncomment()
+  { std::for_each(begin(), end(), MEM_FN(&value_type::uncomment)); }
+
+  /**
+   * Unary predicate that checks if a provided name matches the name
+   * of a Block.
+   */
+  struct key_matches
+  {
+    explicit
+    key_matches(const key_type& blockName) : name_(blockName) {}
+
+    bool
+    operator()(const value_type& block) const
+    { return boost::iequals(name_, block.name()); }
+
+    void
+    set_key(const key_type& blockName)
+    { name_ = blockName; }
+
+  private:
+    key_type name_;
+  };
+
+  /**
+   * Unary predicate that checks if a provided key matches the block
+   * definition of a Block.
+   */
+  struct key_matches_block_def
+  {
+    explicit
+    key_matches_block_def(const value_type::key_type& key)
+      : pattern_(key) {}
+
+    bool
+    operator()(const value_type& block) const
+    {
+      // Blocks read with read_lazy are not parsed for this check.
+      if (block.source_) return pattern_(block.impl_.front());
+
+      value_type::const_iterator block_def = block.find_block_def();
+      return (block_def == block.end()) ? false : pattern_(*block_def);
+    }
+
+    void
+    set_key(const value_type::key_type& key)
+    { pattern_ = value_type::key_pattern(key); }
+
+  private:
+    value_type::key_pattern pattern_;
+  };
+
+private:
+  friend class SpectrumReader;
+  friend class KeyHandle;
+
+#ifdef SLHAEA_THREADS
+  Coll&
+  read_in_parallel(const char* first, const char* last, int flags)
+  {
+    const std::size_t length = static_cast<std::size_t>(last - first);
+    const std::size_t threads =
+      std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t max_chunks = std::min(4 * threads,
+      length / min_chunk_length_ + 1);
+
+    // The chunks start at block definitions, so that every chunk can
+    // be read on its own. Only the first chunk may contain lines that
+    // precede the first block definition.
+    std::vector<const char*> bounds(1, first);
+    for (std::size_t i = 1; i < max_chunks; ++i)
+    {
+      const char* pos = std::max(first + i * (length / max_chunks),
+                                 bounds.back());
+      pos = detail::find_next_block_def(pos, first, last);
+      if (pos == last) break;
+      if (pos != bounds.back()) bounds.push_back(pos);
+    }
+    bounds.push_back(last);
+
+    const std::size_t chunks = bounds.size() - 1;
+    std::vector<Coll> parts(chunks);
+    std::vector<std::exception_ptr> errors(chunks);
+    std::atomic<std::size_t> next_chunk(0);
+    const int part_flags = flags & read_verbatim;
+
+    const auto work = [&]()
+    {
+      for (std::size_t i; (i = next_chunk++) < chunks;)
+      {
+        try { parts[i].read(bounds[i], bounds[i+1], part_flags); }
+        catch (...) { errors[i] = std::current_exception(); }
+      }
+    };
+
+    std::vector<std::thread> pool;
+    for (std::size_t i = 1; i < std::min(threads, chunks); ++i)
+    { pool.push_back(std::thread(work)); }
+    work();
+    for (std::size_t i = 0; i < pool.size(); ++i) pool[i].join();
+
+    for (std::size_t i = 0; i < chunks; ++i)
+    { if (errors[i]) std::rethrow_exception(errors[i]); }
+
+    modified();
+    for (std::size_t i = 0; i < chunks; ++i)
+    {
+      impl_.insert(impl_.end(), std::make_move_iterator(parts[i].begin()),
+                   std::make_move_iterator(parts[i].end()));
+    }
+    return *this;
+  }
+#endif
+
+  Coll&
+  read_lazily(const boost::shared_ptr<const void>& source,
+              const char* first, const char* last, bool verbatim)
+  {
+    // Lines that precede the first block definition are parsed right
+    // away, every following Block is only split off.
+    const char* pos = detail::find_next_block_def(first, first, last);
+
+    const size_type orig_size = size();
+    push_back_named_block("")->read_lines(first, pos, verbatim);
+    erase_if_empty("", orig_size);
+
+    detail::char_scanner scanner(first, last);
+    Line block_def;
+
+    while (pos != last)
+    {
+      const char* next = detail::find_next_block_def(pos + 1, first, last);
+      block_def.parse(scanner, pos);
+      push_back_named_block(block_def.block_name())->defer_read(
+        block_def, source, pos, next, verbatim);
+      pos = next;
+    }
+    return *this;
+  }
+
+  /** Filter for read_filtered() that wraps a predicate. */
+  template<class Predicate>
+  struct predicate_filter
+  {
+    explicit
+    predicate_filter(Predicate pred) : pred_(pred) {}
+
+    bool
+    operator()(const Line& block_def)
+    { return pred_(block_def); }
+
+    bool
+    done() const
+    { return false; }
+
+  private:
+    Predicate pred_;
+  };
+
+  /**
+   * Filter for read_filtered() that selects the first Block with
+   * each of the given names.
+   */
+  struct names_filter
+  {
+    explicit
+    names_filter(const std::vector<key_type>& blockNames)
+      : names_(blockNames), remaining_(blockNames.size()) {}
+
+    bool
+    operator()(const Line& block_def)
+    {
+      bool found = false;
+      for (std::size_t i = 0; i < remaining_;)
+      {
+        if (boost::iequals(names_[i], block_def[1]))
+        {
+          // Move the found name behind the names that are left.
+          std::swap(names_[i], names_[--remaining_]);
+          found = true;
+        }
+        else ++i;
+      }
+      return found;
+    }
+
+    bool
+    done() const
+    { return remaining_ == 0; }
+
+  private:
+    std::vector<key_type> names_;
+    std::size_t remaining_;
+  };
+
+  /**
+   * Replaces the content of the %Coll with the lines in [\p first,
+   * \p last) like clear() followed by read(). The existing Blocks and
+   * Lines are overwritten in place, so that their storage is reused.
+   */
+  void
+  assign_reusing(const char* first, const char* last)
+  {
+    detail::char_scanner scanner(first, last);
+    size_type blocks = 0;
+    Block::size_type lines = 0;
+    modified();
+
+    if (impl_.empty()) impl_.push_back(value_type());
+    impl_.front().name_.clear();
+    impl_.front().source_.reset();
+    impl_.front().modified();
+
+    for (const char* pos = first; pos != last;)
+    {
+      // A block definition starts a new Block unless the current
+      // Block is still the empty nameless Block.
+      if (lines != 0 && detail::is_block_def_line(pos, last))
+      {
+        impl_[blocks].impl_.resize(lines);
+        if (++blocks == impl_.size()) impl_.push_back(value_type());
+        impl_[blocks].source_.reset();
+        impl_[blocks].modified();
+        lines = 0;
+      }
+
+      Block::impl_type& block = impl_[blocks].impl_;
+      if (lines == block.size()) block.push_back(Line());
+
+      Line& line = block[lines];
+      pos = line.parse(scanner, pos);
+      if (line.empty()) continue;
+
+      if (lines++ == 0 && line.is_block_def())
+      { impl_[blocks].name_.assign(line.block_name()); }
+    }
+
+    if (lines == 0) impl_.clear();
+    else
+    {
+      impl_[blocks].impl_.resize(lines);
+      impl_.resize(blocks + 1);
+    }
+  }
+
+  template<class Filter> Coll&
+  read_filtered(const char* first, const char* last, Filter& filter)
+  {
+    detail::char_scanner scanner(first, last);
+    Line block_def;
+
+    const char* pos = detail::find_next_block_def(first, first, last);
+    while (pos != last && !filter.done())
+    {
+      const char* next = detail::find_next_block_def(pos + 1, first, last);
+      block_def.parse(scanner, pos);
+      if (filter(block_def))
+      { push_back_named_block(block_def.block_name())->read(pos, next); }
+      pos = next;
+    }
+    return *this;
+  }
+
+  void
+  find_fields(const std::vector<Key>& keys,
+              std::vector<Line::const_pointer>& found) const;
+
+  /**
+   * Invalidates the index and all KeyHandles that refer to Blocks in
+   * the %Coll. This must be called after each modification that may
+   * move Blocks, except for appending Blocks.
+   */
+  void
+  modified()
+  {
+    index_valid_ = false;
+    generation_.increment();
+  }
+
+  /**
+   * Returns the position of the first Block named \p blockName
+   * according to the index, or size() if there is none.
+   */
+  size_type
+  find_in_index(const key_type& blockName) const
+  {
+    if (!index_valid_) build_index();
+    index_type::const_iterator entry = index_.find(blockName);
+    if (entry == index_.end()) return size();
+
+    // Blocks may have been renamed through references since the
+    // index was built.
+    const size_type pos = entry->second.first;
+    if (pos < size() && detail::iequal_to()(impl_[pos].name(), blockName))
+    { return pos; }
+    build_index();
+    entry = index_.find(blockName);
+    return (entry == index_.end()) ? size() : entry->second.first;
+  }
+
+  void
+  build_index() const
+  {
+    index_.clear();
+    index_valid_ = true;
+    for (size_type pos = 0; pos < impl_.size(); ++pos) add_to_index(pos);
+  }
+
+  void
+  add_to_index(size_type pos) const
+  {
+    if (!use_index_ || !index_valid_) return;
+    std::pair<index_type::iterator, bool> entry = index_.insert(
+      std::make_pair(impl_[pos].name(), std::make_pair(pos, size_type(1))));
+    if (!entry.second) ++entry.first->second.second;
+  }
+
+  pointer
+  push_back_named_block(const key_type& blockName)
+  {
+    push_back(value_type(blockName));
+    return &back();
+  }
+
+  iterator
+  erase_if_empty(const key_type& blockName, const size_type& offset = 0)
+  {
+    iterator block = find(begin() + offset, end(), blockName);
+    return (block != end() && block->empty()) ? erase(block) : block;
+  }
+
+private:
+  // Maps case-insensitive Block names to the position of the first
+  // Block with that name and to the number of such Blocks.
+  typedef boost::unordered_map<key_type, std::pair<size_type, size_type>,
+                               detail::ihash, detail::iequal_to> index_type;
+
+  impl_type impl_;
+  mutable index_type index_;
+  mutable bool index_valid_;
+  bool use_index_;
+  detail::generation_counter generation_;
+  static const std::size_t min_chunk_length_ = 16384;
+};
+
+
+/**
+ * Reference to a single field in a SLHA structure.
+ * This data type represents a reference to a single field in a SLHA
+ * structure, but which is independent of any concrete Coll object.
+ * That means that only the keys and the index of the Coll, Block, and
+ * Line containers of the corresponding field are stored. One of the
+ * main purposes of this data type is the conversion to string and
+ * vice versa in a way that the string representation of a %Key can be
+ * used as a single field in a SLHA structure. For example, the string
+ * representation of a %Key that refers to the entry in the first row
+ * and third column of the RVHMIX matrix is \c "RVHMIX;1,3;2". Further
+ * examples are \c "1000022;DECAY;2" which refers to the total decay
+ * width of the lightest neutralino or \c "1000022;(any),2,11,24;0"
+ * which refers to the branching ratio of the decay of the lightest
+ * neutralino into an electron and a W boson.
+ */
+struct Key
+{
+public:
+  /** Name of the Block that contains the field. */
+  Coll::key_type block;
+
+  /** First field(s) of the Line that contains the field. */
+  Block::key_type line;
+
+  /** Index of the field in the Line. */
+  Line::size_type field;
+
+  /**
+   * \brief Constructs a %Key from explicit key values.
+   * \param _block Name of the Block that contains the field.
+   * \param _line First field(s) of the Line that contains the field.
+   * \param _field Index of the field in the Line.
+   */
+  Key(const Coll::key_type& _block,
+      const Block::key_type& _line,
+      const Line::size_type& _field)
+    : block(_block), line(_line), field(_field) {}
+
+  /**
+   * \brief Constructs a %Key from a string.
+   * \param keyString String from which the %Key is constructed.
+   * \sa str()
+   */
+  Key(const std::string& keyString)
+  { str(keyString); }
+
+  /**
+   * \brief Constructs a %Key from a string.
+   * \param keyString String from which the %Key is constructed.
+   * \sa str()
+   */
+  Key(const char* keyString)
+  { str(keyString); }
+
+  /**
+   * \brief Converts a string to a %Key.
+   * \param keyString String that represents a %Key.
+   * \return Reference to \c *this.
+   */
+  Key&
+  str(const std::string& keyString)
+  {
+    std::vector<std::string> keys;
+    boost::split(keys, keyString, boost::is_any_of(";"));
+
+    if (keys.size() != 3)
+    { throw std::invalid_argument("SLHAea::Key::str(‘" + keyString + "’)"); }
+
+    block = keys[0];
+    line.clear();
+    boost::split(line, keys[1], boost::is_any_of(","));
+    field = to<Line::size_type>(keys[2]);
+
+    return *this;
+  }
+
+  /**
+   * \brief Converts a %Key into its string representation.
+   * \return String that represents the %Key.
+   */
+  std::string
+  str() const
+  {
+    std::ostringstream output;
+    output << block << ";" << boost::join(line, ",") << ";" << field;
+    return output.str();
+  }
+};
+
+
+inline Coll::reference
+Coll::block(const Key& key)
+{ return at(key.block); }
+
+inline Coll::const_reference
+Coll::block(const Key& key) const
+{ return at(key.block); }
+
+inline Block::reference
+Coll::line(const Key& key)
+{ return block(key).at(key.line); }
+
+inline Block::const_reference
+Coll::line(const Key& key) const
+{ return block(key).at(key.line); }
+
+inline Line::reference
+Coll::field(const Key& key)
+{ return line(key).at(key.field); }
+
+inline Line::const_reference
+Coll::field(const Key& key) const
+{ return line(key).at(key.field); }
+
+inline void
+Coll::find_fields(const std::vector<Key>& keys,
+                  std::vector<Line::const_pointer>& found) const
+{
+  // Positions in keys grouped by Block name and then by the first
+  // string of the Line key. Keys whose Line key starts with "(any)"
+  // are grouped under "" and compared with every Line.
+  typedef boost::unordered_map<std::string, std::vector<std::size_t>,
+                               detail::ihash, detail::iequal_to> lines_type;
+  typedef boost::unordered_map<key_type, lines_type,
+                               detail::ihash, detail::iequal_to> blocks_type;
+
+  found.assign(keys.size(), 0);
+  blocks_type pending;
+  for (std::size_t i = 0; i < keys.size(); ++i)
+  {
+    const Block::key_type& line_key = keys[i].line;
+    if (line_key.empty()) continue;
+    const std::string& first = line_key.front();
+    pending[keys[i].block][first == "(any)" ? std::string() : first]
+      .push_back(i);
+  }
+
+  for (const_iterator block = begin();
+       block != end() && !pending.empty(); ++block)
+  {
+    blocks_type::iterator lines = pending.find(block->name());
+    if (lines == pending.end()) continue;
+
+    for (Block::const_iterator line = block->begin();
+         line != block->end() && !lines->second.empty(); ++line)
+    {
+      if (line->empty()) continue;
+
+      lines_type::iterator groups[2] =
+        { lines->second.find((*line)[0]), lines->second.find("") };
+      for (int g = 0; g < 2; ++g)
+      {
+        if (groups[g] == lines->second.end()) continue;
+
+        // Each Key is satisfied by the first matching Line only.
+        std::vector<std::size_t>& group = groups[g]->second;
+        for (std::size_t j = 0; j < group.size();)
+        {
+          const Key& key = keys[group[j]];
+          bool matches = key.line.size() <= line->size();
+          for (std::size_t k = 0; matches && k < key.line.size(); ++k)
+          {
+            matches = key.line[k] == "(any)" ||
+              detail::iequal_to()(key.line[k], (*line)[k]);
+          }
+          if (!matches) { ++j; continue; }
+
+          if (key.field < line->size())
+          { found[group[j]] = &(*line)[key.field]; }
+          group[j] = group.back();
+          group.pop_back();
+        }
+        if (group.empty()) lines->second.erase(groups[g]);
+      }
+    }
+    // Only the first Block with a given name is searched.
+    pending.erase(lines);
+  }
+}
+
+
+/**
+ * Key that remembers where it refers to in a Coll.
+ * A %KeyHandle looks up its Key in a Coll on first use, like
+ * Coll::block(), Coll::line() and Coll::field() do on every call, and
+ * remembers the positions of the Block and Line it refers to. Further
+ * accesses use these positions directly. The Key is looked up again
+ * if the handle is used with another Coll or if the Coll or the Block
+ * has been modified in a way that may move Blocks or Lines (appending
+ * Blocks or Lines is not such a modification).
+ *
+ * Changes of Block names or of the first strings of Lines through
+ * references or iterators are not noticed. If the Coll that a handle
+ * was used with is destroyed, reset() must be called before the
+ * handle is used with a Coll that may occupy the same memory.
+ */
+class KeyHandle
+{
+public:
+  /**
+   * \brief Constructs a %KeyHandle that is not yet resolved.
+   * \param key Key that the %KeyHandle refers to.
+   */
+  explicit
+  KeyHandle(const Key& key)
+    : key_(key), coll_(0), block_pos_(0), line_pos_(0),
+      coll_generation_(0), block_generation_(0) {}
+
+  /** Returns the Key that the %KeyHandle refers to. */
+  const Key&
+  key() const
+  { return key_; }
 
-  // introspection
   /**
-   * \brief Counts all Blocks with a given name.
-   * \param blockName Name of the Blocks that will be counted.
-   * \return Number of blocks whose name equals \p blockName.
+   * \brief Accesses the Block the %KeyHandle refers to.
+   * \param coll %Coll that contains the Block.
+   * \return Read/write reference to the Block.
+   * \throw std::out_of_range If key() refers to a non-existing Block
+   *   or Line.
    */
-  size_type
-  count(const key_type& blockName) const
-  { return std::count_if(begin(), end(), key_matches(blockName)); }
+  Coll::reference
+  block(Coll& coll)
+  {
+    resolve(coll);
+    return coll.impl_[block_pos_];
+  }
 
-  // capacity
-  /** Returns the number of elements in the %Coll. */
-  size_type
-  size() const
-  { return impl_.size(); }
+  /**
+   * \brief Accesses the Block the %KeyHandle refers to.
+   * \param coll %Coll that contains the Block.
+   * \return Read-only (constant) reference to the Block.
+   * \throw std::out_of_range If key() refers to a non-existing Block
+   *   or Line.
+   */
+  Coll::const_reference
+  block(const Coll& coll)
+  {
+    resolve(coll);
+    return coll.impl_[block_pos_];
+  }
 
-  /** Returns the size() of the largest possible %Coll. */
-  size_type
-  max_size() const
-  { return impl_.max_size(); }
+  /**
+   * \brief Accesses the Line the %KeyHandle refers to.
+   * \param coll %Coll that contains the Line.
+   * \return Read/write reference to the Line.
+   * \throw std::out_of_range If key() refers to a non-existing Block
+   *   or Line.
+   */
+  Block::reference
+  line(Coll& coll)
+  {
+    // block() must resolve line_pos_ before it is read.
+    Coll::reference b = block(coll);
+    return b.impl_[line_pos_];
+  }
 
-  /** Returns true if the %Coll is empty. */
-  bool
-  empty() const
-  { return impl_.empty(); }
+  /**
+   * \brief Accesses the Line the %KeyHandle refers to.
+   * \param coll %Coll that contains the Line.
+   * \return Read-only (constant) reference to the Line.
+   * \throw std::out_of_range If key() refers to a non-existing Block
+   *   or Line.
+   */
+  Block::const_reference
+  line(const Coll& coll)
+  {
+    Coll::const_reference b = block(coll);
+    return b.impl_[line_pos_];
+  }
 
-  // modifiers
   /**
-   * \brief Adds a Block to the end of the %Coll.
-   * \param block Block to be added.
-   *
-   * This function creates an element at the end of the %Coll and
-   * assigns the given \p block to it.
+   * \brief Accesses the field the %KeyHandle refers to.
+   * \param coll %Coll that contains the field.
+   * \return Read/write reference to the field.
+   * \throw std::out_of_range If key() refers to a non-existing field.
    */
-  void
-  push_back(const value_type& block)
-  { impl_.push_back(block); }
+  Line::reference
+  field(Coll& coll)
+  { return line(coll).at(key_.field); }
 
   /**
-   * \brief Adds a Block to the end of the %Coll.
-   * \param blockString String that is used to construct the Block
-   *   that will be added.
-   *
-   * This function creates an element at the end of the %Coll and
-   * assigns the Block that is constructed from \p blockString to it.
+   * \brief Accesses the field the %KeyHandle refers to.
+   * \param coll %Coll that contains the field.
+   * \return Read-only (constant) reference to the field.
+   * \throw std::out_of_range If key() refers to a non-existing field.
    */
+  Line::const_reference
+  field(const Coll& coll)
+  { return line(coll).at(key_.field); }
+
+  /** Forgets the remembered positions. */
   void
-  push_back(const std::string& blockString)
+  reset()
+  { coll_ = 0; }
+
+private:
+  void
+  resolve(const Coll& coll)
   {
-    value_type block;
-    block.str(blockString);
-    impl_.push_back(block);
+    if (coll_ == &coll && coll.generation_.value() == coll_generation_ &&
+        block_pos_ < coll.impl_.size())
+    {
+      const Block& block = coll.impl_[block_pos_];
+      if (block.generation_.value() == block_generation_ &&
+          line_pos_ < block.impl_.size()) return;
+    }
+
+    coll_ = 0;
+    const Coll::size_type block_pos = coll.find(key_.block) - coll.begin();
+    if (block_pos == coll.size())
+    { throw std::out_of_range("SLHAea::Coll::at(‘" + key_.block + "’)"); }
+
+    const Block& block = coll.impl_[block_pos];
+    const Block::size_type line_pos = block.find(key_.line) - block.begin();
+    if (line_pos == block.size())
+    {
+      throw std::out_of_range(
+        "SLHAea::Block::at(‘" + boost::join(key_.line, ",") + "’)");
+    }
+
+    coll_ = &coll;
+    block_pos_ = block_pos;
+    line_pos_ = line_pos;
+    coll_generation_ = coll.generation_.value();
+    block_generation_ = block.generation_.value();
   }
 
+private:
+  Key key_;
+  const Coll* coll_;
+  Coll::size_type block_pos_;
+  Block::size_type line_pos_;
+  unsigned long coll_generation_;
+  unsigned long block_generation_;
+};
+
+
+/**
+ * Numeric index of the DECAY blocks of a Coll.
+ * A %DecayTable reads all DECAY blocks of a Coll once and stores the
+ * width of every parent particle and its decay channels as numbers:
+ * each channel is its branching ratio and the PDG codes of its
+ * daughters in ascending order. Widths, branching ratios of channels
+ * with a given set of daughters (in any order), the channels with the
+ * largest branching ratios and the sum of the branching ratios of a
+ * parent are then looked up without comparing or converting strings.
+ *
+ * If the Coll contains several DECAY blocks for the same parent, only
+ * the first one is used. The %DecayTable is a copy of the data, later
+ * changes of the Coll are not reflected in it.
+ */
+class DecayTable
+{
+public:
+  typedef std::size_t size_type;
+
   /**
-   * \brief Adds a Block to the begin of the %Coll.
-   * \param block Block to be added.
-   *
-   * This function creates an element at the begin of the %Coll and
-   * assigns the given \p block to it.
+   * Decay channel of a parent particle: its branching ratio and the
+   * PDG codes of its daughters in ascending order.
    */
-  void
-  push_front(const value_type& block)
-  { impl_.push_front(block); }
+  class Channel
+  {
+  public:
+    typedef const int* const_iterator;
+
+    Channel(double br, const_iterator first, const_iterator last)
+      : br_(br), first_(first), last_(last) {}
+
+    /** Returns the branching ratio of the channel. */
+    double
+    br() const
+    { return br_; }
+
+    /** Returns the number of daughters. */
+    size_type
+    nda() const
+    { return static_cast<size_type>(last_ - first_); }
+
+    /** Returns the PDG code of the \p n-th daughter. */
+    int
+    operator[](size_type n) const
+    { return first_[n]; }
+
+    /** Returns an iterator to the first daughter. */
+    const_iterator
+    begin() const
+    { return first_; }
+
+    /** Returns an iterator to one past the last daughter. */
+    const_iterator
+    end() const
+    { return last_; }
+
+  private:
+    double br_;
+    const_iterator first_;
+    const_iterator last_;
+  };
+
+  /** \brief Constructs an empty %DecayTable. */
+  DecayTable() {}
 
   /**
-   * \brief Adds a Block to the begin of the %Coll.
-   * \param blockString String that is used to construct the Block
-   *   that will be added.
+   * \brief Constructs a %DecayTable from the DECAY blocks of a Coll.
+   * \param coll Coll whose DECAY blocks are read.
+   * \throw std::invalid_argument If a DECAY block or decay channel is
+   *   malformed.
+   * \throw boost::bad_lexical_cast If a width or branching ratio
+   *   cannot be converted to double.
+   */
+  explicit
+  DecayTable(const Coll& coll)
+  { read(coll); }
+
+  /**
+   * \brief Replaces the content with the DECAY blocks of a Coll.
+   * \param coll Coll whose DECAY blocks are read.
+   * \throw std::invalid_argument If a DECAY block or decay channel is
+   *   malformed.
+   * \throw boost::bad_lexical_cast If a width or branching ratio
+   *   cannot be converted to double.
    *
-   * This function creates an element at the begin of the %Coll and
-   * assigns the Block that is constructed from \p blockString to it.
+   * A DECAY block is malformed if its PDG code is not an integer. A
+   * decay channel is malformed if its number of daughters is not a
+   * non-negative integer or if fewer daughters than that follow it.
    */
   void
-  push_front(const std::string& blockString)
+  read(const Coll& coll)
   {
-    value_type block;
-    block.str(blockString);
-    impl_.push_front(block);
+    DecayTable table;
+    for (Coll::const_iterator block = coll.begin(); block != coll.end();
+         ++block)
+    { table.read_block(*block); }
+    swap(table);
   }
 
+  // lookup
   /**
-   * Removes the last element. This function shrinks the size() of the
-   * %Coll by one.
+   * \brief Returns the total width of a particle.
+   * \param parent PDG code of the particle.
+   * \throw std::out_of_range If there is no DECAY block for \p parent.
    */
-  void
-  pop_back()
-  { impl_.pop_back(); }
+  double
+  width(int parent) const
+  { return decay_at(parent, "width").width; }
 
   /**
-   * \brief Inserts a Block before given \p position.
-   * \param position Iterator into the %Coll.
-   * \param block Block to be inserted.
-   * \return Iterator pointing to the inserted element.
-   *
-   * This function inserts a copy of \p block before the specified
-   * \p position and thus enlarges the %Coll by one.
+   * \brief Returns the branching ratio of a decay channel.
+   * \param parent PDG code of the decaying particle.
+   * \param daughters PDG codes of the daughters in any order.
+   * \return Sum of the branching ratios of all channels of \p parent
+   *   with exactly these daughters, or zero if there is none.
+   * \throw std::out_of_range If there is no DECAY block for \p parent.
    */
-  iterator
-  insert(iterator position, const value_type& block)
-  { return impl_.insert(position, block); }
+  double
+  br(int parent, const std::vector<int>& daughters) const
+  {
+    std::vector<int> sorted(daughters);
+    std::sort(sorted.begin(), sorted.end());
+    const int* first = sorted.empty() ? 0 : &sorted[0];
+    return sorted_br(parent, first, first + sorted.size());
+  }
 
   /**
-   * \brief Inserts a range into the %Coll.
-   * \param position Iterator into the %Coll.
-   * \param first, last Input iterators to the initial and final
-   *   positions in a sequence.
-   *
-   * This function inserts copies of the Blocks in the range
-   * [\p first, \p last) into the %Coll before the specified
-   * \p position and thus enlarges the %Coll accordingly.
+   * \brief Returns the branching ratio of a two-body decay channel.
+   * \param parent PDG code of the decaying particle.
+   * \param d1, d2 PDG codes of the daughters in any order.
+   * \throw std::out_of_range If there is no DECAY block for \p parent.
    */
-  template<class InputIterator> void
-  insert(iterator position, InputIterator first, InputIterator last)
-  { impl_.insert(position, first, last); }
+  double
+  br(int parent, int d1, int d2) const
+  {
+    int daughters[2] = { std::min(d1, d2), std::max(d1, d2) };
+    return sorted_br(parent, daughters, daughters + 2);
+  }
 
   /**
-   * \brief Erases element at given \p position.
-   * \param position Iterator pointing to the element to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function erases the element at the given \p position and
-   * thus shortens the %Coll by one.
+   * \brief Returns the branching ratio of a three-body decay channel.
+   * \param parent PDG code of the decaying particle.
+   * \param d1, d2, d3 PDG codes of the daughters in any order.
+   * \throw std::out_of_range If there is no DECAY block for \p parent.
    */
-  iterator
-  erase(iterator position)
-  { return impl_.erase(position); }
+  double
+  br(int parent, int d1, int d2, int d3) const
+  {
+    int daughters[3] = { d1, d2, d3 };
+    std::sort(daughters, daughters + 3);
+    return sorted_br(parent, daughters, daughters + 3);
+  }
 
   /**
-   * \brief Erases a range of elements.
-   * \param first Iterator pointing to the first element to be erased.
-   * \param last Iterator pointing to one past the last element to be
-   *   erased.
-   * \return Iterator pointing to the element pointed to by \p last
-   *   prior to erasing (or end()).
-   *
-   * This function erases the elements in the range [\p first,
-   * \p last) and shortens the %Coll accordingly.
+   * \brief Returns the sum of the branching ratios of a particle.
+   * \param parent PDG code of the particle.
+   * \throw std::out_of_range If there is no DECAY block for \p parent.
    */
-  iterator
-  erase(iterator first, iterator last)
-  { return impl_.erase(first, last); }
+  double
+  br_sum(int parent) const
+  { return decay_at(parent, "br_sum").br_sum; }
 
   /**
-   * \brief Erases first Block with a given name.
-   * \param blockName Name of the Block to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function takes a key and erases the first Block whose name
-   * matches \p blockName. If the %Coll contains such Block, the
-   * function returns an iterator pointing to the next element (or
-   * end()). If no such Block exists, end() is returned.
+   * \brief Returns the decay channels with the largest branching
+   *   ratios.
+   * \param parent PDG code of the decaying particle.
+   * \param k Maximal number of channels that are returned.
+   * \return The (at most) \p k channels of \p parent with the largest
+   *   branching ratios in descending order of their branching ratios.
+   *   Channels with equal branching ratios are ordered by their
+   *   number of daughters and then by their daughters.
+   * \throw std::out_of_range If there is no DECAY block for \p parent.
    */
-  iterator
-  erase_first(const key_type& blockName)
+  std::vector<Channel>
+  top_channels(int parent, size_type k) const
   {
-    iterator block = find(blockName);
-    return (block != end()) ? erase(block) : block;
+    const decay& d = decay_at(parent, "top_channels");
+    const int* base = daughters_.empty() ? 0 : &daughters_[0];
+    std::vector<Channel> result;
+    result.reserve(std::min(k, d.last - d.first));
+    for (size_type i = d.first; i < d.last && result.size() < k; ++i)
+    {
+      const channel& c = channels_[by_br_[i]];
+      result.push_back(Channel(c.br, base + c.first, base + c.last));
+    }
+    return result;
   }
 
   /**
-   * \brief Erases last Block with a given name.
-   * \param blockName Name of the Block to be erased.
-   * \return Iterator pointing to the next element (or end()).
-   *
-   * This function takes a key and erases the last Block whose name
-   * matches \p blockName. If the %Coll contains such Block, the
-   * function returns an iterator pointing to the next element (or
-   * end()). If no such Block exists, end() is returned.
+   * \brief Returns the number of decay channels of a particle.
+   * \param parent PDG code of the particle.
+   * \throw std::out_of_range If there is no DECAY block for \p parent.
    */
-  iterator
-  erase_last(const key_type& blockName)
+  size_type
+  channel_count(int parent) const
   {
-    reverse_iterator block = find(rbegin(), rend(), blockName);
-    return (block != rend()) ? erase((++block).base()) : end();
+    const decay& d = decay_at(parent, "channel_count");
+    return d.last - d.first;
   }
 
+  // introspection
   /**
-   * \brief Erases all Blocks with a given name.
-   * \param blockName Name of the Blocks to be erased.
-   * \return The number of Blocks erased.
+   * \brief Counts the DECAY blocks of a particle.
+   * \param parent PDG code of the particle.
+   * \return 1 if the %DecayTable contains \p parent, otherwise 0.
    */
   size_type
-  erase(const key_type& blockName)
+  count(int parent) const
+  { return index_.count(parent); }
+
+  // capacity
+  /** Returns the number of decaying particles in the %DecayTable. */
+  size_type
+  size() const
+  { return decays_.size(); }
+
+  /** Returns true if the %DecayTable contains no particles. */
+  bool
+  empty() const
+  { return decays_.empty(); }
+
+  // modifiers
+  /**
+   * \brief Swaps data with another %DecayTable.
+   * \param table %DecayTable to be swapped with.
+   */
+  void
+  swap(DecayTable& table)
   {
-    const key_matches pred(blockName);
-    size_type erased_count = 0;
+    index_.swap(table.index_);
+    decays_.swap(table.decays_);
+    channels_.swap(table.channels_);
+    by_br_.swap(table.by_br_);
+    daughters_.swap(table.daughters_);
+  }
+
+  /** Erases all particles in the %DecayTable. */
+  void
+  clear()
+  { DecayTable().swap(*this); }
+
+private:
+  // The channels of decays_[i] are channels_[first, last) sorted by
+  // their daughters and by_br_[first, last) holds their positions in
+  // channels_ sorted by descending branching ratios. The daughters of
+  // a channel are daughters_[first, last).
+  struct decay
+  {
+    double width;
+    double br_sum;
+    size_type first;
+    size_type last;
+  };
+
+  struct channel
+  {
+    double br;
+    boost::uint32_t first;
+    boost::uint32_t last;
+  };
+
+  struct daughters_key
+  {
+    const int* first;
+    const int* last;
+  };
+
+  // Orders channels by their number of daughters and then by their
+  // sorted daughters.
+  class daughters_less
+  {
+  public:
+    explicit
+    daughters_less(const std::vector<int>& daughters)
+      : base_(daughters.empty() ? 0 : &daughters[0]) {}
+
+    bool
+    operator()(const channel& a, const channel& b) const
+    { return less(key(a), key(b)); }
+
+    bool
+    operator()(const channel& a, const daughters_key& b) const
+    { return less(key(a), b); }
+
+    bool
+    operator()(const daughters_key& a, const channel& b) const
+    { return less(a, key(b)); }
+
+  private:
+    daughters_key
+    key(const channel& c) const
+    {
+      const daughters_key k = { base_ + c.first, base_ + c.last };
+      return k;
+    }
+
+    static bool
+    less(const daughters_key& a, const daughters_key& b)
+    {
+      if (a.last - a.first != b.last - b.first)
+      { return a.last - a.first < b.last - b.first; }
+      return std::lexicographical_compare(a.first, a.last, b.first, b.last);
+    }
+
+    const int* base_;
+  };
+
+  // Orders positions in channels_ by descending branching ratios.
+  class br_greater
+  {
+  public:
+    explicit
+    br_greater(const std::vector<channel>& channels)
+      : channels_(channels) {}
+
+    bool
+    operator()(boost::uint32_t a, boost::uint32_t b) const
+    { return channels_[a].br > channels_[b].br; }
+
+  private:
+    const std::vector<channel>& channels_;
+  };
+
+  const decay&
+  decay_at(int parent, const char* function) const
+  {
+    boost::unordered_map<int, size_type>::const_iterator it =
+      index_.find(parent);
+    if (it == index_.end())
+    {
+      throw std::out_of_range(std::string("SLHAea::DecayTable::") +
+        function + "(" + to_string(parent) + ")");
+    }
+    return decays_[it->second];
+  }
+
+  double
+  sorted_br(int parent, const int* first, const int* last) const
+  {
+    const decay& d = decay_at(parent, "br");
+    const daughters_less less(daughters_);
+    const daughters_key key = { first, last };
+
+    double sum = 0.;
+    for (std::vector<channel>::const_iterator c = std::lower_bound(
+           channels_.begin() + d.first, channels_.begin() + d.last, key, less);
+         c != channels_.begin() + d.last && !less(key, *c); ++c)
+    { sum += c->br; }
+    return sum;
+  }
+
+  void
+  read_block(const Block& block)
+  {
+    Block::const_iterator block_def = block.find_block_def();
+    if (block_def == block.end() ||
+        !detail::iequal_to()((*block_def)[0], "DECAY")) return;
 
-    for (iterator block = begin(); block != end();)
+    int parent = 0;
+    if (!detail::parse_int((*block_def)[1], parent))
     {
-      if (pred(*block))
+      throw std::invalid_argument("SLHAea::DecayTable::read(‘" +
+        block_def->str() + "’)");
+    }
+    if (!index_.insert(std::make_pair(parent, decays_.size())).second) return;
+
+    decay d;
+    d.width = (block_def->data_size() > 2) ? to<double>((*block_def)[2]) : 0.;
+    d.br_sum = 0.;
+    d.first = channels_.size();
+
+    for (Block::const_iterator line = block.begin(); line != block.end();
+         ++line)
+    {
+      if (!line->is_data_line()) continue;
+
+      int nda = 0;
+      if (line->data_size() < 2 || !detail::parse_int((*line)[1], nda) ||
+          nda < 0 || line->data_size() < static_cast<size_type>(nda) + 2)
       {
-        block = erase(block);
-        ++erased_count;
+        throw std::invalid_argument("SLHAea::DecayTable::read(‘" +
+          line->str() + "’)");
       }
-      else ++block;
+
+      channel c;
+      c.br = to<double>((*line)[0]);
+      c.first = static_cast<boost::uint32_t>(daughters_.size());
+      for (int i = 0; i < nda; ++i)
+      {
+        int daughter = 0;
+        if (!detail::parse_int((*line)[i + 2], daughter))
+        {
+          throw std::invalid_argument("SLHAea::DecayTable::read(‘" +
+            line->str() + "’)");
+        }
+        daughters_.push_back(daughter);
+      }
+      c.last = static_cast<boost::uint32_t>(daughters_.size());
+      std::sort(daughters_.begin() + c.first, daughters_.end());
+
+      d.br_sum += c.br;
+      channels_.push_back(c);
     }
-    return erased_count;
+
+    d.last = channels_.size();
+    std::stable_sort(channels_.begin() + d.first, channels_.end(),
+                     daughters_less(daughters_));
+
+    for (size_type i = d.first; i < d.last; ++i)
+    { by_br_.push_back(static_cast<boost::uint32_t>(i)); }
+    std::stable_sort(by_br_.begin() + d.first, by_br_.end(),
+                     br_greater(channels_));
+
+    decays_.push_back(d);
   }
 
-  /**
-   * \brief Swaps data with another %Coll.
-   * \param coll %Coll to be swapped with.
-   */
-  void
-  swap(Coll& coll)
-  { impl_.swap(coll.impl_); }
+private:
+  boost::unordered_map<int, size_type> index_;
+  std::vector<decay> decays_;
+  std::vector<channel> channels_;
+  std::vector<boost::uint32_t> by_br_;
+  std::vector<int> daughters_;
+};
 
-  /** Erases all the elements in the %Coll. */
-  void
-  clear()
-  { impl_.clear(); }
+
+// streaming parser
+/**
+ * Handler with empty callbacks for parse().
+ * The handler that is passed to parse() must provide the three
+ * callbacks of this class. Classes that derive from %ParseHandler only
+ * need to define the callbacks they are interested in. All arguments
+ * are views into a buffer of the parser and only valid until the
+ * callback returns.
+ */
+struct ParseHandler
+{
+  typedef boost::string_ref           field_type;
+  typedef std::vector<field_type>     fields_type;
 
   /**
-   * \brief Reformats all Blocks in the %Coll.
-   * \sa Block::reformat()
+   * Called for every block definition (see Line::is_block_def()).
+   * \p name is the second of its \p fields.
    */
   void
-  reformat()
-  { std::for_each(begin(), end(), MEM_FN(&value_type::reformat)); }
+  on_block_def(field_type, const fields_type&) {}
 
-  /**
-   * \brief Comments all Blocks in the %Coll.
-   * \sa Block::comment()
-   */
+  /** Called for every line that begins with \c "#". */
   void
-  comment()
-  { std::for_each(begin(), end(), MEM_FN(&value_type::comment)); }
+  on_comment(field_type) {}
 
-  /**
-   * \brief Uncomments all Blocks in the %Coll.
-   * \sa Block::uncomment()
-   */
+  /** Called for every other non-empty line. */
   void
-  uncomment()
-  { std::for_each(begin(), end(), MEM_FN(&value_type::uncomment)); }
+  on_data_line(const fields_type&) {}
+};
 
-  /**
-   * Unary predicate that checks if a provided name matches the name
-   * of a Block.
-   */
-  struct key_matches
+/**
+ * \brief Parses a character range without building a Coll.
+ * \param first, last Pointers to the initial and final positions of
+ *   the characters that are parsed.
+ * \param handler Object whose callbacks are called for every
+ *   non-empty line (see ParseHandler).
+ *
+ * The lines are split into fields exactly as by
+ * Coll::read(const char*, const char*, int). No memory is allocated
+ * per line.
+ */
+template<class Handler> inline void
+parse(const char* first, const char* last, Handler& handler)
+{
+  detail::char_scanner scanner(first, last);
+  ParseHandler::fields_type fields;
+  detail::parse_lines(scanner, first, handler, fields);
+}
+
+/**
+ * \brief Parses an input stream without building a Coll.
+ * \param is Input stream that is parsed.
+ * \param handler Object whose callbacks are called for every
+ *   non-empty line (see ParseHandler).
+ *
+ * This function is equivalent to parse(const char*, const char*,
+ * Handler&) but reads \p is in chunks into a buffer that is reused.
+ * The buffer only grows if a single line does not fit into it, so
+ * the memory usage does not depend on the size of the input.
+ */
+template<class Handler> inline void
+parse(std::istream& is, Handler& handler)
+{
+  static const std::size_t chunk_size = 65536;
+  std::vector<char> buffer(chunk_size);
+  ParseHandler::fields_type fields;
+  std::size_t size = 0;
+
+  while (is)
   {
-    explicit
-    key_matches(const key_type& blockName) : name_(blockName) {}
+    if (size == buffer.size()) buffer.resize(2 * buffer.size());
+    is.read(&buffer[size],
+            static_cast<std::streamsize>(buffer.size() - size));
+    size += static_cast<std::size_t>(is.gcount());
+
+    // The last line in the buffer is only parsed if it is complete
+    // or if there is nothing left to read.
+    const char* first = &buffer[0];
+    const char* last = first + size;
+    if (is)
+    { while (last != first && last[-1] != '\n') --last; }
+    if (last == first) continue;
+
+    detail::char_scanner scanner(first, last);
+    detail::parse_lines(scanner, first, handler, fields);
+
+    size = std::copy(buffer.begin() + (last - first),
+                     buffer.begin() + size, buffer.begin()) - buffer.begin();
+  }
+}
 
-    bool
-    operator()(const value_type& block) const
-    { return boost::iequals(name_, block.name()); }
+/**
+ * \brief Parses a file without building a Coll.
+ * \param path Path of the file that is parsed.
+ * \param handler Object whose callbacks are called for every
+ *   non-empty line (see ParseHandler).
+ * \throw std::runtime_error If the file cannot be opened.
+ *
+ * This function is equivalent to parse(std::istream&, Handler&) with
+ * an input file stream for \p path. On POSIX systems the file is
+ * mapped into memory and parsed in place.
+ */
+template<class Handler> inline void
+parse_file(const std::string& path, Handler& handler)
+{
+  const detail::mapped_file file(path);
+  if (!file.is_open())
+  { throw std::runtime_error("SLHAea::parse_file(‘" + path + "’)"); }
 
-    void
-    set_key(const key_type& blockName)
-    { name_ = blockName; }
+  parse(file.begin(), file.end(), handler);
+}
 
-  private:
-    key_type name_;
-  };
 
+// block-wise stream reader
+/**
+ * Reader that splits an input stream into Blocks.
+ * A %BlockReader reads one Block at a time from an input stream with
+ * next(). In contrast to Block::read(std::istream&) it never
+ * repositions the stream: The block definition that ends a Block is
+ * kept by the %BlockReader and becomes the first Line of the next
+ * Block. Therefore it can read from any stream, including pipes,
+ * \c std::cin and streams whose buffers decompress their input.
+ */
+class BlockReader
+{
+public:
   /**
-   * Unary predicate that checks if a provided key matches the block
-   * definition of a Block.
+   * \brief Constructs a %BlockReader for an input stream.
+   * \param is Input stream to read from. It must stay valid as long
+   *   as the %BlockReader is used.
    */
-  struct key_matches_block_def
-  {
-    explicit
-    key_matches_block_def(const value_type::key_type& key)
-      : key_matches_(key) {}
+  explicit
+  BlockReader(std::istream& is)
+    : is_(is), line_str_(), line_(), lookahead_(), has_lookahead_(false) {}
 
-    bool
-    operator()(const value_type& block) const
+  /**
+   * \brief Reads the next Block.
+   * \param block %Block whose name and content are replaced.
+   * \return true if a %Block was read, false if the end of the
+   *   stream was reached. In the latter case \p block is empty.
+   *
+   * Lines that precede the first block definition are returned as a
+   * %Block without a name, just as Coll::read() would store them.
+   * Empty lines are skipped.
+   */
+  bool
+  next(Block& block)
+  {
+    block.clear();
+    if (has_lookahead_)
     {
-      value_type::const_iterator block_def = block.find_block_def();
-      return (block_def == block.end()) ? false : key_matches_(*block_def);
+      block.name(lookahead_.block_name());
+      block.push_back(lookahead_);
+      has_lookahead_ = false;
     }
 
-    void
-    set_key(const value_type::key_type& key)
-    { key_matches_.set_key(key); }
-
-  private:
-    value_type::key_matches key_matches_;
-  };
+    while (std::getline(is_, line_str_))
+    {
+      line_.str(line_str_);
+      if (line_.empty()) continue;
 
-private:
-  pointer
-  push_back_named_block(const key_type& blockName)
-  {
-    push_back(value_type(blockName));
-    return &back();
+      if (line_.is_block_def())
+      {
+        if (!block.empty())
+        {
+          lookahead_.swap(line_);
+          has_lookahead_ = true;
+          return true;
+        }
+        block.name(line_.block_name());
+      }
+      block.push_back(line_);
+    }
+    return !block.empty();
   }
 
-  iterator
-  erase_if_empty(const key_type& blockName, const size_type& offset = 0)
-  {
-    iterator block = find(begin() + offset, end(), blockName);
-    return (block != end() && block->empty()) ? erase(block) : block;
-  }
+private:
+  BlockReader& operator=(const BlockReader&);
 
 private:
-  impl_type impl_;
+  std::istream& is_;
+  std::string line_str_;
+  Line line_;
+  Line lookahead_;
+  bool has_lookahead_;
 };
 
 
+// multi-document reader
 /**
- * Reference to a single field in a SLHA structure.
- * This data type represents a reference to a single field in a SLHA
- * structure, but which is independent of any concrete Coll object.
- * That means that only the keys and the index of the Coll, Block, and
- * Line containers of the corresponding field are stored. One of the
- * main purposes of this data type is the conversion to string and
- * vice versa in a way that the string representation of a %Key can be
- * used as a single field in a SLHA structure. For example, the string
- * representation of a %Key that refers to the entry in the first row
- * and third column of the RVHMIX matrix is \c "RVHMIX;1,3;2". Further
- * examples are \c "1000022;DECAY;2" which refers to the total decay
- * width of the lightest neutralino or \c "1000022;(any),2,11,24;0"
- * which refers to the branching ratio of the decay of the lightest
- * neutralino into an electron and a W boson.
+ * Reader for files that contain several SLHA structures.
+ * A %SpectrumReader splits its input, which is the content of a file
+ * or a character range, into consecutive spectra and reads them one
+ * after another into a Coll with next(). By default a spectrum ends
+ * before the next block definition whose name equals the name of its
+ * first Block. Alternatively the spectra can be separated by marker
+ * lines, see separator().
+ *
+ * next() overwrites the Blocks and Lines of the provided Coll in
+ * place. If the same Coll is passed to every call and the spectra
+ * have the same structure, reading a spectrum does not allocate any
+ * memory after the first one.
  */
-struct Key
+class SpectrumReader
 {
 public:
-  /** Name of the Block that contains the field. */
-  Coll::key_type block;
-
-  /** First field(s) of the Line that contains the field. */
-  Block::key_type line;
-
-  /** Index of the field in the Line. */
-  Line::size_type field;
-
   /**
-   * \brief Constructs a %Key from explicit key values.
-   * \param _block Name of the Block that contains the field.
-   * \param _line First field(s) of the Line that contains the field.
-   * \param _field Index of the field in the Line.
+   * \brief Constructs a %SpectrumReader for a character range.
+   * \param first, last Pointers to the initial and final positions
+   *   of the characters that are read. They must stay valid as long
+   *   as the %SpectrumReader is used.
    */
-  Key(const Coll::key_type& _block,
-      const Block::key_type& _line,
-      const Line::size_type& _field)
-    : block(_block), line(_line), field(_field) {}
+  SpectrumReader(const char* first, const char* last)
+    : file_(), pos_(first), last_(last), marker_(), first_block_() {}
 
   /**
-   * \brief Constructs a %Key from a string.
-   * \param keyString String from which the %Key is constructed.
-   * \sa str()
+   * \brief Constructs a %SpectrumReader for a file.
+   * \param path Path of the file that is read.
+   * \throw std::runtime_error If the file cannot be opened.
+   *
+   * On POSIX systems the file is mapped into memory as long as the
+   * %SpectrumReader or a copy of it exists.
    */
-  Key(const std::string& keyString)
-  { str(keyString); }
+  explicit
+  SpectrumReader(const std::string& path)
+    : file_(new detail::mapped_file(path)), pos_(file_->begin()),
+      last_(file_->end()), marker_(), first_block_()
+  {
+    if (!file_->is_open())
+    { throw std::runtime_error("SLHAea::SpectrumReader(‘" + path + "’)"); }
+  }
 
   /**
-   * \brief Constructs a %Key from a string.
-   * \param keyString String from which the %Key is constructed.
-   * \sa str()
+   * \brief Sets the marker that separates spectra.
+   * \param marker Beginning of the lines that start a new spectrum.
+   *
+   * If \p marker is not empty, every line whose first non-blank
+   * characters are \p marker (for example \c "# point") starts a new
+   * spectrum and is the first line of it. If \p marker is empty, a
+   * spectrum ends before its first Block is repeated.
    */
-  Key(const char* keyString)
-  { str(keyString); }
+  void
+  separator(const std::string& marker)
+  { marker_ = marker; }
+
+  /** Returns the marker that separates spectra. */
+  const std::string&
+  separator() const
+  { return marker_; }
 
   /**
-   * \brief Converts a string to a %Key.
-   * \param keyString String that represents a %Key.
-   * \return Reference to \c *this.
+   * \brief Reads the next spectrum.
+   * \param coll %Coll whose content is replaced by the spectrum.
+   * \return true if a spectrum was read, false if the end of the
+   *   input was reached. In the latter case \p coll is empty.
    */
-  Key&
-  str(const std::string& keyString)
+  bool
+  next(Coll& coll)
   {
-    std::vector<std::string> keys;
-    boost::split(keys, keyString, boost::is_any_of(";"));
-
-    if (keys.size() != 3)
-    { throw std::invalid_argument("SLHAea::Key::str(‘" + keyString + "’)"); }
-
-    block = keys[0];
-    line.clear();
-    boost::split(line, keys[1], boost::is_any_of(","));
-    field = to<Line::size_type>(keys[2]);
-
-    return *this;
+    while (pos_ != last_)
+    {
+      const char* end = marker_.empty() ? find_repeated_block()
+                                        : find_marker();
+      coll.assign_reusing(pos_, end);
+      pos_ = end;
+      if (!coll.empty()) return true;
+    }
+    coll.clear();
+    return false;
   }
 
-  /**
-   * \brief Converts a %Key into its string representation.
-   * \return String that represents the %Key.
-   */
-  std::string
-  str() const
+private:
+  const char*
+  find_marker() const
   {
-    std::ostringstream output;
-    output << block << ";" << boost::join(line, ",") << ";" << field;
-    return output.str();
+    detail::char_scanner scanner(pos_, last_);
+    for (const char* pos = pos_;
+         (pos = scanner.find(pos, detail::char_scanner::newline)) != last_;)
+    {
+      pos = scanner.find(++pos, ~detail::char_scanner::blank);
+      if (static_cast<std::size_t>(last_ - pos) >= marker_.length() &&
+          std::equal(marker_.begin(), marker_.end(), pos))
+      {
+        while (pos[-1] != '\n') --pos;
+        return pos;
+      }
+    }
+    return last_;
   }
-};
-
-
-inline Coll::reference
-Coll::block(const Key& key)
-{ return at(key.block); }
-
-inline Coll::const_reference
-Coll::block(const Key& key) const
-{ return at(key.block); }
-
-inline Block::reference
-Coll::line(const Key& key)
-{ return block(key).at(key.line); }
 
-inline Block::const_reference
-Coll::line(const Key& key) const
-{ return block(key).at(key.line); }
+  const char*
+  find_repeated_block()
+  {
+    const char* pos = detail::find_next_block_def(pos_, pos_, last_);
+    if (pos == last_) return last_;
+    const boost::string_ref name = block_name(pos);
+    first_block_.assign(name.data(), name.size());
+
+    while ((pos = detail::find_next_block_def(pos + 1, pos_, last_)) != last_)
+    { if (boost::iequals(block_name(pos), first_block_)) return pos; }
+    return last_;
+  }
 
-inline Line::reference
-Coll::field(const Key& key)
-{ return line(key).at(key.field); }
+  /** Returns the name in the block definition that starts at \p pos. */
+  boost::string_ref
+  block_name(const char* pos) const
+  {
+    detail::char_scanner scanner(pos, last_);
+    const char* field_first = pos;
+    const char* field_last = pos;
+    detail::next_field(scanner, pos, field_first, field_last);
+    detail::next_field(scanner, pos, field_first, field_last);
+    return boost::string_ref(field_first, field_last - field_first);
+  }
 
-inline Line::const_reference
-Coll::field(const Key& key) const
-{ return line(key).at(key.field); }
+private:
+  boost::shared_ptr<const detail::mapped_file> file_;
+  const char* pos_;
+  const char* last_;
+  std::string marker_;
+  std::string first_block_;
+};
 
 
 // stream operators
@@ -2546,21 +7002,45 @@ operator>>(std::istream& is, Coll& coll)
 
 inline std::ostream&
 operator<<(std::ostream& os, const Line& line)
-{ return os << line.str(); }
+{
+  // Only formatted output respects the field width of os.
+  if (os.width() != 0) return os << line.str();
+
+  detail::ostream_sink sink(os);
+  line.write_to(sink);
+  sink.flush();
+  return os;
+}
 
 inline std::ostream&
 operator<<(std::ostream& os, const Block& block)
 {
-  std::copy(block.begin(), block.end(),
-            std::ostream_iterator<Block::value_type>(os, "\n"));
+  if (os.width() != 0 && !block.source_)
+  {
+    std::copy(block.begin(), block.end(),
+              std::ostream_iterator<Block::value_type>(os, "\n"));
+    return os;
+  }
+
+  detail::ostream_sink sink(os);
+  block.write_to(sink);
+  sink.flush();
   return os;
 }
 
 inline std::ostream&
 operator<<(std::ostream& os, const Coll& coll)
 {
-  std::copy(coll.begin(), coll.end(),
-            std::ostream_iterator<Coll::value_type>(os));
+  if (os.width() != 0)
+  {
+    std::copy(coll.begin(), coll.end(),
+              std::ostream_iterator<Coll::value_type>(os));
+    return os;
+  }
+
+  detail::ostream_sink sink(os);
+  coll.write_to(sink);
+  sink.flush();
   return os;
 }
 
@@ -2573,8 +7053,12 @@ operator<<(std::ostream& os, const Key& key)
 inline bool
 operator==(const Line& a, const Line& b)
 {
-  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin())
-    && a.str() == b.str();
+  if (a.size() != b.size() || !std::equal(a.begin(), a.end(), b.begin()))
+  { return false; }
+
+  // The original text of Lines read with Coll::read_verbatim is not
+  // compared.
+  return a.same_formatting(b);
 }
 
 inline bool
@@ -2666,5 +7150,10 @@ operator>=(const Coll& a, const Coll& b)
 } // namespace SLHAea
 
 #undef MEM_FN
+#undef SLHAEA_MMAP
+#undef SLHAEA_AVX2
+#undef SLHAEA_SSE2
+#undef SLHAEA_THREADS
+#undef SLHAEA_CHARCONV
 
 #endif // SLHAEA_H
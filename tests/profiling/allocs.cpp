@@ -0,0 +1,171 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Counts heap allocations per non-empty line of input.txt for the
+// previous substr-based tokenizer of Line::str(), the current
+// single-pass tokenizer, a complete Coll::read() and the streaming
+// parse(). It also reports the heap memory per line that is held by
+// the resulting Coll and the heap allocations per Block::at(i, j)
+// in the neutralino mixing block.
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+static size_t allocations = 0;
+static size_t live_bytes = 0;
+
+// Every block is prefixed with its size so that live_bytes can be
+// maintained in operator delete.
+static const size_t header = 16;
+
+void* operator new(size_t size)
+{
+  ++allocations;
+  live_bytes += size;
+  if (char* p = static_cast<char*>(malloc(size + header)))
+  {
+    *reinterpret_cast<size_t*>(p) = size;
+    return p + header;
+  }
+  throw bad_alloc();
+}
+
+void operator delete(void* p) throw()
+{
+  if (!p) return;
+  char* block = static_cast<char*>(p) - header;
+  live_bytes -= *reinterpret_cast<size_t*>(block);
+  free(block);
+}
+
+#if __cplusplus >= 201402L
+void operator delete(void* p, size_t) throw()
+{ operator delete(p); }
+#endif
+
+// The tokenizer of Line::str(const std::string&) before it was
+// rewritten to scan the input only once.
+void legacy_tokenize(const string& line, vector<string>& fields,
+                     vector<size_t>& columns)
+{
+  fields.clear();
+  columns.clear();
+  static const string whitespace = " \t\v\f\r";
+  const size_t last_non_ws =
+    line.substr(0, line.find('\n')).find_last_not_of(whitespace);
+  if (last_non_ws == string::npos) return;
+
+  const string trimmed_line = line.substr(0, last_non_ws + 1);
+  const size_t comment_pos = trimmed_line.find('#');
+  const string data = trimmed_line.substr(0, comment_pos);
+
+  size_t pos1 = data.find_first_not_of(whitespace, 0);
+  size_t pos2 = data.find_first_of(whitespace, pos1);
+
+  while (pos1 != string::npos)
+  {
+    fields.push_back(data.substr(pos1, pos2 - pos1));
+    columns.push_back(pos1);
+
+    pos1 = data.find_first_not_of(whitespace, pos2);
+    pos2 = data.find_first_of(whitespace, pos1);
+  }
+
+  if (comment_pos != string::npos)
+  {
+    fields.push_back(trimmed_line.substr(comment_pos));
+    columns.push_back(comment_pos);
+  }
+}
+
+struct LineCounter : ParseHandler
+{
+  LineCounter() : lines(0) {}
+
+  void
+  on_block_def(field_type, const fields_type&)
+  { ++lines; }
+
+  void
+  on_comment(field_type)
+  { ++lines; }
+
+  void
+  on_data_line(const fields_type&)
+  { ++lines; }
+
+  size_t lines;
+};
+
+int main()
+{
+  vector<string> lines;
+  {
+    ifstream ifs("input.txt");
+    string line_str;
+    while (getline(ifs, line_str))
+    { if (!Line(line_str).empty()) lines.push_back(line_str); }
+  }
+  const double n = static_cast<double>(lines.size());
+
+  vector<string> fields;
+  vector<size_t> columns;
+  legacy_tokenize(lines[0], fields, columns);
+  size_t start = allocations;
+  for (size_t i = 0; i < lines.size(); ++i)
+  { legacy_tokenize(lines[i], fields, columns); }
+  const double legacy = (allocations - start) / n;
+
+  Line line(lines[0]);
+  start = allocations;
+  for (size_t i = 0; i < lines.size(); ++i)
+  { line.str(lines[i]); }
+  const double tokenizer = (allocations - start) / n;
+
+  ifstream ifs("input.txt");
+  const size_t start_bytes = live_bytes;
+  start = allocations;
+  Coll* input = new Coll(ifs);
+  const double coll = (allocations - start) / n;
+  const double resident = (live_bytes - start_bytes) / n;
+  delete input;
+
+  ifstream ifs2("input.txt");
+  LineCounter counter;
+  start = allocations;
+  parse(ifs2, counter);
+  const double streaming = (allocations - start) / n;
+
+  ifstream ifs3("input.txt");
+  const Coll slha(ifs3);
+  const Block& mixing = slha.at("RVNmix");
+  size_t found = 0;
+  start = allocations;
+  for (int i = 0; i < 1600; ++i)
+  { found += mixing.at(i % 4 + 1, i / 4 % 4 + 1).size(); }
+  const double lookup = (allocations - start) / 1600.;
+
+  printf("non-empty lines:                 %lu\n",
+         static_cast<unsigned long>(lines.size()));
+  printf("allocs/line legacy tokenizer:    %.2f\n", legacy);
+  printf("allocs/line Line::str(string):   %.2f\n", tokenizer);
+  printf("allocs/line Coll::read(istream): %.2f\n", coll);
+  printf("allocs/line parse(istream):      %.2f\n", streaming);
+  printf("heap bytes/line held by Coll:    %.2f\n", resident);
+  printf("allocs/lookup Block::at(i, j):   %.2f (%lu fields)\n", lookup,
+         static_cast<unsigned long>(found));
+}
@@ -0,0 +1,175 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Compares the time per conversion of to(), to_string() and
+// write_number() with the lexical_cast and std::ostringstream code
+// that they used before, for the numeric fields of input.txt.
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+const size_t rounds = 200;
+
+double seconds_since(clock_t start)
+{ return static_cast<double>(clock() - start) / CLOCKS_PER_SEC; }
+
+void report(const char* what, double before, double after, size_t count)
+{
+  const double n = 1e-9 * rounds * count;
+  printf("%-28s before: %6.1f ns  after: %6.1f ns\n", what, before / n,
+         after / n);
+}
+
+string stream_to_string(double value, int precision)
+{
+  ostringstream output;
+  output << setprecision(precision) << scientific << value;
+  return output.str();
+}
+
+int main()
+{
+  ifstream ifs("input.txt");
+  const Coll input(ifs);
+
+  vector<string> doubles, ints;
+  for (Coll::const_iterator block = input.begin(); block != input.end();
+       ++block)
+  {
+    for (Block::const_iterator line = block->begin(); line != block->end();
+         ++line)
+    {
+      if (!line->is_data_line()) continue;
+      for (Line::const_iterator field = line->begin();
+           field != line->begin() + line->data_size(); ++field)
+      {
+        try { boost::lexical_cast<int>(*field); ints.push_back(*field); }
+        catch (const boost::bad_lexical_cast&)
+        {
+          try
+          {
+            boost::lexical_cast<double>(*field);
+            doubles.push_back(*field);
+          }
+          catch (const boost::bad_lexical_cast&) {}
+        }
+      }
+    }
+  }
+  vector<double> values;
+  for (size_t i = 0; i < doubles.size(); ++i)
+  { values.push_back(to<double>(doubles[i])); }
+
+  double sum = 0.;
+  size_t length = 0;
+  clock_t start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < doubles.size(); ++i)
+    { sum += boost::lexical_cast<double>(doubles[i]); }
+  }
+  double before = seconds_since(start);
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < doubles.size(); ++i)
+    { sum += to<double>(doubles[i]); }
+  }
+  report("to<double>(string):", before, seconds_since(start), doubles.size());
+
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < ints.size(); ++i)
+    { sum += boost::lexical_cast<int>(ints[i]); }
+  }
+  before = seconds_since(start);
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < ints.size(); ++i) sum += to<int>(ints[i]);
+  }
+  report("to<int>(string):", before, seconds_since(start), ints.size());
+
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < values.size(); ++i)
+    { length += boost::lexical_cast<string>(values[i]).length(); }
+  }
+  before = seconds_since(start);
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < values.size(); ++i)
+    { length += SLHAea::to_string(values[i]).length(); }
+  }
+  report("to_string(double):", before, seconds_since(start), values.size());
+
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < values.size(); ++i)
+    { length += stream_to_string(values[i], 8).length(); }
+  }
+  before = seconds_since(start);
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < values.size(); ++i)
+    { length += SLHAea::to_string(values[i], 8).length(); }
+  }
+  const double after = seconds_since(start);
+  report("to_string(double, 8):", before, after, values.size());
+
+  char buffer[32];
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < values.size(); ++i)
+    { length += write_number(buffer, buffer + 32, values[i], 8) - buffer; }
+  }
+  report("write_number(double, 8):", before, seconds_since(start),
+         values.size());
+
+  Line line;
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+      line.clear();
+      line << stream_to_string(values[i], 15);
+    }
+  }
+  before = seconds_since(start);
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+      line.clear();
+      line << values[i];
+    }
+  }
+  report("Line::operator<<(double):", before, seconds_since(start),
+         values.size());
+
+  if (sum == 0. || length == 0) printf("nothing converted\n");
+  printf("fields: %lu doubles, %lu integers\n",
+         static_cast<unsigned long>(doubles.size()),
+         static_cast<unsigned long>(ints.size()));
+}
@@ -0,0 +1,118 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Generates a decay file of the size of a full NMSSM spectrum (60
+// particles with 80 two- and three-body channels each) and compares
+// the time of Coll::read() with the time of building a DecayTable
+// from the Coll. Then it compares the time per branching ratio lookup
+// and per sum of the branching ratios of a particle with Coll and
+// to<double>() and with the DecayTable.
+
+#include <cstdio>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+double seconds_since(clock_t start)
+{ return static_cast<double>(clock() - start) / CLOCKS_PER_SEC; }
+
+int main()
+{
+  const int parents = 60, channels = 80;
+  const int ids[] = { 1, -1, 5, -5, 11, -11, 13, -13, 15, -15, 22, 23,
+                      24, -24, 25, 35, 36, 45, 1000022, 1000023 };
+
+  ostringstream os;
+  vector<vector<int> > queries;
+  for (int p = 0; p < parents; ++p)
+  {
+    const int parent = 1000001 + p;
+    os << "DECAY   " << parent << "   1.23456789E+00   # particle\n";
+    for (int c = 0; c < channels; ++c)
+    {
+      const int nda = 2 + c % 2;
+      vector<int> query(1, parent);
+      os << "     1.25000000E-02    " << nda;
+      for (int d = 0; d < nda; ++d)
+      {
+        const int id = ids[(c * (d + 3) + p + d * 7) % 20];
+        os << "   " << id;
+        query.push_back(id);
+      }
+      os << "   # channel\n";
+      if (nda == 2) queries.push_back(query);
+    }
+  }
+  const string input = os.str();
+
+  const int rounds = 50;
+  Coll coll;
+  clock_t start = clock();
+  for (int r = 0; r < rounds; ++r) coll = Coll::from_str(input);
+  const double read = seconds_since(start) / rounds;
+
+  DecayTable table;
+  start = clock();
+  for (int r = 0; r < rounds; ++r) table.read(coll);
+  const double build = seconds_since(start) / rounds;
+
+  printf("decay file: %d particles, %d channels, %lu kB\n", parents,
+         parents * channels, static_cast<unsigned long>(input.size() / 1024));
+  printf("Coll::read():          %7.2f ms\n", read * 1e3);
+  printf("DecayTable(coll):      %7.2f ms\n", build * 1e3);
+
+  double sum = 0.;
+  start = clock();
+  for (size_t i = 0; i < queries.size(); ++i)
+  {
+    const vector<int>& q = queries[i];
+    Block::key_type key(1, "(any)");
+    key.push_back("2");
+    key.push_back(to_string(q[1]));
+    key.push_back(to_string(q[2]));
+    const Block& block = coll.at(to_string(q[0]));
+    const Block::const_iterator line = block.find(key);
+    if (line != block.end()) sum += to<double>(line->at(0));
+  }
+  const double coll_br = seconds_since(start) / queries.size();
+
+  const int lookup_rounds = 100;
+  start = clock();
+  for (int r = 0; r < lookup_rounds; ++r)
+  {
+    for (size_t i = 0; i < queries.size(); ++i)
+    { sum += table.br(queries[i][0], queries[i][2], queries[i][1]); }
+  }
+  const double table_br = seconds_since(start) / (lookup_rounds * queries.size());
+
+  start = clock();
+  for (int p = 0; p < parents; ++p)
+  {
+    const Block& block = coll.at(to_string(1000001 + p));
+    for (Block::const_iterator line = block.begin(); line != block.end(); ++line)
+    { if (line->is_data_line()) sum += to<double>(line->at(0)); }
+  }
+  const double coll_sum = seconds_since(start) / parents;
+
+  start = clock();
+  for (int r = 0; r < lookup_rounds; ++r)
+  {
+    for (int p = 0; p < parents; ++p) sum += table.br_sum(1000001 + p);
+  }
+  const double table_sum = seconds_since(start) / (lookup_rounds * parents);
+  if (sum == 0.) printf("nothing found\n");
+
+  printf("branching ratio:       Coll: %8.1f ns  DecayTable: %6.1f ns\n",
+         coll_br * 1e9, table_br * 1e9);
+  printf("sum of BRs per parent: Coll: %8.1f ns  DecayTable: %6.1f ns\n",
+         coll_sum * 1e9, table_sum * 1e9);
+}
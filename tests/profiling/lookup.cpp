@@ -0,0 +1,349 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Measures the time per lookup of Blocks by name in the Coll of
+// input.txt and in a Coll with 1000 Blocks, with and without the
+// index of Block names, the time per lookup of Blocks by their block
+// definitions and per Block::data_size() in input.txt, and the time
+// per lookup of Lines by two integer keys in matrix Blocks of
+// different sizes, with and without the index of Lines. Finally it
+// compares Block::at(i, j) with the lookup by the converted strings
+// that it used before, in a Block of the size of NMIX and in a Block
+// with 1024 Lines, and the time per access of the second field of all
+// data Lines of input.txt via strings, Keys, KeyHandles and
+// Coll::fields(). Finally it compares Block::count() with the
+// wildcard key ("(any)", "2", "13", "24") and with the equivalent
+// Block::key_pattern in a DECAY block with 5000 channels, and the
+// time per element of KaiminiCovarianceMatrix read with
+// Block::at(i, j) and to<double>() with the time per element of
+// Block::as_matrix() and of reading the resulting Matrix. Finally it
+// compares to<double>() with the cached Line::as<double>() for the
+// second field of all data Lines of input.txt.
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+// Looks up all keys repeatedly and returns the time per lookup in ns.
+template<class Container, class Key>
+double time_lookups(const Container& cont, const vector<Key>& keys)
+{
+  const size_t rounds = 100000 / keys.size() + 1;
+  size_t found = 0;
+  const clock_t start = clock();
+  for (size_t i = 0; i < rounds; ++i)
+  {
+    for (size_t j = 0; j < keys.size(); ++j)
+    { found += cont.find(keys[j]) != cont.end(); }
+  }
+  const double seconds = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+  if (found == 0) printf("nothing found\n");
+  return seconds * 1e9 / (rounds * keys.size());
+}
+
+void report(const char* what, Coll& coll)
+{
+  vector<string> names;
+  for (Coll::const_iterator block = coll.begin(); block != coll.end(); ++block)
+  { names.push_back(block->name()); }
+
+  coll.use_index(false);
+  const double scan = time_lookups(coll, names);
+  coll.use_index();
+  const double index = time_lookups(coll, names);
+
+  printf("%-22s %5lu blocks  scan: %8.1f ns  index: %6.1f ns\n", what,
+         static_cast<unsigned long>(coll.size()), scan, index);
+}
+
+void report(Block& block)
+{
+  vector<Block::key_type> keys;
+  for (Block::const_iterator line = block.begin(); line != block.end(); ++line)
+  { keys.push_back(Block::key_type(line->begin(), line->begin() + 2)); }
+
+  block.use_index(false);
+  const double scan = time_lookups(block, keys);
+  block.use_index();
+  const double index = time_lookups(block, keys);
+
+  printf("Block::find(i, j):     %5lu lines   scan: %8.1f ns  index: %6.1f ns\n",
+         static_cast<unsigned long>(block.size()), scan, index);
+}
+
+// Looks up all Lines of a square matrix with dim*dim entries
+// repeatedly and returns the time per lookup in ns.
+double time_at(const Block& block, int dim, bool by_strings)
+{
+  const size_t rounds = 100000 / (dim * dim) + 1;
+  size_t found = 0;
+  const clock_t start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (int i = 1; i <= dim; ++i)
+    {
+      for (int j = 1; j <= dim; ++j)
+      {
+        if (by_strings)
+        { found += block.at(to_string(i), to_string(j)).size(); }
+        else found += block.at(i, j).size();
+      }
+    }
+  }
+  const double seconds = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+  if (found == 0) printf("nothing found\n");
+  return seconds * 1e9 / (rounds * dim * dim);
+}
+
+void report_at(Block& block, int dim)
+{
+  block.use_index(false);
+  const double strings = time_at(block, dim, true);
+  const double scan = time_at(block, dim, false);
+  block.use_index();
+  const double index_strings = time_at(block, dim, true);
+  const double index = time_at(block, dim, false);
+
+  printf("Block::at(i, j):       %5lu lines   scan: %8.1f ns  index: %6.1f ns"
+         "  (strings: %8.1f ns, %6.1f ns)\n",
+         static_cast<unsigned long>(block.size()), scan, index, strings,
+         index_strings);
+}
+
+void report_block_defs(const Coll& coll)
+{
+  vector<Block::key_type> keys;
+  for (Coll::const_iterator block = coll.begin(); block != coll.end(); ++block)
+  {
+    Block::const_iterator block_def = block->find_block_def();
+    if (block_def != block->end())
+    { keys.push_back(Block::key_type(block_def->begin(), block_def->begin() + 2)); }
+  }
+  const double find = time_lookups(coll, keys);
+
+  const size_t rounds = 2000;
+  size_t lines = 0, data_lines = 0;
+  for (Coll::const_iterator block = coll.begin(); block != coll.end(); ++block)
+  { lines += block->size(); }
+  const clock_t start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (Coll::const_iterator block = coll.begin(); block != coll.end(); ++block)
+    { data_lines += block->data_size(); }
+  }
+  const double seconds = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+  if (data_lines == 0) printf("no data lines\n");
+
+  printf("Coll::find(key), input: %3lu blocks  scan: %8.1f ns  "
+         "data_size(): %5.1f ns/line\n", static_cast<unsigned long>(keys.size()),
+         find, seconds * 1e9 / (rounds * lines));
+}
+
+void report_keys(const Coll& coll)
+{
+  vector<string> strings;
+  for (Coll::const_iterator block = coll.begin(); block != coll.end(); ++block)
+  {
+    for (Block::const_iterator line = block->begin(); line != block->end();
+         ++line)
+    {
+      if (line->is_data_line() && line->size() > 1 &&
+          block->find(Block::key_type(1, line->at(0))) == line)
+      { strings.push_back(block->name() + ";" + line->at(0) + ";1"); }
+    }
+  }
+  vector<Key> keys(strings.begin(), strings.end());
+  vector<KeyHandle> handles(keys.begin(), keys.end());
+
+  const size_t rounds = 100000 / keys.size() + 1;
+  vector<const string*> fields(keys.size());
+  size_t length = 0;
+  double seconds[4];
+  for (int mode = 0; mode < 4; ++mode)
+  {
+    const clock_t start = clock();
+    for (size_t r = 0; r < rounds; ++r)
+    {
+      if (mode == 3)
+      {
+        coll.fields(keys, fields.begin());
+        length += fields.back()->length();
+        continue;
+      }
+      for (size_t i = 0; i < keys.size(); ++i)
+      {
+        if (mode == 0) length += coll.field(strings[i]).length();
+        else if (mode == 1) length += coll.field(keys[i]).length();
+        else length += handles[i].field(coll).length();
+      }
+    }
+    seconds[mode] = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+  }
+  if (length == 0) printf("nothing found\n");
+
+  const double n = 1e-9 * rounds * keys.size();
+  printf("Coll::field(), input: %5lu keys    string: %8.1f ns  Key: %8.1f ns"
+         "  KeyHandle: %5.1f ns  fields(): %5.1f ns\n",
+         static_cast<unsigned long>(keys.size()), seconds[0] / n,
+         seconds[1] / n, seconds[2] / n, seconds[3] / n);
+}
+
+void report_pattern()
+{
+  const char* ids[] = { "13", "-13", "24", "-24", "22", "1000022" };
+  Block decay;
+  decay.push_back("DECAY 1000023 1.0");
+  for (int i = 0; i < 5000; ++i)
+  {
+    decay.push_back("  1.0E-04  2  " + string(ids[i % 6]) + "  " +
+                    ids[i / 6 % 6]);
+  }
+
+  Block::key_type key(1, "(any)");
+  key.push_back("2");
+  key.push_back("13");
+  key.push_back("24");
+  const Block::key_pattern pattern(key);
+
+  const size_t rounds = 200;
+  size_t matches = 0;
+  clock_t start = clock();
+  for (size_t r = 0; r < rounds; ++r) matches += decay.count(key);
+  const double plain = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r) matches += decay.count(pattern);
+  const double compiled = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+  if (matches == 0) printf("nothing found\n");
+
+  const double n = 1e-9 * rounds * decay.size();
+  printf("Block::count(), DECAY: %5lu lines   key_matches: %5.1f ns/line"
+         "  key_pattern: %5.1f ns/line\n",
+         static_cast<unsigned long>(decay.size()), plain / n, compiled / n);
+}
+
+void report_matrix(const Block& block)
+{
+  vector<pair<int, int> > indices;
+  for (Block::const_iterator line = block.begin(); line != block.end(); ++line)
+  {
+    if (line->is_data_line())
+    { indices.push_back(make_pair(to<int>(line->at(0)), to<int>(line->at(1)))); }
+  }
+
+  const size_t rounds = 20000;
+  double sum = 0.;
+  clock_t start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < indices.size(); ++i)
+    { sum += to<double>(block.at(indices[i].first, indices[i].second)[2]); }
+  }
+  const double at = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  { sum += block.as_matrix<double>(2, Block::symmetric_matrix)(1, 1); }
+  const double build = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+
+  const Matrix<double> matrix =
+    block.as_matrix<double>(2, Block::symmetric_matrix);
+  start = clock();
+  for (size_t r = 0; r < rounds * 100; ++r)
+  {
+    for (size_t i = 0; i < indices.size(); ++i)
+    { sum += matrix(indices[i].first, indices[i].second); }
+  }
+  const double read = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+  if (sum == 0.) printf("nothing read\n");
+
+  const double n = 1e-9 * rounds * indices.size();
+  printf("Block::as_matrix():    %5lu values  at()+to(): %6.1f ns  "
+         "as_matrix(): %6.1f ns  Matrix(i, j): %4.1f ns\n",
+         static_cast<unsigned long>(indices.size()), at / n, build / n,
+         read / (100 * n));
+}
+
+void report_values(const Coll& coll)
+{
+  vector<const Line*> lines;
+  for (Coll::const_iterator block = coll.begin(); block != coll.end(); ++block)
+  {
+    for (Block::const_iterator line = block->begin(); line != block->end();
+         ++line)
+    {
+      if (!line->is_data_line() || line->size() < 2) continue;
+      try
+      {
+        to<double>(line->at(1));
+        lines.push_back(&*line);
+      }
+      catch (const boost::bad_lexical_cast&) {}
+    }
+  }
+
+  const size_t rounds = 200;
+  double sum = 0.;
+  double seconds[2];
+  for (int mode = 0; mode < 2; ++mode)
+  {
+    const clock_t start = clock();
+    for (size_t r = 0; r < rounds; ++r)
+    {
+      for (size_t i = 0; i < lines.size(); ++i)
+      {
+        if (mode == 0) sum += to<double>(lines[i]->at(1));
+        else sum += lines[i]->as<double>(1);
+      }
+    }
+    seconds[mode] = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+  }
+  if (sum == 0.) printf("nothing read\n");
+
+  const double n = 1e-9 * rounds * lines.size();
+  printf("Line::as<double>(1):   %5lu lines   to<double>(): %6.1f ns  "
+         "as<double>(): %5.1f ns\n", static_cast<unsigned long>(lines.size()),
+         seconds[0] / n, seconds[1] / n);
+}
+
+int main()
+{
+  ifstream ifs("input.txt");
+  Coll input(ifs);
+  report("Coll::find(), input:", input);
+  input.use_index(false);
+  report_block_defs(input);
+  report_keys(input);
+
+  Coll large;
+  for (int i = 0; i < 1000; ++i)
+  { large.push_back(Block("BLOCK" + to_string(i))); }
+  report("Coll::find(), large:", large);
+
+  const int dims[] = { 2, 3, 4, 6, 10, 32 };
+  for (int d = 0; d < 6; ++d)
+  {
+    Block matrix;
+    for (int i = 1; i <= dims[d]; ++i)
+    {
+      for (int j = 1; j <= dims[d]; ++j)
+      { matrix.push_back(" " + to_string(i) + " " + to_string(j) + " 0.5"); }
+    }
+    report(matrix);
+    if (dims[d] == 4 || dims[d] == 32) report_at(matrix, dims[d]);
+  }
+
+  report_pattern();
+  report_matrix(input.at("KaiminiCovarianceMatrix"));
+  report_values(input);
+}
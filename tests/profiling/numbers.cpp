@@ -0,0 +1,115 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Compares the time per Line of filling a Block with a grid of 10^5
+// doubles ("i j value" Lines) with Line::operator<<() in every
+// number_format, with inserting strings from an std::ostringstream
+// and from to_string() like operator<<() did before, and counts the
+// values that Line::as<double>() does not read back exactly.
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <boost/lexical_cast.hpp>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+const int lines = 100000;
+const int rounds = 5;
+
+double value(int i)
+{ return (1. + i * 1e-3) / 3.; }
+
+string stream_str(double value)
+{
+  ostringstream output;
+  output << setprecision(numeric_limits<double>::digits10) << scientific
+         << value;
+  return output.str();
+}
+
+int mismatches(const Block& block)
+{
+  int count = 0, i = 0;
+  for (Block::const_iterator line = block.begin(); line != block.end();
+       ++line, ++i)
+  {
+    const double read = line->as<double>(2);
+    const double expected = value(i);
+    if (memcmp(&read, &expected, sizeof(read)) != 0) ++count;
+  }
+  return count;
+}
+
+void report(const char* name, double seconds, const Block& block)
+{
+  printf("%-30s %7.1f ns/line  %6d values not read back exactly\n", name,
+         1e9 * seconds / rounds / lines, mismatches(block));
+}
+
+void run(const char* name, const number_format& format)
+{
+  Block block;
+  const clock_t start = clock();
+  for (int r = 0; r < rounds; ++r)
+  {
+    block.clear();
+    for (int i = 0; i < lines; ++i)
+    {
+      Line line;
+      line << format << i / 300 << i % 300 << value(i);
+      block.push_back(line);
+    }
+  }
+  report(name, static_cast<double>(clock() - start) / CLOCKS_PER_SEC,
+         block);
+}
+
+int main()
+{
+  Block block;
+  clock_t start = clock();
+  for (int r = 0; r < rounds; ++r)
+  {
+    block.clear();
+    for (int i = 0; i < lines; ++i)
+    {
+      Line line;
+      line << boost::lexical_cast<string>(i / 300)
+           << boost::lexical_cast<string>(i % 300) << stream_str(value(i));
+      block.push_back(line);
+    }
+  }
+  report("ostringstream strings:", static_cast<double>(clock() - start) /
+         CLOCKS_PER_SEC, block);
+
+  start = clock();
+  for (int r = 0; r < rounds; ++r)
+  {
+    block.clear();
+    for (int i = 0; i < lines; ++i)
+    {
+      Line line;
+      line << SLHAea::to_string(i / 300) << SLHAea::to_string(i % 300)
+           << SLHAea::to_string(value(i), numeric_limits<double>::digits10);
+      block.push_back(line);
+    }
+  }
+  report("to_string() strings:", static_cast<double>(clock() - start) /
+         CLOCKS_PER_SEC, block);
+
+  run("number_format::digits10():", number_format::digits10());
+  run("number_format::shortest():", number_format::shortest());
+  run("number_format::slha():", number_format::slha());
+  run("number_format::scientific(3):", number_format::scientific(3));
+}
@@ -0,0 +1,60 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Compares the wall-clock time of a serial and a parallel
+// Coll::read() of input.txt repeated up to the given size in MB.
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+double time_read(const string& buffer, int flags, size_t& blocks)
+{
+  const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  Coll coll;
+  coll.read(buffer.data(), buffer.data() + buffer.length(), flags);
+  const chrono::duration<double> elapsed =
+    chrono::steady_clock::now() - start;
+  blocks = coll.size();
+  return elapsed.count();
+}
+
+int main(int argc, char* argv[])
+{
+  size_t size_mb = 100;
+  if (argc > 1) istringstream(argv[1]) >> size_mb;
+
+  ifstream ifs("input.txt");
+  const string input((istreambuf_iterator<char>(ifs)),
+                     istreambuf_iterator<char>());
+  string buffer;
+  while (buffer.length() < size_mb * 1024 * 1024) buffer += input;
+
+  // The first read warms up the allocator and is not reported.
+  size_t serial_blocks = 0, parallel_blocks = 0;
+  time_read(buffer, Coll::read_default, serial_blocks);
+  const double serial = time_read(buffer, Coll::read_default, serial_blocks);
+  const double parallel =
+    time_read(buffer, Coll::read_parallel, parallel_blocks);
+
+  printf("input size:         %lu MB\n",
+         static_cast<unsigned long>(buffer.length() / (1024 * 1024)));
+  printf("hardware threads:   %u\n", thread::hardware_concurrency());
+  printf("serial read:        %.3f s (%lu blocks)\n", serial,
+         static_cast<unsigned long>(serial_blocks));
+  printf("parallel read:      %.3f s (%lu blocks)\n", parallel,
+         static_cast<unsigned long>(parallel_blocks));
+  printf("speedup:            %.2f\n", serial / parallel);
+}
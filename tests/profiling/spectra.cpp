@@ -0,0 +1,98 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Writes input.txt repeatedly into a file of the given size in MB
+// (1 GB by default) and reads it spectrum by spectrum with a
+// SpectrumReader, once into a new Coll for every spectrum and once
+// into the same Coll. Reports the time and the heap allocations per
+// spectrum of both loops.
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <sstream>
+#include <string>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+  ++allocations;
+  if (void* p = malloc(size)) return p;
+  throw bad_alloc();
+}
+
+void operator delete(void* p) throw()
+{ free(p); }
+
+#if __cplusplus >= 201402L
+void operator delete(void* p, size_t) throw()
+{ free(p); }
+#endif
+
+void report(const char* what, size_t bytes, double seconds,
+            size_t spectra, size_t allocs)
+{
+  printf("%-28s %6.2f s  %7.1f MB/s  %8.1f allocs/spectrum\n", what,
+         seconds, bytes / seconds / (1024. * 1024.),
+         static_cast<double>(allocs) / spectra);
+}
+
+int main(int argc, char* argv[])
+{
+  size_t size_mb = 1024;
+  if (argc > 1) istringstream(argv[1]) >> size_mb;
+
+  const char* path = "spectra.txt";
+  size_t bytes = 0;
+  {
+    ifstream ifs("input.txt");
+    const string input((istreambuf_iterator<char>(ifs)),
+                       istreambuf_iterator<char>());
+    ofstream ofs(path);
+    for (; bytes < size_mb * 1024 * 1024; bytes += input.length())
+    { ofs << input; }
+  }
+
+  SpectrumReader fresh_reader(path);
+  size_t spectra = 0;
+  size_t start_allocs = allocations;
+  clock_t start = clock();
+  for (;; ++spectra)
+  {
+    Coll coll;
+    if (!fresh_reader.next(coll)) break;
+  }
+  report("new Coll per spectrum:", bytes,
+         static_cast<double>(clock() - start) / CLOCKS_PER_SEC,
+         spectra, allocations - start_allocs);
+
+  // The first spectrum allocates the Blocks and Lines that are
+  // reused for all others, so it is not counted.
+  SpectrumReader reader(path);
+  Coll coll;
+  reader.next(coll);
+  spectra = 0;
+  start_allocs = allocations;
+  start = clock();
+  while (reader.next(coll)) ++spectra;
+  report("same Coll for all spectra:", bytes,
+         static_cast<double>(clock() - start) / CLOCKS_PER_SEC,
+         spectra, allocations - start_allocs);
+
+  printf("file size:                    %lu MB (%lu spectra)\n",
+         static_cast<unsigned long>(bytes / (1024 * 1024)),
+         static_cast<unsigned long>(spectra + 1));
+  remove(path);
+}
@@ -0,0 +1,109 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Writes input.txt repeatedly into a file of the given size in MB
+// and reads it Block by Block with Block::read() from an ifstream and
+// with a BlockReader from an ifstream and from a pipe.
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+// Minimal input stream buffer for the output of a popen()ed command.
+class pipe_buf : public streambuf
+{
+public:
+  explicit pipe_buf(FILE* file) : file_(file), buffer_(65536) {}
+
+protected:
+  int_type
+  underflow()
+  {
+    const size_t n = fread(&buffer_[0], 1, buffer_.size(), file_);
+    if (n == 0) return traits_type::eof();
+    setg(&buffer_[0], &buffer_[0], &buffer_[0] + n);
+    return traits_type::to_int_type(buffer_[0]);
+  }
+
+private:
+  FILE* file_;
+  vector<char> buffer_;
+};
+
+double seconds_since(clock_t start)
+{ return static_cast<double>(clock() - start) / CLOCKS_PER_SEC; }
+
+void report(const char* what, size_t bytes, double seconds, size_t blocks)
+{
+  printf("%-30s %8.1f MB/s  (%lu blocks)\n", what,
+         bytes / seconds / (1024. * 1024.),
+         static_cast<unsigned long>(blocks));
+}
+
+int main(int argc, char* argv[])
+{
+  size_t size_mb = 64;
+  if (argc > 1) istringstream(argv[1]) >> size_mb;
+
+  const char* path = "streams.txt";
+  size_t bytes = 0;
+  {
+    ifstream ifs("input.txt");
+    const string input((istreambuf_iterator<char>(ifs)),
+                       istreambuf_iterator<char>());
+    ofstream ofs(path);
+    for (; bytes < size_mb * 1024 * 1024; bytes += input.length())
+    { ofs << input; }
+  }
+
+  Block block;
+  size_t blocks = 0;
+  clock_t start = clock();
+  {
+    ifstream ifs(path);
+    while (ifs)
+    {
+      block.clear();
+      if (!block.read(ifs).empty()) ++blocks;
+    }
+  }
+  report("Block::read(), ifstream:", bytes, seconds_since(start), blocks);
+
+  blocks = 0;
+  start = clock();
+  {
+    ifstream ifs(path);
+    BlockReader reader(ifs);
+    while (reader.next(block)) ++blocks;
+  }
+  report("BlockReader::next(), ifstream:", bytes, seconds_since(start),
+         blocks);
+
+  // clock() does not include the time spent by cat.
+  blocks = 0;
+  start = clock();
+  if (FILE* file = popen((string("cat ") + path).c_str(), "r"))
+  {
+    pipe_buf buf(file);
+    istream is(&buf);
+    BlockReader reader(is);
+    while (reader.next(block)) ++blocks;
+    pclose(file);
+  }
+  report("BlockReader::next(), pipe:", bytes, seconds_since(start), blocks);
+
+  remove(path);
+}
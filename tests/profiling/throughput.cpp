@@ -0,0 +1,127 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Measures the throughput of splitting input.txt, repeated up to the
+// given size in MB, into lines and fields with a char-by-char loop
+// and with detail::char_scanner, and of Coll::read() on a part of it
+// with and without Coll::read_lazy and when only the MASS blocks are
+// selected.
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+// The field splitting loop used before the introduction of
+// detail::char_scanner.
+bool scalar_next_field(const char*& pos, const char* last,
+                       const char*& field_first, const char*& field_last)
+{
+  while (pos != last && detail::is_blank(*pos)) ++pos;
+  if (pos == last || *pos == '\n') return false;
+
+  field_first = pos;
+  if (*pos == '#')
+  {
+    field_last = ++pos;
+    for (; pos != last && *pos != '\n'; ++pos)
+    { if (!detail::is_blank(*pos)) field_last = pos + 1; }
+  }
+  else
+  {
+    while (++pos != last && *pos != '\n' && *pos != '#' &&
+           !detail::is_blank(*pos)) {}
+    field_last = pos;
+  }
+  return true;
+}
+
+double seconds_since(clock_t start)
+{ return static_cast<double>(clock() - start) / CLOCKS_PER_SEC; }
+
+void report(const char* what, size_t bytes, double seconds,
+            size_t count, const char* unit)
+{
+  printf("%-26s %8.1f MB/s  (%lu MB, %lu %s)\n", what,
+         bytes / seconds / (1024. * 1024.),
+         static_cast<unsigned long>(bytes / (1024 * 1024)),
+         static_cast<unsigned long>(count), unit);
+}
+
+int main(int argc, char* argv[])
+{
+  size_t scan_mb = 256, read_mb = 32;
+  if (argc > 1) istringstream(argv[1]) >> scan_mb;
+  if (argc > 2) istringstream(argv[2]) >> read_mb;
+
+  ifstream ifs("input.txt");
+  const string input((istreambuf_iterator<char>(ifs)),
+                     istreambuf_iterator<char>());
+  string buffer;
+  buffer.reserve(scan_mb * 1024 * 1024 + input.length());
+  while (buffer.length() < scan_mb * 1024 * 1024) buffer += input;
+
+  const char* first = buffer.data();
+  const char* last = first + buffer.length();
+  const char* field_first = 0;
+  const char* field_last = 0;
+
+  size_t fields = 0;
+  clock_t start = clock();
+  for (const char* pos = first; pos != last;)
+  {
+    while (scalar_next_field(pos, last, field_first, field_last)) ++fields;
+    if (pos != last) ++pos;
+  }
+  report("char-by-char tokenizer:", buffer.length(), seconds_since(start),
+         fields, "fields");
+
+  fields = 0;
+  start = clock();
+  detail::char_scanner scanner(first, last);
+  for (const char* pos = first; pos != last;)
+  {
+    while (detail::next_field(scanner, pos, field_first, field_last)) ++fields;
+    if (pos != last) ++pos;
+  }
+  report("char_scanner tokenizer:", buffer.length(), seconds_since(start),
+         fields, "fields");
+
+  const size_t read_bytes = buffer.find("BLOCK", read_mb * 1024 * 1024);
+  start = clock();
+  Coll coll;
+  coll.read(first, first + read_bytes);
+  report("Coll::read(first, last):", read_bytes, seconds_since(start),
+         coll.size(), "blocks");
+
+  start = clock();
+  Coll lazy;
+  lazy.read(first, first + read_bytes, Coll::read_lazy);
+  report("Coll::read(.., read_lazy):", read_bytes, seconds_since(start),
+         lazy.size(), "blocks");
+
+  Block::key_type mass(1, "(any)");
+  mass.push_back("MASS");
+  start = clock();
+  Coll selected;
+  selected.read(first, first + read_bytes, Block::key_matches(mass));
+  report("Coll::read(.., MASS only):", read_bytes, seconds_since(start),
+         selected.size(), "blocks");
+
+  start = clock();
+  size_t lines = 0;
+  for (Coll::const_iterator block = lazy.begin(); block != lazy.end(); ++block)
+  { if (block->name() == "MASS") lines += block->size(); }
+  report("  then parse MASS blocks:", read_bytes, seconds_since(start),
+         lines, "lines");
+}
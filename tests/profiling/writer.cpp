@@ -0,0 +1,233 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+// Compares the time per Line of Line::str() with the
+// std::ostringstream based implementation that it replaced and with
+// Line::append_to(), the throughput of writing the Coll of input.txt
+// to an std::ostringstream before and after, the throughput of
+// Coll::str() and Coll::append_to() with that of an ostringstream,
+// and the throughput of reading input.txt, changing three masses and
+// writing it back with the different read_flags and of only copying
+// it. Finally, it measures writing a Coll read with read_verbatim.
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+const size_t rounds = 200;
+
+double seconds_since(clock_t start)
+{ return static_cast<double>(clock() - start) / CLOCKS_PER_SEC; }
+
+typedef vector<pair<string, size_t> > fields;
+
+// The fields of line with the columns at which str() writes them.
+fields columns(const Line& line)
+{
+  const string str = line.str();
+  fields result;
+  size_t pos = 0;
+  for (Line::const_iterator field = line.begin(); field != line.end();
+       ++field)
+  {
+    pos = str.find(*field, pos);
+    result.push_back(make_pair(*field, pos));
+    pos += field->length();
+  }
+  return result;
+}
+
+// Line::str() before Line::write_to() was introduced.
+string stream_str(const fields& line)
+{
+  if (line.empty()) return "";
+
+  ostringstream output;
+  int length = 0, spaces = 0;
+  for (fields::const_iterator field = line.begin(); field != line.end();
+       ++field)
+  {
+    spaces = max(0, static_cast<int>(field->second) - length + 1);
+    length += spaces + field->first.length();
+    output << setw(spaces) << " " << field->first;
+  }
+  return output.str().substr(1);
+}
+
+// Reads text with flags, changes three masses and appends the result
+// to buffer, rounds times.
+double read_modify_write(const string& text, int flags, string& buffer)
+{
+  const clock_t start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    Coll coll;
+    coll.read(text.data(), text.data() + text.length(), flags);
+    Block& mass = coll["MASS"];
+    mass["25"][1] = "1.25000000E+02";
+    mass["35"][1] = "4.25000000E+02";
+    mass["36"][1] = "4.25000000E+02";
+    buffer.clear();
+    coll.append_to(buffer);
+  }
+  return seconds_since(start);
+}
+
+int main()
+{
+  ifstream ifs("input.txt");
+  const Coll input(ifs);
+  vector<fields> lines;
+  for (Coll::const_iterator block = input.begin(); block != input.end();
+       ++block)
+  {
+    for (Block::const_iterator line = block->begin(); line != block->end();
+         ++line) lines.push_back(columns(*line));
+  }
+  const double n = 1e-9 * rounds * lines.size();
+
+  size_t length = 0;
+  clock_t start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (vector<fields>::const_iterator line = lines.begin();
+         line != lines.end(); ++line) length += stream_str(*line).length();
+  }
+  const double before = seconds_since(start);
+
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (Coll::const_iterator block = input.begin(); block != input.end();
+         ++block)
+    {
+      for (Block::const_iterator line = block->begin(); line != block->end();
+           ++line) length += line->str().length();
+    }
+  }
+  const double after = seconds_since(start);
+
+  string buffer;
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    for (Coll::const_iterator block = input.begin(); block != input.end();
+         ++block)
+    {
+      for (Block::const_iterator line = block->begin(); line != block->end();
+           ++line)
+      {
+        buffer.clear();
+        length += line->append_to(buffer).length();
+      }
+    }
+  }
+  const double append = seconds_since(start);
+
+  printf("Line::str():           before: %6.1f ns  after: %6.1f ns  "
+         "append_to(): %5.1f ns per line\n", before / n, after / n,
+         append / n);
+
+  size_t bytes = 0;
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    ostringstream os;
+    for (vector<fields>::const_iterator line = lines.begin();
+         line != lines.end(); ++line) os << stream_str(*line) << '\n';
+    bytes += os.str().length();
+  }
+  const double write_before = seconds_since(start);
+
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    ostringstream os;
+    os << input;
+    bytes += os.str().length();
+  }
+  const double write_after = seconds_since(start);
+
+  const double mb = bytes / 2 / (1024. * 1024.);
+  printf("operator<<(ostream&, const Coll&): before: %6.1f MB/s  "
+         "after: %6.1f MB/s\n", mb / write_before, mb / write_after);
+
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    ostringstream os;
+    os << input;
+    length += os.str().length();
+  }
+  const double str_before = seconds_since(start);
+
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r) length += input.str().length();
+  const double str_after = seconds_since(start);
+
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    buffer.clear();
+    length += input.append_to(buffer).length();
+  }
+  const double str_append = seconds_since(start);
+
+  printf("Coll::str():  ostringstream: %6.1f MB/s  str(): %6.1f MB/s  "
+         "append_to(): %6.1f MB/s\n", mb / str_before, mb / str_after,
+         mb / str_append);
+
+  ifstream file("input.txt");
+  const string text((istreambuf_iterator<char>(file)),
+                    istreambuf_iterator<char>());
+  const double text_mb = rounds * text.length() / (1024. * 1024.);
+
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    buffer = text;
+    length += buffer.length();
+  }
+  const double copy = seconds_since(start);
+
+  printf("read, change 3 masses, write:  copy only: %7.1f MB/s\n",
+         text_mb / copy);
+  printf("  read_default:                 %7.1f MB/s\n",
+         text_mb / read_modify_write(text, Coll::read_default, buffer));
+  printf("  read_verbatim:                %7.1f MB/s\n",
+         text_mb / read_modify_write(text, Coll::read_verbatim, buffer));
+  printf("  read_lazy:                    %7.1f MB/s\n",
+         text_mb / read_modify_write(text, Coll::read_lazy, buffer));
+  printf("  read_lazy | read_verbatim:    %7.1f MB/s\n",
+         text_mb / read_modify_write(text, Coll::read_lazy |
+                                     Coll::read_verbatim, buffer));
+
+  Coll verbatim;
+  verbatim.read(text.data(), text.data() + text.length(),
+                Coll::read_verbatim);
+  start = clock();
+  for (size_t r = 0; r < rounds; ++r)
+  {
+    buffer.clear();
+    length += verbatim.append_to(buffer).length();
+  }
+  printf("Coll::append_to() after read_verbatim: %6.1f MB/s "
+         "(output %s the input)\n", text_mb / seconds_since(start),
+         buffer == text ? "equals" : "differs from");
+  if (length == 0) printf("nothing written\n");
+}
@@ -5,7 +5,9 @@
 // (See accompanying file ../../LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <iomanip>
 #include <limits>
+#include <sstream>
 #include <string>
 #include <boost/version.hpp>
 #if BOOST_VERSION < 105900
@@ -45,6 +47,83 @@ BOOST_AUTO_TEST_CASE(testTo)
   BOOST_CHECK_CLOSE(to<float>("10.51234"), 10.51234, float_eps);
 }
 
+BOOST_AUTO_TEST_CASE(testToNumbers)
+{
+  const char* numbers[] = { "0", "-0", "1", "+1", "-1.5", "1.", ".5",
+    "2.07770048E-02", "9.7E+01", "1.0e22", "1.0e-22", "0.0000125",
+    "123456789012345", "1234567890123456", "0.1234567890123456789",
+    "1e23", "1e-300", "-3.59441868E-01", "0001.2500", "inf", "1e-320" };
+  for (int i = 0; i < 21; ++i)
+  {
+    const string number = numbers[i];
+    BOOST_CHECK_EQUAL(to<double>(number), boost::lexical_cast<double>(number));
+    BOOST_CHECK_EQUAL(to<double>(numbers[i]),
+                      boost::lexical_cast<double>(numbers[i]));
+    BOOST_CHECK_EQUAL(to<float>(number), boost::lexical_cast<float>(number));
+  }
+
+  const char* invalid[] = { "", "-", ".", "e5", "1e", "1e+", "1.2.3",
+    "1x", "1e5x", "1.0D+00", " 1", "1e999" };
+  for (int i = 0; i < 12; ++i)
+  {
+    BOOST_CHECK_THROW(to<double>(string(invalid[i])), boost::bad_lexical_cast);
+    BOOST_CHECK_THROW(to<int>(invalid[i]), boost::bad_lexical_cast);
+  }
+
+  BOOST_CHECK_EQUAL(to<int>(string("2147483647")), 2147483647);
+  BOOST_CHECK_EQUAL(to<int>("-2147483648"), numeric_limits<int>::min());
+  BOOST_CHECK_EQUAL(to<int>("+12"), 12);
+  BOOST_CHECK_EQUAL(to<long>("-1000022"), -1000022L);
+  BOOST_CHECK_EQUAL(to<unsigned>("-1"), boost::lexical_cast<unsigned>("-1"));
+  BOOST_CHECK_EQUAL(to<unsigned short>("65535"), 65535);
+  BOOST_CHECK_THROW(to<int>("2147483648"), boost::bad_lexical_cast);
+  BOOST_CHECK_THROW(to<short>("-32769"), boost::bad_lexical_cast);
+  BOOST_CHECK_THROW(to<int>("1.0"), boost::bad_lexical_cast);
+}
+
+BOOST_AUTO_TEST_CASE(testToStringNumbers)
+{
+  const double doubles[] = { 0., -0., 0.1, 1e20, 123456789., 1e-5, 97.,
+    2.07770048E-02, 1e16, 1e17, -3.59441868E-01, 5e-324,
+    numeric_limits<double>::infinity(), numeric_limits<double>::max() };
+  for (int i = 0; i < 14; ++i)
+  {
+    BOOST_CHECK_EQUAL(SLHAea::to_string(doubles[i]),
+                      boost::lexical_cast<string>(doubles[i]));
+    BOOST_CHECK_EQUAL(SLHAea::to_string(static_cast<float>(doubles[i])),
+      boost::lexical_cast<string>(static_cast<float>(doubles[i])));
+    for (int precision = 0; precision < 20; precision += 4)
+    {
+      ostringstream os;
+      os << setprecision(precision) << scientific << doubles[i];
+      BOOST_CHECK_EQUAL(SLHAea::to_string(doubles[i], precision), os.str());
+    }
+  }
+  BOOST_CHECK_EQUAL(SLHAea::to_string(1.0, -1), "1.000000e+00");
+  BOOST_CHECK_EQUAL(SLHAea::to_string(1.0, 60).length(), 66);
+
+  BOOST_CHECK_EQUAL(SLHAea::to_string(numeric_limits<int>::min()),
+                    "-2147483648");
+  BOOST_CHECK_EQUAL(SLHAea::to_string(numeric_limits<unsigned long>::max()),
+    boost::lexical_cast<string>(numeric_limits<unsigned long>::max()));
+  BOOST_CHECK_EQUAL(SLHAea::to_string(-1000022L, 8), "-1000022");
+  BOOST_CHECK_EQUAL(SLHAea::to_string('a'), "a");
+  BOOST_CHECK_EQUAL(SLHAea::to_string(string("foo"), 3), "foo");
+
+  char buffer[8];
+  char* last = write_number(buffer, buffer + 8, -1000022);
+  BOOST_REQUIRE(last != 0);
+  BOOST_CHECK_EQUAL(string(buffer, last), "-1000022");
+  BOOST_CHECK(write_number(buffer, buffer + 7, -1000022) == 0);
+  last = write_number(buffer, buffer + 8, 1.5, 2);
+  BOOST_REQUIRE(last != 0);
+  BOOST_CHECK_EQUAL(string(buffer, last), "1.50e+00");
+  BOOST_CHECK(write_number(buffer, buffer + 8, 1.5, 3) == 0);
+  last = write_number(buffer, buffer + 8, "foo");
+  BOOST_REQUIRE(last != 0);
+  BOOST_CHECK_EQUAL(string(buffer, last), "foo");
+}
+
 BOOST_AUTO_TEST_CASE(testToString)
 {
   BOOST_CHECK_EQUAL(to_string("foo"), "foo");
@@ -63,6 +142,68 @@ BOOST_AUTO_TEST_CASE(testToString)
   BOOST_CHECK_EQUAL(to_string(1.0, 4), "1.0000e+00");
 }
 
+BOOST_AUTO_TEST_CASE(testCharScanner)
+{
+  const string buffer = "a" + string(70, ' ') + "b#c \t" + string(60, '\r')
+    + "\n" + string(130, 'x') + "\v#";
+  const char* first = buffer.data();
+  const char* last = first + buffer.length();
+  char_scanner scanner(first, last);
+
+  BOOST_CHECK(scanner.find(first, char_scanner::blank) == first + 1);
+  BOOST_CHECK(scanner.find(first + 1, ~char_scanner::blank) == first + 71);
+  BOOST_CHECK(scanner.find(first, char_scanner::hash) == first + 72);
+  BOOST_CHECK(scanner.find(first, char_scanner::newline) == first + 136);
+  BOOST_CHECK(scanner.find(first + 137, ~char_scanner::other) == last - 2);
+  BOOST_CHECK(scanner.find(last - 1, char_scanner::blank) == last);
+  BOOST_CHECK(scanner.find(first, 0) == last);
+
+  const char* pos = first;
+  const char* field_first = 0;
+  const char* field_last = 0;
+  BOOST_CHECK(next_field(scanner, pos, field_first, field_last));
+  BOOST_CHECK_EQUAL(string(field_first, field_last), "a");
+  BOOST_CHECK(next_field(scanner, pos, field_first, field_last));
+  BOOST_CHECK_EQUAL(string(field_first, field_last), "b");
+  BOOST_CHECK(next_field(scanner, pos, field_first, field_last));
+  BOOST_CHECK_EQUAL(string(field_first, field_last), "#c");
+  BOOST_CHECK(!next_field(scanner, pos, field_first, field_last));
+  BOOST_CHECK(pos == first + 136);
+
+  ++pos;
+  BOOST_CHECK(next_field(scanner, pos, field_first, field_last));
+  BOOST_CHECK_EQUAL(string(field_first, field_last), string(130, 'x'));
+  BOOST_CHECK(next_field(scanner, pos, field_first, field_last));
+  BOOST_CHECK_EQUAL(string(field_first, field_last), "#");
+  BOOST_CHECK(!next_field(scanner, pos, field_first, field_last));
+  BOOST_CHECK(pos == last);
+}
+
+BOOST_AUTO_TEST_CASE(testIsBlockDefLine)
+{
+  const char* lines[] = {
+    "BLOCK MASS", " \tdecay 6 1.5\n", "Block x#", "bLoCk\t\tx",
+    "BLOCK", "BLOCK ", "BLOCK\nMASS", "BLOCK # MASS", "BLOCK#MASS",
+    "BLOCKS MASS", "# BLOCK MASS", "1 BLOCK MASS", "DECA Y"
+  };
+  for (int i = 0; i < 13; ++i)
+  {
+    const string line = lines[i];
+    BOOST_CHECK_EQUAL(is_block_def_line(line.data(),
+                                        line.data() + line.length()),
+                      Line(line).is_block_def());
+  }
+
+  const string buffer = "# x\nBLOCK a\n 1 2\n block b\n";
+  const char* first = buffer.data();
+  const char* last = first + buffer.length();
+  BOOST_CHECK(find_next_block_def(first, first, last) == first + 4);
+  BOOST_CHECK(find_next_block_def(first + 4, first, last) == first + 4);
+  BOOST_CHECK(find_next_block_def(first + 5, first, last) == first + 17);
+  BOOST_CHECK(find_next_block_def(first + 18, first, last) == last);
+  BOOST_CHECK(find_next_block_def(first + 4, first + 4, last) == first + 4);
+}
+
 BOOST_AUTO_TEST_CASE(testTrimLeftRight)
 {
   string str = "";
@@ -6,8 +6,11 @@
 // http://www.boost.org/LICENSE_1_0.txt)
 
 #include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <limits>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 #include <boost/concept/assert.hpp>
@@ -30,6 +33,7 @@ BOOST_AUTO_TEST_CASE(assertConcepts)
   BOOST_CONCEPT_ASSERT((RandomAccessIterator<Block::const_reverse_iterator>));
 
   BOOST_CONCEPT_ASSERT((UnaryPredicate<Block::key_matches, Block::value_type>));
+  BOOST_CONCEPT_ASSERT((UnaryPredicate<Block::key_pattern, Block::value_type>));
 }
 
 BOOST_AUTO_TEST_CASE(testName)
@@ -130,6 +134,57 @@ BOOST_AUTO_TEST_CASE(testReadWrite)
   BOOST_CHECK_EQUAL(b7.str(),  "BLOCK test3\n" " 3  345\n");
 }
 
+BOOST_AUTO_TEST_CASE(testReadRewind)
+{
+  string s1 =
+    "BLOCK test1\r\n" " 1  123\r\n"
+    "BLOCK test2\r\n" " 2  234\r\n"
+    "BLOCK test3";
+  stringstream ss1(s1);
+  Block b1(ss1), b2(ss1), b3(ss1);
+
+  BOOST_CHECK_EQUAL(b1.str(), "BLOCK test1\n" " 1  123\n");
+  BOOST_CHECK_EQUAL(b2.str(), "BLOCK test2\n" " 2  234\n");
+  BOOST_CHECK_EQUAL(b3.str(), "BLOCK test3\n");
+  BOOST_CHECK_EQUAL(ss1.eof(), true);
+
+  // A stream buffer that cannot be repositioned.
+  struct unseekable_buf : std::streambuf
+  {
+    explicit unseekable_buf(string& str)
+    { setg(&str[0], &str[0], &str[0] + str.length()); }
+  };
+  unseekable_buf buf(s1);
+  istream is1(&buf);
+  Block b4(is1);
+
+  BOOST_CHECK_EQUAL(b4.str(), "BLOCK test1\n" " 1  123\n");
+  BOOST_CHECK_EQUAL(is1.fail(), true);
+}
+
+BOOST_AUTO_TEST_CASE(testReadFile)
+{
+  const char* path = "block_read_file.txt";
+  {
+    ofstream ofs(path);
+    ofs << "\n# comment\n" "BLOCK test1\n" " 1  123\n"
+           "BLOCK test2\n" " 2  234\n";
+  }
+
+  Block b1, b2("test");
+  b1.read_file(path);
+  b2.read_file(path);
+
+  BOOST_CHECK_EQUAL(b1.name(), "test1");
+  BOOST_CHECK_EQUAL(b2.name(), "test");
+  BOOST_CHECK_EQUAL(b1.size(), 3);
+  BOOST_CHECK_EQUAL(b1.str(),  "# comment\n" "BLOCK test1\n" " 1  123\n");
+  BOOST_CHECK_EQUAL(b1.str(),  b2.str());
+
+  remove(path);
+  BOOST_CHECK_THROW(b1.read_file(path), std::runtime_error);
+}
+
 BOOST_AUTO_TEST_CASE(testSubscriptAtAccessors)
 {
   Block b1;
@@ -216,6 +271,48 @@ BOOST_AUTO_TEST_CASE(testSubscriptAtAccessors)
   BOOST_CHECK_THROW(cb1.at(no_ind), out_of_range);
 }
 
+BOOST_AUTO_TEST_CASE(testIntKeys)
+{
+  Block b1;
+  b1.str("BLOCK test\n 01 1 a\n +1 1 b\n -1 1 c\n 1 -1 d\n 1 1 e\n"
+         " -2147483648 2147483647 f\n 1 1 g\n");
+
+  for (int i = 0; i < 2; ++i) {
+    b1.use_index(i == 1);
+    const Block& cb1 = b1;
+
+    BOOST_CHECK_EQUAL(b1.at(1, 1).at(2), "e");
+    BOOST_CHECK_EQUAL(cb1.at(1, 1).at(2), "e");
+    BOOST_CHECK_EQUAL(b1.at(-1).at(2), "c");
+    BOOST_CHECK_EQUAL(b1.at(1, -1).at(2), "d");
+    BOOST_CHECK_EQUAL(b1.at(numeric_limits<int>::min(),
+                            numeric_limits<int>::max()).at(2), "f");
+    BOOST_CHECK_EQUAL(b1[1].at(2), "d");
+
+    vector<int> vi1(2, 1);
+    BOOST_CHECK_EQUAL(b1.at(vi1).at(2), "e");
+    BOOST_CHECK_EQUAL(cb1.at(vi1).at(2), "e");
+    BOOST_CHECK_EQUAL(b1[vi1].at(2), "e");
+    vi1.push_back(2);
+    BOOST_CHECK_THROW(cb1.at(vi1), out_of_range);
+    BOOST_CHECK_THROW(cb1.at(vector<int>()), out_of_range);
+    BOOST_CHECK_THROW(cb1.at(1, 10), out_of_range);
+  }
+
+  try {
+    b1.at(3, -4);
+    BOOST_ERROR("out_of_range not thrown");
+  }
+  catch (const out_of_range& e) {
+    BOOST_CHECK_EQUAL(e.what(), string("SLHAea::Block::at(‘3,-4’)"));
+  }
+
+  const size_t size = b1.size();
+  b1[2] = " 2 2 h";
+  BOOST_CHECK_EQUAL(b1.size(), size + 1);
+  BOOST_CHECK_EQUAL(b1.at(2, 2).at(2), "h");
+}
+
 BOOST_AUTO_TEST_CASE(testGeneralAccessors)
 {
   Block b1;
@@ -797,6 +894,191 @@ BOOST_AUTO_TEST_CASE(testKeyMatches)
   BOOST_CHECK_EQUAL(pred(l1), false);
 }
 
+BOOST_AUTO_TEST_CASE(testKeyPattern)
+{
+  Block b1;
+  b1.str("DECAY 1000022 2.5\n 0.5 2 13 24\n 0.2 2 -13 24\n"
+         " 0.1 3 13 24 22 # radiative\n 0.1 2 13 -24\n 0.1 2 abc 24\n");
+
+  const char* keys[] = { "(any) 2 13 24", "(any) 2 13", "0.5 2 13 24",
+    "0.5 2 13 24 (any)", "(any)", "(any) (any) (any) (any) (any)",
+    "DeCaY 1000022", "(any) 2 ABC", "(any) 2 ab", "(any) (any) 24",
+    "(any) 2 (any) 24", "# radiative", "(any) (any) (any) (any) 22" };
+  for (int i = 0; i < 13; ++i) {
+    vector<string> key;
+    boost::split(key, keys[i], boost::is_any_of(" "));
+    const Block::key_matches pred(key);
+    const Block::key_pattern pattern(key);
+    for (Block::const_iterator line = b1.begin(); line != b1.end(); ++line)
+    { BOOST_CHECK_MESSAGE(pattern(*line) == pred(*line), keys[i]); }
+    BOOST_CHECK(b1.find(pattern) == b1.find(key));
+    BOOST_CHECK_EQUAL(b1.count(pattern), b1.count(key));
+  }
+  BOOST_CHECK_EQUAL(Block::key_pattern(vector<string>())(b1.front()), false);
+
+  vector<string> key(2, "(any)");
+  key.push_back("13");
+  const Block::key_pattern pattern(key);
+  const Block& cb1 = b1;
+  BOOST_CHECK(cb1.find(pattern) == cb1.begin() + 1);
+  BOOST_CHECK_EQUAL(cb1.count(pattern), 3);
+  BOOST_CHECK_EQUAL(b1.erase(pattern), 3);
+  BOOST_CHECK_EQUAL(b1.size(), 3);
+  BOOST_CHECK(b1.find(pattern) == b1.end());
+}
+
+BOOST_AUTO_TEST_CASE(testIndex)
+{
+  Block b1, b2;
+  b1.str("BLOCK NMIX\n 1 1 0.9\n 1 2 -0.1\n 2 1 0.2 # c\n 2 2 0.8\n"
+         "# comment\n 1 1 0.5\n 10 1 1\n");
+  b2 = b1;
+  BOOST_CHECK_EQUAL(b2.uses_index(), false);
+  b2.use_index();
+  BOOST_CHECK_EQUAL(b2.uses_index(), true);
+
+  const char* keys[] = { "1 1", "2 1", "1", "10 1 1", "block nmix",
+    "# comment", "1 3", "1 1 0.9", "(any) 2", "1 1 0.9 x y z" };
+  for (int i = 0; i < 10; ++i) {
+    vector<string> key;
+    boost::split(key, keys[i], boost::is_any_of(" "));
+    BOOST_CHECK(b2.find(key) - b2.begin() == b1.find(key) - b1.begin());
+  }
+  BOOST_CHECK_EQUAL(b2.at(1, 2).at(2), "-0.1");
+  BOOST_CHECK_EQUAL(b2.at("2", "1").at(2), "0.2");
+  BOOST_CHECK_EQUAL(b2.at("(any)", "2").at(2), "-0.1");
+  BOOST_CHECK_THROW(b2.at(3, 3), std::out_of_range);
+
+  b2.push_back(" 3 3 1");
+  b2.push_back(" 1 2 0");
+  BOOST_CHECK_EQUAL(b2.at(3, 3).at(2), "1");
+  BOOST_CHECK_EQUAL(b2.at(1, 2).at(2), "-0.1");
+
+  b2.erase(b2.begin() + 2);
+  BOOST_CHECK_EQUAL(b2.at(1, 2).at(2), "0");
+  b2.insert(b2.begin() + 1, Line(" 2 2 0.7"));
+  BOOST_CHECK_EQUAL(b2.at(2, 2).at(2), "0.7");
+  b2.pop_back();
+  BOOST_CHECK_THROW(b2.at(1, 2), std::out_of_range);
+
+  b2["4"] = " 4 4 1";
+  BOOST_CHECK_EQUAL(b2.at(4, 4).at(2), "1");
+
+  // Changes through a reference are noticed if they remove a key.
+  b2.at(2, 1)[0] = "5";
+  BOOST_CHECK_THROW(b2.at(2, 1), std::out_of_range);
+  BOOST_CHECK_EQUAL(b2.at(5, 1).at(2), "0.2");
+
+  b2.comment();
+  BOOST_CHECK_THROW(b2.at(5, 1), std::out_of_range);
+  b2.uncomment();
+  BOOST_CHECK_EQUAL(b2.at(5, 1).at(2), "0.2");
+
+  Block b3;
+  b3.swap(b2);
+  BOOST_CHECK_EQUAL(b3.uses_index(), true);
+  BOOST_CHECK_EQUAL(b3.at(5, 1).at(2), "0.2");
+  b3.use_index(false);
+  BOOST_CHECK_EQUAL(b3.uses_index(), false);
+  BOOST_CHECK_EQUAL(b3.at(5, 1).at(2), "0.2");
+  // Keys whose strings contain spaces are joined to the same string.
+  Block b4;
+  b4.use_index();
+  b4.push_back(Line() << "a" << "b c" << 1);
+  b4.push_back(Line() << "a b" << "c" << 2);
+  BOOST_CHECK_EQUAL(b4.at("a b", "c").at(2), "2");
+  BOOST_CHECK_EQUAL(b4.at("a b", "c").at(2), "2");
+  BOOST_CHECK_EQUAL(b4.at("a", "b c").at(2), "1");
+  BOOST_CHECK_THROW(b4.at("a", "b"), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(testMatrix)
+{
+  Block b1;
+  b1.str("BLOCK NMIX  # comment\n 1 1 0.9\n 1 2 -0.1\n 2 1 0.2 # c\n"
+         "# comment\n 2 3 0.5\n");
+
+  Matrix<double> m1 = b1.as_matrix<double>();
+  BOOST_CHECK_EQUAL(m1.rank(), 2);
+  BOOST_CHECK_EQUAL(m1.rows(), 2);
+  BOOST_CHECK_EQUAL(m1.cols(), 3);
+  BOOST_CHECK_EQUAL(m1.size(), 6);
+  BOOST_CHECK_EQUAL(m1(1, 1), 0.9);
+  BOOST_CHECK_EQUAL(m1(1, 2), -0.1);
+  BOOST_CHECK_EQUAL(m1(1, 3), 0.);
+  BOOST_CHECK_EQUAL(m1(2, 1), 0.2);
+  BOOST_CHECK_EQUAL(m1(2, 2), 0.);
+  BOOST_CHECK_EQUAL(m1.at(2, 3), 0.5);
+  BOOST_CHECK_EQUAL(m1.data()[5], 0.5);
+  BOOST_CHECK_THROW(m1.at(3, 1), std::out_of_range);
+  BOOST_CHECK_THROW(m1.at(0, 1), std::out_of_range);
+  BOOST_CHECK_THROW(m1.at(1), std::out_of_range);
+  BOOST_CHECK_THROW(m1.at(1, 1, 1), std::out_of_range);
+
+  Block b2;
+  b2.str("BLOCK KaiminiCovarianceMatrix\n 1 1 11\n 1 2 12\n 1 3 13\n"
+         " 2 2 22\n 2 3 23\n 3 3 33\n 3 1 -31\n");
+  Matrix<int> m2 = b2.as_matrix<int>(2, Block::symmetric_matrix);
+  BOOST_CHECK_EQUAL(m2.rows(), 3);
+  BOOST_CHECK_EQUAL(m2.cols(), 3);
+  BOOST_CHECK_EQUAL(m2(2, 1), 12);
+  BOOST_CHECK_EQUAL(m2(3, 2), 23);
+  BOOST_CHECK_EQUAL(m2(3, 1), -31);
+  BOOST_CHECK_EQUAL(m2(1, 3), 13);
+  BOOST_CHECK_THROW(b2.as_matrix<int>(3, Block::symmetric_matrix),
+    std::invalid_argument);
+
+  Block b3;
+  b3.str("BLOCK RVLAMLLE\n 1 2 3 0.1\n 2 1 3 -0.1\n 1 3 2 0.2\n");
+  Matrix<double> m3(b3, 3);
+  BOOST_CHECK_EQUAL(m3.rank(), 3);
+  BOOST_CHECK_EQUAL(m3.extent(0), 2);
+  BOOST_CHECK_EQUAL(m3.extent(1), 3);
+  BOOST_CHECK_EQUAL(m3.extent(2), 3);
+  BOOST_CHECK_EQUAL(m3(1, 2, 3), 0.1);
+  BOOST_CHECK_EQUAL(m3(2, 1, 3), -0.1);
+  BOOST_CHECK_EQUAL(m3.at(1, 3, 2), 0.2);
+  BOOST_CHECK_EQUAL(m3(2, 3, 3), 0.);
+  BOOST_CHECK_EQUAL(std::count(m3.begin(), m3.end(), 0.), 15);
+
+  Block b4;
+  b4.str("BLOCK MASS\n 1 4.8\n 3 173.2\n");
+  Matrix<double> m4 = b4.as_matrix<double>(1);
+  BOOST_CHECK_EQUAL(m4.rows(), 3);
+  BOOST_CHECK_EQUAL(m4.cols(), 1);
+  BOOST_CHECK_EQUAL(m4(3), 173.2);
+  BOOST_CHECK_THROW(b4.as_matrix<double>(2), std::invalid_argument);
+  BOOST_CHECK_THROW(b4.as_matrix<double>(0), std::invalid_argument);
+
+  Block b5;
+  b5.str("BLOCK test\n 1 x\n");
+  BOOST_CHECK_THROW(b5.as_matrix<double>(1), boost::bad_lexical_cast);
+  b5.str("BLOCK test\n 0 1\n");
+  BOOST_CHECK_THROW(b5.as_matrix<double>(1), std::invalid_argument);
+  b5.str("BLOCK test\n 2097152 1 1 1\n 1 2097152 1 1\n 1 1 4194304 1\n");
+  BOOST_CHECK_THROW(b5.as_matrix<double>(3), std::invalid_argument);
+  b5.str("BLOCK test\n 999999999 999999999 1\n");
+  BOOST_CHECK_THROW(b5.as_matrix<double>(2), std::invalid_argument);
+  b5.str("BLOCK test\n");
+  BOOST_CHECK(b5.as_matrix<double>(2).empty());
+  BOOST_CHECK(Matrix<double>().data() == 0);
+
+  // Structural modifications are noticed by update().
+  BOOST_CHECK_EQUAL(m1.update(), false);
+  b1.push_back(" 3 1 0.3");
+  BOOST_CHECK_EQUAL(m1.update(), true);
+  BOOST_CHECK_EQUAL(m1.rows(), 3);
+  BOOST_CHECK_EQUAL(m1(3, 1), 0.3);
+  b1.erase(b1.begin() + 1);
+  BOOST_CHECK_EQUAL(m1.update(), true);
+  BOOST_CHECK_EQUAL(m1(1, 1), 0.);
+  b1.at(3, 1)[2] = "0.4";
+  BOOST_CHECK_EQUAL(m1.update(), false);
+  BOOST_CHECK_EQUAL(m1(3, 1), 0.3);
+  m1.assign(b1);
+  BOOST_CHECK_EQUAL(m1(3, 1), 0.4);
+}
+
 BOOST_AUTO_TEST_CASE(testInEquality)
 {
   Block b1("t1");
@@ -5,9 +5,13 @@
 // (See accompanying file ../../LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <cstdio>
+#include <fstream>
+#include <iterator>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include <boost/concept/assert.hpp>
 #include <boost/test/unit_test.hpp>
 #include "slhaea.h"
@@ -90,6 +94,233 @@ BOOST_FIXTURE_TEST_CASE(testReadWrite, F) {
   BOOST_CHECK_EQUAL(c4.size(), 0);
 }
 
+BOOST_FIXTURE_TEST_CASE(testReadFile, F) {
+  const char* path = "coll_read_file.txt";
+  {
+    ofstream ofs(path);
+    ofs << "# leading comment\r\n" << fs2 << " 4  3";
+  }
+
+  Coll c1, c2;
+  c1.read_file(path);
+  c2.str("# leading comment\r\n" + fs2 + " 4  3");
+
+  BOOST_CHECK_EQUAL(c1, c2);
+  BOOST_CHECK_EQUAL(c1.size(), 5);
+  BOOST_CHECK_EQUAL(c1.back().size(), 4);
+
+  c1.read_file(path);
+  BOOST_CHECK_EQUAL(c1.size(), 10);
+
+  {
+    ofstream ofs(path);
+  }
+  Coll c3;
+  c3.read_file(path);
+  BOOST_CHECK_EQUAL(c3.empty(), true);
+
+  remove(path);
+  BOOST_CHECK_THROW(c3.read_file(path), std::runtime_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(testReadParallel, F) {
+  string s1 = "# no block yet\n \n";
+  for (int i = 0; i < 2000; ++i) {
+    s1 += (i % 3 == 0) ? fs1 : fs2;
+    s1 += "DECAY 1000022 1.0\n  0.5 2 22 1000022\n"
+          " decay 1000023 # not a block definition\n";
+  }
+
+  Coll c1, c2;
+  c1.read(s1.data(), s1.data() + s1.length());
+  c2.read(s1.data(), s1.data() + s1.length(), Coll::read_parallel);
+
+  BOOST_CHECK_EQUAL(c1.size(), c2.size());
+  BOOST_CHECK(c1 == c2);
+  BOOST_CHECK_EQUAL(c2.front().name(), "");
+  BOOST_CHECK_EQUAL(c2.front().size(), 1);
+
+  string s2 = fs2 + fs1;
+  c1.clear();
+  c2.clear();
+  c1.read(s2.data(), s2.data() + s2.length());
+  c2.read(s2.data(), s2.data() + s2.length(), Coll::read_parallel);
+  BOOST_CHECK(c1 == c2);
+  BOOST_CHECK_EQUAL(c2.front().name(), "test1");
+
+  c2.read(s2.data(), s2.data(), Coll::read_parallel);
+  BOOST_CHECK(c1 == c2);
+}
+
+BOOST_FIXTURE_TEST_CASE(testReadLazy, F) {
+  string s1 = "# leading comment\n" + fs2 + " 4  3   # untouched\n 4 4";
+
+  Coll c1, c2;
+  c1.read(s1.data(), s1.data() + s1.length());
+  {
+    const string tmp = s1;
+    c2.read(tmp.data(), tmp.data() + tmp.length(), Coll::read_lazy);
+  }
+
+  BOOST_CHECK_EQUAL(c2.size(), 5);
+  BOOST_CHECK_EQUAL(c2.front().name(), "");
+  BOOST_CHECK_EQUAL(c2.back().name(), "test4");
+  BOOST_CHECK_EQUAL(c2.str(), "# leading comment\n"
+    "BLOCK test1\n 1  1\n 1  2\n"
+    "Block test2\n 2  1\n 2  2\n \t  \n     \n"
+    "bLoCk test3\n 3  1\n 3  2\n"
+    "BlOcK test4\n 4  1\n 4  2\n 4  3   # untouched\n 4 4\n");
+
+  BOOST_CHECK_EQUAL(c2.at("test3").at("3").at(1), "1");
+  BOOST_CHECK_EQUAL(c2.at("test3").size(), 3);
+  BOOST_CHECK_EQUAL(c2.at("test3").str(), "bLoCk test3\n 3  1\n 3  2\n");
+  Block::key_type key(1, "block");
+  key.push_back("TEST4");
+  BOOST_CHECK(c2.find(key) == c2.begin() + 4);
+
+  const Coll c3 = c2;
+  BOOST_CHECK_EQUAL(c3.back().back().str(), " 4 4");
+  BOOST_CHECK(c1 == c2);
+  BOOST_CHECK(c1 == c3);
+
+  const char* path = "coll_read_lazy.txt";
+  {
+    ofstream ofs(path);
+    ofs << s1;
+  }
+  c2.clear();
+  c2.read_file(path, Coll::read_lazy | Coll::read_parallel);
+  remove(path);
+  BOOST_CHECK(c1 == c2);
+
+  c2.read(s1.data(), s1.data(), Coll::read_lazy);
+  BOOST_CHECK(c1 == c2);
+}
+
+bool is_neutralino_decay(const Line& block_def) {
+  return block_def.size() > 2 && block_def[1] == "1000022";
+}
+
+BOOST_FIXTURE_TEST_CASE(testReadFiltered, F) {
+  string s1 = "# leading comment\n" + fs2 +
+    "DECAY 1000022 1.0\n  0.5 2 22 1000022\n"
+    "DECAY 1000023 2.0\n  0.5 2 22 1000022\n"
+    "BLOCK test1\n 5  5\n";
+
+  vector<string> names;
+  names.push_back("TEST3");
+  names.push_back("test1");
+
+  Coll c1;
+  c1.read(s1.data(), s1.data() + s1.length(), names);
+  BOOST_CHECK_EQUAL(c1.size(), 2);
+  BOOST_CHECK_EQUAL(c1.str(), "BLOCK test1\n 1  1\n 1  2\n"
+                              "bLoCk test3\n 3  1\n 3  2\n");
+
+  names.push_back("test5");
+  c1.clear();
+  c1.read(s1.data(), s1.data() + s1.length(), names);
+  BOOST_CHECK_EQUAL(c1.size(), 2);
+  BOOST_CHECK_EQUAL(c1.front().str(), "BLOCK test1\n 1  1\n 1  2\n");
+
+  c1.clear();
+  c1.read(fs2.data(), fs2.data() + fs2.length(), names);
+  BOOST_CHECK_EQUAL(c1.size(), 2);
+  BOOST_CHECK_EQUAL(c1.front().name(), "test1");
+
+  c1.clear();
+  c1.read(s1.data(), s1.data() + s1.length(), is_neutralino_decay);
+  BOOST_CHECK_EQUAL(c1.size(), 1);
+  BOOST_CHECK_EQUAL(c1.front().name(), "1000022");
+  BOOST_CHECK_EQUAL(c1.front().size(), 2);
+
+  Block::key_type key(1, "(any)");
+  key.push_back("test2");
+  c1.read(s1.data(), s1.data() + s1.length(), Block::key_matches(key));
+  BOOST_CHECK_EQUAL(c1.size(), 2);
+  BOOST_CHECK_EQUAL(c1.back().str(), "Block test2\n 2  1\n 2  2\n");
+
+  const char* path = "coll_read_filtered.txt";
+  {
+    ofstream ofs(path);
+    ofs << s1;
+  }
+  Coll c2;
+  c2.read_file(path, vector<string>(1, "test4"));
+  c2.read_file(path, is_neutralino_decay);
+  remove(path);
+  BOOST_CHECK_EQUAL(c2.size(), 2);
+  BOOST_CHECK_EQUAL(c2.front().name(), "test4");
+  BOOST_CHECK_EQUAL(c2.back().name(), "1000022");
+  BOOST_CHECK_THROW(c2.read_file(path, names), std::runtime_error);
+}
+
+BOOST_FIXTURE_TEST_CASE(testIndex, F) {
+  Coll c1, c2;
+  c1.str(fs2);
+  c2.str(fs2);
+  BOOST_CHECK_EQUAL(c2.uses_index(), false);
+  c2.use_index();
+  BOOST_CHECK_EQUAL(c2.uses_index(), true);
+
+  const char* names[] = { "test1", "TEST2", "test3", "Test4", "test5" };
+  for (int i = 0; i < 5; ++i) {
+    BOOST_CHECK(c2.find(names[i]) - c2.begin() ==
+                c1.find(names[i]) - c1.begin());
+    BOOST_CHECK_EQUAL(c2.count(names[i]), c1.count(names[i]));
+  }
+  BOOST_CHECK_EQUAL(c2.at("test3").at("3").at(1), "1");
+  BOOST_CHECK_THROW(c2.at("test5"), std::out_of_range);
+
+  c2.push_back("BLOCK test1\n 5 5\n");
+  c2.push_back("BLOCK test5\n 5 5\n");
+  BOOST_CHECK(c2.find("test1") == c2.begin());
+  BOOST_CHECK(c2.find("test5") == c2.begin() + 5);
+  BOOST_CHECK_EQUAL(c2.count("TEST1"), 2);
+
+  c2.erase_first("test1");
+  BOOST_CHECK(c2.find("test1") == c2.begin() + 3);
+  BOOST_CHECK(c2.find("test2") == c2.begin());
+  BOOST_CHECK_EQUAL(c2.count("test1"), 1);
+
+  c2.push_front("BLOCK test5\n");
+  BOOST_CHECK(c2.find("test5") == c2.begin());
+  c2.insert(c2.begin(), Block("test4"));
+  BOOST_CHECK(c2.find("test4") == c2.begin());
+  c2.pop_back();
+  BOOST_CHECK_EQUAL(c2.count("test5"), 1);
+
+  c2["test6"][""] = "6 6";
+  BOOST_CHECK(c2.find("test6") == c2.end() - 1);
+
+  // Renaming through a reference is noticed if it removes a name.
+  c2.find("test2")->name("test7");
+  BOOST_CHECK(c2.find("test2") == c2.end());
+  BOOST_CHECK(c2.find("test7") == c2.begin() + 2);
+
+  // A lookup of the new name alone does not notice the renaming, so
+  // the index must be rebuilt with use_index().
+  c2.find("test7")->name("test8");
+  c2.use_index();
+  BOOST_CHECK(c2.find("test8") == c2.begin() + 2);
+  BOOST_CHECK(c2.find("test7") == c2.end());
+  const Coll& cc2 = c2;
+  c2.begin()[2].name("test7");
+  BOOST_CHECK(cc2.find("test8") == cc2.end());
+  BOOST_CHECK(cc2.find("test7") == cc2.begin() + 2);
+
+  Coll c3;
+  c3.swap(c2);
+  BOOST_CHECK_EQUAL(c3.uses_index(), true);
+  BOOST_CHECK(c3.find("test7") == c3.begin() + 2);
+  c3.clear();
+  BOOST_CHECK(c3.find("test7") == c3.end());
+
+  c2 = c1;
+  c2.use_index(false);
+  BOOST_CHECK(c2.find("test4") == c2.begin() + 3);
+}
+
 BOOST_AUTO_TEST_CASE(testDuplicatedBlocks) {
   string s1 =
     "BLOCK test1\n"
@@ -159,6 +390,46 @@ BOOST_FIXTURE_TEST_CASE(testField, F) {
   BOOST_CHECK_EQUAL(c1.field("test2;4;1"),         "4.15");
 }
 
+BOOST_FIXTURE_TEST_CASE(testFields, F) {
+  Coll c1;
+  c1.str(fs1 + "BLOCK test1\n 1 2 3\n 5 5\nBLOCK test3\n 1 0.5\n 2 x\n");
+  const Coll& cc1 = c1;
+
+  const char* strings[] = { "TEST2;4,3;1", "test1;2;2", "test1;5;1",
+    "test4;1;1", "test2;2;5", "test2;(any),2;0", "test1;BLOCK,test1;1",
+    "test1;1;1", "test1;1;1", "test3;1;1", "test3;2;1", "test3;3;1",
+    "test1;(any);0", "test2;4,3,9;0" };
+  const vector<Key> keys(strings, strings + 14);
+
+  vector<const string*> found(keys.size());
+  BOOST_CHECK(c1.fields(keys, found.begin()) == found.end());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    const string* expected = 0;
+    try { expected = &cc1.field(keys[i]); }
+    catch (const out_of_range&) {}
+    BOOST_CHECK_MESSAGE(found[i] == expected, keys[i].str());
+  }
+  BOOST_CHECK_EQUAL(*found[0], "3");
+  BOOST_CHECK_EQUAL(*found[5], "3");
+  BOOST_CHECK(found[2] == 0);
+  BOOST_CHECK(found[4] == 0);
+  BOOST_CHECK(found[13] == 0);
+
+  vector<boost::optional<double> > values(keys.size());
+  cc1.get_many<double>(keys, values.begin());
+  BOOST_CHECK_EQUAL(values[0].get(), 3.);
+  BOOST_CHECK_EQUAL(values[9].get(), 0.5);
+  BOOST_CHECK(!values[1]);
+  BOOST_CHECK(!values[3]);
+  BOOST_CHECK(!values[10]);
+
+  found.clear();
+  Coll().fields(keys, back_inserter(found));
+  BOOST_CHECK(count(found.begin(), found.end(), (const string*) 0) == 14);
+  cc1.fields(vector<Key>(), back_inserter(found));
+  BOOST_CHECK_EQUAL(found.size(), 14);
+}
+
 BOOST_FIXTURE_TEST_CASE(testLine, F) {
   Coll c1;
   c1.str(fs1);
@@ -650,6 +921,129 @@ BOOST_AUTO_TEST_CASE(testReformat) {
                     "    1   2   3   4\n");
 }
 
+BOOST_AUTO_TEST_CASE(testReadVerbatim) {
+  const string s1 = "# header  \n"
+                    "Block MASS\t# masses\r\n"
+                    "\t25  1.25E+02   # h\r\n"
+                    "  35\t4.0e+02\n"
+                    "\n"
+                    "BLOCK test\n"
+                    "   1   2   3";
+  const string verbatim = "# header  \n"
+                          "Block MASS\t# masses\r\n"
+                          "\t25  1.25E+02   # h\r\n"
+                          "  35\t4.0e+02\n"
+                          "BLOCK test\n"
+                          "   1   2   3\n";
+
+  Coll c1, c2;
+  c1.read(s1.data(), s1.data() + s1.length());
+  c2.read(s1.data(), s1.data() + s1.length(), Coll::read_verbatim);
+  BOOST_CHECK_EQUAL(c1.str(), "# header\n"
+                              "Block MASS # masses\n"
+                              " 25  1.25E+02   # h\n"
+                              "  35 4.0e+02\n"
+                              "BLOCK test\n"
+                              "   1   2   3\n");
+  BOOST_CHECK_EQUAL(c2.str(), verbatim);
+  BOOST_CHECK_EQUAL(c2.formatted_length(), verbatim.length());
+  BOOST_CHECK_EQUAL(c2.at("MASS").at("25").str(), "\t25  1.25E+02   # h\r");
+
+  const Coll c3 = c2;
+  BOOST_CHECK_EQUAL(c3.str(), verbatim);
+  BOOST_CHECK_EQUAL(c3.at("MASS").at("35").at(1), "4.0e+02");
+  BOOST_CHECK_EQUAL(c3.at("MASS").at("35").as<double>(1), 400.);
+  BOOST_CHECK_EQUAL(c3.str(), verbatim);
+  // Copies keep both the original text and the cached values.
+  const Coll c7 = c3;
+  BOOST_CHECK_EQUAL(c7.str(), verbatim);
+  BOOST_CHECK_EQUAL(c7.at("MASS").at("35").as<double>(1), 400.);
+
+  c2["MASS"]["25"][1] = "1.26E+02";
+  BOOST_CHECK_EQUAL(c2.str(), "# header  \n"
+                              "Block MASS\t# masses\r\n"
+                              " 25  1.26E+02   # h\n"
+                              "  35\t4.0e+02\n"
+                              "BLOCK test\n"
+                              "   1   2   3\n");
+  c2["MASS"]["35"] << "# H";
+  BOOST_CHECK_EQUAL(c2.at("MASS").at("35").str(), "    35  4.0e+02     # H");
+  c2.at("MASS").front().reformat();
+  BOOST_CHECK_EQUAL(c2.at("MASS").front().str(), "Block MASS  # masses");
+  c2.front().comment();
+  BOOST_CHECK_EQUAL(c2.front().front().str(), "## header");
+  BOOST_CHECK_EQUAL(c2.back().str(), "BLOCK test\n   1   2   3\n");
+  c2.back().back().clear();
+  BOOST_CHECK_EQUAL(c2.back().str(), "BLOCK test\n\n");
+
+  Line l1 = c3.at("test").back();
+  BOOST_CHECK_EQUAL(l1.str(), "   1   2   3");
+  l1.str("1 2");
+  BOOST_CHECK_EQUAL(l1.str(), "1 2");
+
+  Coll c4;
+  c4.read(s1.data(), s1.data() + s1.length(),
+          Coll::read_verbatim | Coll::read_parallel);
+  BOOST_CHECK_EQUAL(c4.str(), verbatim);
+  c4.clear();
+  c4.read(s1.data(), s1.data() + s1.length(),
+          Coll::read_verbatim | Coll::read_lazy);
+  BOOST_CHECK_EQUAL(c4.at("MASS").size(), 3);
+  BOOST_CHECK_EQUAL(c4.str(), verbatim);
+  BOOST_CHECK(c4 == c3);
+
+  // Equality does not depend on the original text.
+  const string s2 = "BLOCK A\n 1 2\t\n";
+  const string s3 = "BLOCK A\r\n 1 2\n";
+  Coll c5, c6;
+  c5.read(s2.data(), s2.data() + s2.length(), Coll::read_verbatim);
+  c6.read(s3.data(), s3.data() + s3.length());
+  BOOST_CHECK(c5 == c6);
+  BOOST_CHECK(c5.at("A").at("1") == c6.at("A").at("1"));
+  c6.clear();
+  c6.read(s3.data(), s3.data() + s3.length(), Coll::read_verbatim);
+  BOOST_CHECK(c5 == c6);
+  c6["A"]["1"].str(" 1   2");
+  BOOST_CHECK(c5 != c6);
+}
+
+BOOST_FIXTURE_TEST_CASE(testWriteTo, F) {
+  Coll c1;
+  c1.str(fs1 + "  1000022  -2.5e+02   # neutralino\n");
+
+  ostringstream legacy;
+  copy(c1.begin(), c1.end(), ostream_iterator<Block>(legacy));
+  BOOST_CHECK_EQUAL(c1.str(), legacy.str());
+  BOOST_CHECK_EQUAL(c1.formatted_length(), legacy.str().length());
+
+  ostringstream os;
+  os << c1;
+  BOOST_CHECK_EQUAL(os.str(), legacy.str());
+  BOOST_CHECK_EQUAL(c1.front().str() + c1.back().str(), legacy.str());
+  BOOST_CHECK_EQUAL(c1.back().formatted_length(), c1.back().str().length());
+
+  string buffer = "head\n";
+  BOOST_CHECK_EQUAL(c1.append_to(buffer), "head\n" + legacy.str());
+  buffer.clear();
+  c1.back().append_to(buffer);
+  BOOST_CHECK_EQUAL(buffer, c1.back().str());
+
+  Coll c2;
+  const string s2 = fs2 + " 4  3   # untouched";
+  c2.read(s2.data(), s2.data() + s2.length(), Coll::read_lazy);
+  BOOST_CHECK_EQUAL(c2.str(), s2 + "\n");
+  BOOST_CHECK_EQUAL(c2.formatted_length(), s2.length() + 1);
+  c2.back().reformat();
+  BOOST_CHECK_EQUAL(c2.str(), fs2.substr(0, fs2.find("BlOcK")) +
+                    "BlOcK test4\n"
+                    "    4   1\n"
+                    "    4   2\n"
+                    "    4   3   # untouched\n");
+
+  BOOST_CHECK_EQUAL(Coll().str(), "");
+  BOOST_CHECK_EQUAL(Coll().formatted_length(), 0);
+}
+
 BOOST_FIXTURE_TEST_CASE(testUnComment, F) {
   Coll c1;
   c1.str(fs1);
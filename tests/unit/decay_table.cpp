@@ -0,0 +1,120 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+BOOST_AUTO_TEST_SUITE(TestDecayTable)
+
+const string decays =
+  "BLOCK MASS\n"
+  "   1000022   9.7E+01\n"
+  "#         PDG            Width\n"
+  "DECAY   1000023     2.07770048E-02   # neutralino2 decays\n"
+  "#          BR         NDA      ID1       ID2\n"
+  "     1.0E-01          2     1000022        23   # BR(~chi_20 -> ~chi_10   Z )\n"
+  "     2.5E-01          2          25   1000022   # BR(~chi_20 -> ~chi_10   h )\n"
+  "     5.0E-01          2    -2000011        11\n"
+  "     1.0E-01          2     2000011       -11\n"
+  "     2.5E-02          3     1000022        -1         1\n"
+  "     2.5E-02          3     1000022         1        -1\n"
+  "decay   1000022     0.0\n"
+  "DECAY   25     4.0E-03\n"
+  "     0.6   2   5  -5\n"
+  "DECAY   25     1.0E-03\n"
+  "     1.0   2  22  22\n";
+
+BOOST_AUTO_TEST_CASE(testLookup)
+{
+  const Coll input = Coll::from_str(decays);
+  DecayTable t1(input);
+
+  BOOST_CHECK_EQUAL(t1.size(), 3);
+  BOOST_CHECK_EQUAL(t1.empty(), false);
+  BOOST_CHECK_EQUAL(t1.count(1000023), 1);
+  BOOST_CHECK_EQUAL(t1.count(1000022), 1);
+  BOOST_CHECK_EQUAL(t1.count(1000021), 0);
+
+  BOOST_CHECK_EQUAL(t1.width(1000023), 2.07770048E-02);
+  BOOST_CHECK_EQUAL(t1.width(1000022), 0.);
+  BOOST_CHECK_EQUAL(t1.width(25), 4.0E-03);
+  BOOST_CHECK_THROW(t1.width(1000021), std::out_of_range);
+
+  BOOST_CHECK_EQUAL(t1.channel_count(1000023), 6);
+  BOOST_CHECK_EQUAL(t1.channel_count(1000022), 0);
+  BOOST_CHECK_EQUAL(t1.channel_count(25), 1);
+
+  BOOST_CHECK_EQUAL(t1.br(1000023, 1000022, 23), 0.1);
+  BOOST_CHECK_EQUAL(t1.br(1000023, 23, 1000022), 0.1);
+  BOOST_CHECK_EQUAL(t1.br(1000023, 1000022, 25), 0.25);
+  BOOST_CHECK_EQUAL(t1.br(1000023, 11, -2000011), 0.5);
+  BOOST_CHECK_EQUAL(t1.br(1000023, -11, 2000011), 0.1);
+  BOOST_CHECK_EQUAL(t1.br(1000023, 11, 2000011), 0.);
+  BOOST_CHECK_EQUAL(t1.br(1000023, 1, -1, 1000022), 0.05);
+  BOOST_CHECK_EQUAL(t1.br(1000023, vector<int>(1, 1000022)), 0.);
+  BOOST_CHECK_EQUAL(t1.br(25, -5, 5), 0.6);
+  BOOST_CHECK_EQUAL(t1.br(25, 22, 22), 0.);
+  BOOST_CHECK_THROW(t1.br(1000021, 1, 2), std::out_of_range);
+
+  BOOST_CHECK_CLOSE(t1.br_sum(1000023), 1., 1e-12);
+  BOOST_CHECK_EQUAL(t1.br_sum(1000022), 0.);
+  BOOST_CHECK_THROW(t1.br_sum(1000021), std::out_of_range);
+
+  vector<DecayTable::Channel> top = t1.top_channels(1000023, 3);
+  BOOST_REQUIRE_EQUAL(top.size(), 3);
+  BOOST_CHECK_EQUAL(top[0].br(), 0.5);
+  BOOST_CHECK_EQUAL(top[0].nda(), 2);
+  BOOST_CHECK_EQUAL(top[0][0], -2000011);
+  BOOST_CHECK_EQUAL(top[0][1], 11);
+  BOOST_CHECK_EQUAL(top[1].br(), 0.25);
+  BOOST_CHECK_EQUAL(*top[1].begin(), 25);
+  BOOST_CHECK_EQUAL(top[1].end() - top[1].begin(), 2);
+  BOOST_CHECK_EQUAL(top[2].br(), 0.1);
+  BOOST_CHECK_EQUAL(top[2][0], -11);
+  BOOST_CHECK_EQUAL(t1.top_channels(1000023, 100).size(), 6);
+  BOOST_CHECK_EQUAL(t1.top_channels(1000022, 5).size(), 0);
+  BOOST_CHECK_THROW(t1.top_channels(1000021, 1), std::out_of_range);
+
+  DecayTable t2;
+  BOOST_CHECK_EQUAL(t2.empty(), true);
+  t2.swap(t1);
+  BOOST_CHECK_EQUAL(t1.size(), 0);
+  BOOST_CHECK_EQUAL(t2.br(25, 5, -5), 0.6);
+  t2.clear();
+  BOOST_CHECK_EQUAL(t2.empty(), true);
+  BOOST_CHECK_THROW(t2.width(25), std::out_of_range);
+  t2.read(input);
+  BOOST_CHECK_EQUAL(t2.width(25), 4.0E-03);
+}
+
+BOOST_AUTO_TEST_CASE(testMalformedBlocks)
+{
+  BOOST_CHECK_THROW(DecayTable(Coll::from_str("DECAY x 1.0\n")),
+    std::invalid_argument);
+  BOOST_CHECK_THROW(DecayTable(Coll::from_str("DECAY 6 1.0\n 1.0 3 5 24\n")),
+    std::invalid_argument);
+  BOOST_CHECK_THROW(DecayTable(Coll::from_str("DECAY 6 1.0\n 1.0 x 5 24\n")),
+    std::invalid_argument);
+  BOOST_CHECK_THROW(DecayTable(Coll::from_str("DECAY 6 1.0\n 1.0 2 b 24\n")),
+    std::invalid_argument);
+  BOOST_CHECK_THROW(DecayTable(Coll::from_str("DECAY 6 1.0\n x 2 5 24\n")),
+    boost::bad_lexical_cast);
+  BOOST_CHECK_THROW(DecayTable(Coll::from_str("DECAY 6 x\n")),
+    boost::bad_lexical_cast);
+
+  DecayTable t1(Coll::from_str("DECAY 6\n 1.0 2 5 24 # comment\n"));
+  BOOST_CHECK_EQUAL(t1.width(6), 0.);
+  BOOST_CHECK_EQUAL(t1.br(6, 24, 5), 1.);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
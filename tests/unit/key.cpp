@@ -5,10 +5,14 @@
 // (See accompanying file ../../LICENSE_1_0.txt or copy at
 // http://www.boost.org/LICENSE_1_0.txt)
 
+#include <new>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
+#include <boost/aligned_storage.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/type_traits/alignment_of.hpp>
 #include "slhaea.h"
 
 using namespace std;
@@ -116,4 +120,87 @@ BOOST_AUTO_TEST_CASE(testStr)
   BOOST_CHECK(ss.str() == k1.str());
 }
 
+BOOST_AUTO_TEST_CASE(testKeyHandle)
+{
+  Coll c1;
+  c1.str("BLOCK A\n 1 10\n 2 20\nBLOCK B\n 1 11 12\n 2 21 22\n");
+  KeyHandle h1(Key("B;2;2"));
+  KeyHandle h2(Key("B;3;1"));
+  KeyHandle h3(Key("C;1;1"));
+
+  BOOST_CHECK_EQUAL(h1.key().str(), "B;2;2");
+  BOOST_CHECK_EQUAL(h1.field(c1), "22");
+  BOOST_CHECK_EQUAL(&h1.field(c1), &c1.field("B;2;2"));
+  BOOST_CHECK_EQUAL(h1.line(c1).str(), " 2 21 22");
+  BOOST_CHECK_EQUAL(h1.block(c1).name(), "B");
+  BOOST_CHECK_THROW(h2.field(c1), out_of_range);
+  BOOST_CHECK_THROW(h3.field(c1), out_of_range);
+
+  h1.field(c1) = "23";
+  BOOST_CHECK_EQUAL(c1.field("B;2;2"), "23");
+
+  // Appending does not move Blocks or Lines.
+  c1.push_back("BLOCK C\n 1 13\n");
+  c1.at("B").push_back(" 3 31 32");
+  BOOST_CHECK_EQUAL(h1.field(c1), "23");
+  BOOST_CHECK_EQUAL(h2.field(c1), "31");
+  BOOST_CHECK_EQUAL(h3.field(c1), "13");
+
+  c1.at("B").erase(c1.at("B").begin() + 1);
+  BOOST_CHECK_EQUAL(h1.field(c1), "23");
+  BOOST_CHECK_EQUAL(h2.field(c1), "31");
+  c1.at("B").insert(c1.at("B").begin() + 1, Line(" 0 1 2"));
+  BOOST_CHECK_EQUAL(h1.field(c1), "23");
+
+  c1.erase(c1.begin());
+  BOOST_CHECK_EQUAL(h1.field(c1), "23");
+  BOOST_CHECK_EQUAL(h3.field(c1), "13");
+  c1.push_front(Block("C"));
+  BOOST_CHECK_THROW(h3.field(c1), out_of_range);
+
+  // Assigned and swapped Blocks and Colls are looked up again.
+  Coll::iterator b1 = c1.begin(), b2 = c1.begin() + 1, b3 = c1.begin() + 2;
+  *b1 = *b3;
+  *b3 = *b2;
+  b3->at(2)[2] = "24";
+  BOOST_CHECK_EQUAL(h1.field(c1), "23");
+  BOOST_CHECK_EQUAL(h3.field(c1), "13");
+  b1->swap(*b3);
+  // The first Block is renamed to B through a reference, which is not
+  // noticed since the remembered Block B is unchanged.
+  BOOST_CHECK_EQUAL(h1.field(c1), "23");
+  h1.reset();
+  BOOST_CHECK_EQUAL(h1.field(c1), "24");
+  BOOST_CHECK_EQUAL(h3.field(c1), "13");
+
+  Coll c2;
+  c2.str("BLOCK B\n 2 0 25\n");
+  const Coll& cc2 = c2;
+  BOOST_CHECK_EQUAL(h1.field(cc2), "25");
+  c1 = c2;
+  BOOST_CHECK_EQUAL(h1.field(c1), "25");
+  c2.at("B").at(2)[2] = "26";
+  c1.swap(c2);
+  BOOST_CHECK_EQUAL(h1.field(c1), "26");
+
+  c1.at("B").at(2).str("2");
+  BOOST_CHECK_THROW(h1.field(c1), out_of_range);
+  c1.clear();
+  BOOST_CHECK_THROW(h1.field(c1), out_of_range);
+
+  // A Coll constructed at the address of a destroyed one is looked up
+  // again.
+  KeyHandle h4(Key("A;1;1"));
+  boost::aligned_storage<sizeof(Coll),
+                         boost::alignment_of<Coll>::value> storage;
+  Coll* c3 = new (storage.address()) Coll;
+  c3->str("BLOCK A\n 1 10\n");
+  BOOST_CHECK_EQUAL(h4.field(*c3), "10");
+  c3->~Coll();
+  c3 = new (storage.address()) Coll;
+  c3->str("BLOCK X\n 2 0\nBLOCK A\n 3 0\n 1 11\n");
+  BOOST_CHECK_EQUAL(h4.field(*c3), "11");
+  c3->~Coll();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,7 +6,10 @@
 // http://www.boost.org/LICENSE_1_0.txt)
 
 #include <algorithm>
+#include <cstring>
+#include <iomanip>
 #include <limits>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <boost/concept/assert.hpp>
@@ -124,6 +127,30 @@ BOOST_AUTO_TEST_CASE(testAssignmentOperator)
   BOOST_CHECK_EQUAL(l1.data_size(), 4);
 }
 
+BOOST_AUTO_TEST_CASE(testRangeAssignment)
+{
+  const string buffer = "  1 2#3 \t\r\n 4 5 6\n";
+  Line l1("a b c d e f g");
+
+  l1.str(buffer.data(), buffer.data() + buffer.length());
+  BOOST_CHECK_EQUAL(l1.str(),       "  1 2 #3");
+  BOOST_CHECK_EQUAL(l1.size(),      3);
+  BOOST_CHECK_EQUAL(l1.data_size(), 2);
+  BOOST_CHECK_EQUAL(l1[2],          "#3");
+
+  const char* second = buffer.data() + buffer.find('\n') + 1;
+  l1.str(second, buffer.data() + buffer.length());
+  BOOST_CHECK_EQUAL(l1.str(),       " 4 5 6");
+  BOOST_CHECK_EQUAL(l1.size(),      3);
+
+  l1.str(second, second + 2);
+  BOOST_CHECK_EQUAL(l1.str(),       " 4");
+  BOOST_CHECK_EQUAL(l1.size(),      1);
+
+  l1.str(second, second);
+  BOOST_CHECK_EQUAL(l1.empty(),     true);
+}
+
 BOOST_AUTO_TEST_CASE(testAppending)
 {
   Line l1;
@@ -242,6 +269,82 @@ BOOST_AUTO_TEST_CASE(testFloatInserting)
   BOOST_CHECK_EQUAL(l1.str(), "    3   " + to_string(ld, digits_ld));
 }
 
+BOOST_AUTO_TEST_CASE(testNumberFormat)
+{
+  Line l1;
+  BOOST_CHECK(l1.format() == number_format::digits10());
+
+  l1 << number_format::slha() << 25 << 125.;
+  BOOST_CHECK_EQUAL(l1.str(), "    25  1.25000000E+02");
+  l1 << -1.5e-12;
+  BOOST_CHECK_EQUAL(l1[2], "-1.50000000E-12");
+
+  l1.clear();
+  BOOST_CHECK(l1.format() == number_format::slha());
+  l1 << number_format::shortest() << 0.1 << 1. << -0. << 1.25e-300;
+  BOOST_CHECK_EQUAL(l1.str(), "    1e-01   1e+00  -0e+00   1.25e-300");
+  l1 << "# c" << 2.5;
+  BOOST_CHECK_EQUAL(l1.back(), "# c2.5e+00");
+
+  l1.clear();
+  l1 << number_format::scientific(3) << 1. / 3 << 2.f;
+  BOOST_CHECK_EQUAL(l1.str(), "    3.333e-01   2.000e+00");
+  BOOST_CHECK(number_format::scientific(-1) == number_format::scientific(6));
+  BOOST_CHECK(number_format::scientific(8) != number_format::slha());
+  BOOST_CHECK_THROW(number_format::scientific(256), std::invalid_argument);
+
+  const Line l2 = l1;
+  BOOST_CHECK(l2.format() == number_format::scientific(3));
+  Line l3;
+  l3.swap(l1);
+  BOOST_CHECK(l1.format() == number_format::digits10());
+  BOOST_CHECK(l3.format() == number_format::scientific(3));
+
+  BOOST_CHECK_EQUAL(number_format::slha().str(-2.), "-2.00000000E+00");
+  BOOST_CHECK_EQUAL(number_format::shortest().str(1e23), "1e+23");
+  BOOST_CHECK_EQUAL(number_format::shortest().str(0.3f), "3e-01");
+  BOOST_CHECK_EQUAL(number_format::scientific(20).str(0.5),
+                    "5.00000000000000000000e-01");
+  char buffer[8];
+  BOOST_CHECK(number_format::slha().write(buffer, buffer + 8, 1.) == 0);
+  BOOST_CHECK_EQUAL(string(buffer, number_format::shortest().write(
+                      buffer, buffer + 8, 1e10)), "1e+10");
+}
+
+BOOST_AUTO_TEST_CASE(testNumberFormatRoundTrip)
+{
+  // Values from all ranges of exponents and with all numbers of
+  // significant digits.
+  // 0x0123456789abcdef without a long long literal, which is not C++98.
+  boost::uint64_t bits = (static_cast<boost::uint64_t>(0x01234567UL) << 32) |
+    0x89abcdefUL;
+  Line l1;
+  l1 << number_format::shortest();
+  int mismatches = 0, longer = 0;
+  for (int i = 0; i < 20000; ++i)
+  {
+    bits ^= bits << 13; bits ^= bits >> 7; bits ^= bits << 17;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if (value != value || value - value != 0) continue;
+
+    l1.clear();
+    l1 << value;
+    const double read = l1.as<double>(0);
+    if (memcmp(&read, &value, sizeof(value)) != 0) ++mismatches;
+    if (l1[0].length() > SLHAea::to_string(value, 16).length()) ++longer;
+
+    const float f = static_cast<float>(value);
+    if (f - f == 0 && to<float>(number_format::shortest().str(f)) != f)
+    { ++mismatches; }
+  }
+  BOOST_CHECK_EQUAL(mismatches, 0);
+  BOOST_CHECK_EQUAL(longer, 0);
+
+  const long double ld = 1.L / 3;
+  BOOST_CHECK_EQUAL(to<long double>(number_format::shortest().str(ld)), ld);
+}
+
 BOOST_AUTO_TEST_CASE(testSubscriptAccessor)
 {
   Line l1("1 2 3 # 4 5");
@@ -398,6 +501,12 @@ BOOST_AUTO_TEST_CASE(testIterators)
   *(l1.begin()+4) = "# 5";
                            // " one two three four # five "
   BOOST_CHECK_EQUAL(l1.str(), " 1   2   3     4    # 5");
+
+  Line::const_iterator cit = l1.begin();
+  BOOST_CHECK(cit == l1.cbegin());
+  BOOST_CHECK(l1.end() - cit == 5);
+  BOOST_CHECK_EQUAL(cit->length(), 1);
+  BOOST_CHECK_EQUAL(cit[4], "# 5");
 }
 
 BOOST_AUTO_TEST_CASE(testIntrospection)
@@ -504,6 +613,101 @@ BOOST_AUTO_TEST_CASE(testIntrospection)
   BOOST_CHECK_EQUAL(l1.is_data_line(),    true);
 }
 
+BOOST_AUTO_TEST_CASE(testIntrospectionAfterChanges)
+{
+  Line l1("BLOCK test # comment");
+  BOOST_CHECK_EQUAL(l1.is_block_def(), true);
+  BOOST_CHECK_EQUAL(l1.data_size(), 2);
+
+  l1[1] = "#";
+  BOOST_CHECK_EQUAL(l1.is_block_def(), false);
+  BOOST_CHECK_EQUAL(l1.is_data_line(), false);
+  BOOST_CHECK_EQUAL(l1.data_size(), 1);
+
+  l1.at(0) = "1";
+  BOOST_CHECK_EQUAL(l1.is_data_line(), true);
+
+  l1.front() = "#";
+  BOOST_CHECK_EQUAL(l1.is_comment_line(), true);
+  BOOST_CHECK_EQUAL(l1.data_size(), 0);
+
+  *l1.begin() = "decay";
+  l1[1] = "x";
+  l1.back() = "1";
+  BOOST_CHECK_EQUAL(l1.is_block_def(), true);
+  BOOST_CHECK_EQUAL(l1.data_size(), 3);
+
+  *l1.rbegin() = "#";
+  BOOST_CHECK_EQUAL(l1.data_size(), 2);
+  *(l1.end() - 2) = "# x";
+  BOOST_CHECK_EQUAL(l1.is_block_def(), false);
+  BOOST_CHECK_EQUAL(l1.data_size(), 1);
+
+  Line l2("1 2");
+  l1.swap(l2);
+  BOOST_CHECK_EQUAL(l1.is_data_line(), true);
+  BOOST_CHECK_EQUAL(l1.data_size(), 2);
+  BOOST_CHECK_EQUAL(l2.data_size(), 1);
+
+  l1 << "# c";
+  BOOST_CHECK_EQUAL(l1.data_size(), 2);
+  BOOST_CHECK_EQUAL(l1.size(), 3);
+  l1.comment();
+  BOOST_CHECK_EQUAL(l1.is_comment_line(), true);
+  l1.uncomment();
+  BOOST_CHECK_EQUAL(l1.is_data_line(), true);
+
+  l1.clear();
+  BOOST_CHECK_EQUAL(l1.is_data_line(), false);
+  BOOST_CHECK_EQUAL(l1.data_size(), 0);
+
+  const Line l3 = l2;
+  BOOST_CHECK_EQUAL(l3.is_block_def(), false);
+  BOOST_CHECK_EQUAL(l3.data_size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testAs)
+{
+  Line l1(" 1000022  9.7E+01  # ~chi_10");
+  BOOST_CHECK_EQUAL(l1.as<int>(0), 1000022);
+  BOOST_CHECK_EQUAL(l1.as<double>(1), 97.);
+  BOOST_CHECK_EQUAL(l1.as<double>(1), 97.);
+  BOOST_CHECK_EQUAL(l1.as<double>(0), 1000022.);
+  BOOST_CHECK_EQUAL(l1.as<string>(2), "# ~chi_10");
+  BOOST_CHECK_THROW(l1.as<double>(2), boost::bad_lexical_cast);
+  BOOST_CHECK_THROW(l1.as<double>(3), std::out_of_range);
+
+  l1[1] = "98";
+  BOOST_CHECK_EQUAL(l1.as<double>(1), 98.);
+  l1.at(1) = "99";
+  BOOST_CHECK_EQUAL(l1.as<double>(1), 99.);
+  BOOST_CHECK_EQUAL(l1.as<double>(0), 1000022.);
+  l1.front() = "1";
+  BOOST_CHECK_EQUAL(l1.as<double>(0), 1.);
+  *(l1.begin() + 1) = "100";
+  BOOST_CHECK_EQUAL(l1.as<double>(1), 100.);
+
+  const Line l2 = l1;
+  BOOST_CHECK_EQUAL(l2.as<double>(1), 100.);
+
+  l1.str(" 2  0.5");
+  BOOST_CHECK_EQUAL(l1.as<double>(0), 2.);
+  BOOST_CHECK_EQUAL(l1.as<double>(1), 0.5);
+  l1.back() = "0.25";
+  BOOST_CHECK_EQUAL(l1.as<double>(1), 0.25);
+
+  Line l3("3");
+  l3.swap(l1);
+  BOOST_CHECK_EQUAL(l1.as<double>(0), 3.);
+  BOOST_CHECK_EQUAL(l3.as<double>(1), 0.25);
+  BOOST_CHECK_THROW(l1.as<double>(1), std::out_of_range);
+
+  l3.clear();
+  BOOST_CHECK_THROW(l3.as<double>(0), std::out_of_range);
+  l3 << 4.5;
+  BOOST_CHECK_EQUAL(l3.as<double>(0), 4.5);
+}
+
 BOOST_AUTO_TEST_CASE(testSwap)
 {
   Line l1(" 1  23 4  5 ");
@@ -524,6 +728,63 @@ BOOST_AUTO_TEST_CASE(testSwap)
   BOOST_CHECK_EQUAL(l2, cl2);
 }
 
+struct counting_sink
+{
+  counting_sink() : calls(0) {}
+
+  void
+  append(const char* str, size_t n)
+  {
+    text.append(str, n);
+    ++calls;
+  }
+
+  string text;
+  size_t calls;
+};
+
+BOOST_AUTO_TEST_CASE(testWriteTo)
+{
+  const char* lines[] = { "", "1", "   1  2   0.5  # comment",
+    "BLOCK MASS  # masses", "#only comment", "\t 1\t2",
+    "        1000022     9.7E+01   # ~chi_10" };
+  for (int i = 0; i < 7; ++i)
+  {
+    const Line l1(lines[i]);
+    string s1 = "> ";
+    BOOST_CHECK_EQUAL(&l1.append_to(s1), &s1);
+    BOOST_CHECK_EQUAL(s1, "> " + l1.str());
+
+    counting_sink sink;
+    BOOST_CHECK_EQUAL(&l1.write_to(sink), &sink);
+    BOOST_CHECK_EQUAL(sink.text, l1.str());
+
+    ostringstream os;
+    os << l1;
+    BOOST_CHECK_EQUAL(os.str(), l1.str());
+  }
+
+  // Fields that no longer fit at their column follow after one space.
+  Line l2("  1 2  3 # c");
+  l2[0] = "1000";
+  l2[2] = "33";
+  BOOST_CHECK_EQUAL(l2.str(), "  1000 2 33 # c");
+  l2[1] = "";
+  BOOST_CHECK_EQUAL(l2.str(), "  1000  33 # c");
+
+  Line l3("1");
+  l3 << string(100, 'x');
+  BOOST_CHECK_EQUAL(l3.str(), "    1   " + string(100, 'x'));
+  l3.reformat();
+  l3[0] = string(40, 'y');
+  BOOST_CHECK_EQUAL(l3.str(),
+                    "    " + string(40, 'y') + " " + string(100, 'x'));
+
+  ostringstream os;
+  os << setw(12) << Line("1 2") << "|";
+  BOOST_CHECK_EQUAL(os.str(), "         1 2|");
+}
+
 BOOST_AUTO_TEST_CASE(testReformat)
 {
   Line l1;
@@ -636,6 +897,14 @@ BOOST_AUTO_TEST_CASE(testInEquality)
   BOOST_CHECK(l1 != l2);
   BOOST_CHECK(l2 != l1);
 
+  // The columns differ, but the fields are written at the same
+  // positions.
+  l1 = "1 2";
+  l1[0] = "111";
+  l2 = "111 2";
+  BOOST_CHECK_EQUAL(l1.str(), l2.str());
+  BOOST_CHECK_EQUAL(l1, l2);
+
   l1 = "1 2 3 4";
   l2 = "1 2 3 5";
   BOOST_CHECK_NE(l1, l2);
@@ -0,0 +1,160 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+namespace {
+
+// Records all events as strings and rebuilds the Coll they describe
+// (without the original columns of the fields).
+struct Recorder : ParseHandler
+{
+  void
+  on_block_def(field_type name, const fields_type& fields)
+  {
+    events.push_back("def " + name.to_string() + ": " + join(fields));
+    coll.push_back(Block(name.to_string()));
+    coll.back().push_back(join(fields));
+  }
+
+  void
+  on_comment(field_type text)
+  {
+    events.push_back("comment: " + text.to_string());
+    data_line(fields_type(1, text));
+  }
+
+  void
+  on_data_line(const fields_type& fields)
+  {
+    events.push_back("data: " + join(fields));
+    data_line(fields);
+  }
+
+  void
+  data_line(const fields_type& fields)
+  {
+    if (coll.empty()) coll.push_back(Block());
+    coll.back().push_back(join(fields));
+  }
+
+  static string
+  join(const fields_type& fields)
+  {
+    string result;
+    for (size_t i = 0; i < fields.size(); ++i)
+    { result += (i ? " " : "") + fields[i].to_string(); }
+    return result;
+  }
+
+  vector<string> events;
+  Coll coll;
+};
+
+// Only counts the data lines.
+struct Counter : ParseHandler
+{
+  Counter() : data_lines(0) {}
+
+  void
+  on_data_line(const fields_type&)
+  { ++data_lines; }
+
+  size_t data_lines;
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TestParse)
+
+BOOST_AUTO_TEST_CASE(testEvents)
+{
+  string s1 =
+    "# leading comment  \n"
+    "\n"
+    "  BLOCK test1 Q= 1.0 # 1st comment\n"
+    " 1 2#3\r\n"
+    "Block # no block definition\n"
+    "  decay\t1000022   2.5\n"
+    "   #indented comment";
+
+  Recorder r1;
+  parse(s1.data(), s1.data() + s1.length(), r1);
+
+  BOOST_REQUIRE_EQUAL(r1.events.size(), 6);
+  BOOST_CHECK_EQUAL(r1.events[0], "comment: # leading comment");
+  BOOST_CHECK_EQUAL(r1.events[1], "def test1: BLOCK test1 Q= 1.0 # 1st comment");
+  BOOST_CHECK_EQUAL(r1.events[2], "data: 1 2 #3");
+  BOOST_CHECK_EQUAL(r1.events[3], "data: Block # no block definition");
+  BOOST_CHECK_EQUAL(r1.events[4], "def 1000022: decay 1000022 2.5");
+  BOOST_CHECK_EQUAL(r1.events[5], "comment: #indented comment");
+
+  Coll c1;
+  c1.str(s1);
+  c1.reformat();
+  r1.coll.reformat();
+  BOOST_CHECK(r1.coll == c1);
+
+  Recorder r2;
+  parse(s1.data(), s1.data(), r2);
+  BOOST_CHECK_EQUAL(r2.events.empty(), true);
+}
+
+BOOST_AUTO_TEST_CASE(testParseStream)
+{
+  string s1 = "# " + string(100000, 'x') + "\n";
+  for (int i = 0; i < 5000; ++i)
+  {
+    s1 += "BLOCK test" + to_string(i) + "\n"
+          " 1  2  # comment\n"
+          "\n"
+          "\t3  4\r\n";
+  }
+  s1 += " 5 6";
+
+  Recorder r1, r2;
+  parse(s1.data(), s1.data() + s1.length(), r1);
+  stringstream ss1(s1);
+  parse(ss1, r2);
+
+  BOOST_CHECK_EQUAL(r1.events.size(), 15002);
+  BOOST_CHECK(r1.events == r2.events);
+  BOOST_CHECK_EQUAL(r2.events.back(), "data: 5 6");
+
+  Counter c1;
+  stringstream ss2("");
+  parse(ss2, c1);
+  BOOST_CHECK_EQUAL(c1.data_lines, 0);
+}
+
+BOOST_AUTO_TEST_CASE(testParseFile)
+{
+  const char* path = "parse_file.txt";
+  {
+    ofstream ofs(path);
+    ofs << "BLOCK test\n 1 1\n 2 2\n";
+  }
+
+  Counter c1;
+  parse_file(path, c1);
+  BOOST_CHECK_EQUAL(c1.data_lines, 2);
+
+  remove(path);
+  BOOST_CHECK_THROW(parse_file(path, c1), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,180 @@
+// SLHAea - containers for SUSY Les Houches Accord input/output
+// Copyright © 2010 Frank S. Thomas <frank@timepit.eu>
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file ../../LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include "slhaea.h"
+
+using namespace std;
+using namespace SLHAea;
+
+namespace {
+
+// A stream buffer that cannot be repositioned, like the one of a pipe.
+struct unseekable_buf : std::streambuf
+{
+  explicit unseekable_buf(string& str)
+  { setg(&str[0], &str[0], &str[0] + str.length()); }
+};
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(TestBlockReader)
+
+BOOST_AUTO_TEST_CASE(testNext)
+{
+  string s1 =
+    "# leading comment\r\n"
+    "\n"
+    "BLOCK test1\r\n" " 1  123\r\n"
+    "DECAY 6 1.5\n" "  1.0 2 5 24\n"
+    "   \n"
+    "BLOCK test3";
+
+  unseekable_buf buf(s1);
+  istream is1(&buf);
+  BlockReader r1(is1);
+  Block b1("test");
+
+  BOOST_CHECK(r1.next(b1));
+  BOOST_CHECK_EQUAL(b1.name(), "");
+  BOOST_CHECK_EQUAL(b1.str(), "# leading comment\n");
+  BOOST_CHECK(r1.next(b1));
+  BOOST_CHECK_EQUAL(b1.name(), "test1");
+  BOOST_CHECK_EQUAL(b1.str(), "BLOCK test1\n" " 1  123\n");
+  BOOST_CHECK(r1.next(b1));
+  BOOST_CHECK_EQUAL(b1.name(), "6");
+  BOOST_CHECK_EQUAL(b1.size(), 2);
+  BOOST_CHECK(r1.next(b1));
+  BOOST_CHECK_EQUAL(b1.name(), "test3");
+  BOOST_CHECK_EQUAL(b1.size(), 1);
+  BOOST_CHECK(!r1.next(b1));
+  BOOST_CHECK_EQUAL(b1.empty(), true);
+  BOOST_CHECK_EQUAL(b1.name(), "");
+
+  stringstream ss1(s1);
+  BlockReader r2(ss1);
+  Coll c1;
+  while (r2.next(b1)) c1.push_back(b1);
+  BOOST_CHECK_EQUAL(c1, Coll::from_str(s1));
+
+  stringstream ss2("\n \n");
+  BlockReader r3(ss2);
+  BOOST_CHECK(!r3.next(b1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+
+BOOST_AUTO_TEST_SUITE(TestSpectrumReader)
+
+BOOST_AUTO_TEST_CASE(testRepeatedBlock)
+{
+  string s1 =
+    "# 1st spectrum\n"
+    "BLOCK MASS\n"
+    " 1000022 100.0\n"
+    "BLOCK test\n"
+    " 1 1\n"
+    "DECAY 1000022 0.0\n";
+  string s2 =
+    "block mass # 2nd spectrum\n"
+    " 1000022 200.0\n"
+    " 1000023 300.0\n";
+  string s3 =
+    "\n"
+    "Block Mass\n"
+    " 1000022 300.0\n"
+    "BLOCK test\n"
+    " 1 1\n"
+    " 2 2\n"
+    "BLOCK test2\n"
+    " 1 1\n";
+  string s4 = s1 + s2 + s3 + s2 + "\n \n";
+
+  SpectrumReader r1(s4.data(), s4.data() + s4.length());
+  BOOST_CHECK_EQUAL(r1.separator(), "");
+
+  Coll c1;
+  BOOST_CHECK(r1.next(c1));
+  BOOST_CHECK_EQUAL(c1, Coll::from_str(s1));
+  BOOST_CHECK_EQUAL(c1.size(), 4);
+  BOOST_CHECK_EQUAL(c1.front().name(), "");
+  BOOST_CHECK(r1.next(c1));
+  BOOST_CHECK_EQUAL(c1, Coll::from_str(s2));
+  BOOST_CHECK_EQUAL(c1.size(), 1);
+  BOOST_CHECK_EQUAL(c1.front().name(), "mass");
+  BOOST_CHECK(r1.next(c1));
+  BOOST_CHECK_EQUAL(c1, Coll::from_str(s3));
+  BOOST_CHECK_EQUAL(c1.str(), Coll::from_str(s3).str());
+  BOOST_CHECK(r1.next(c1));
+  BOOST_CHECK_EQUAL(c1, Coll::from_str(s2));
+  BOOST_CHECK(!r1.next(c1));
+  BOOST_CHECK_EQUAL(c1.empty(), true);
+  BOOST_CHECK(!r1.next(c1));
+
+  SpectrumReader r2(s4.data(), s4.data());
+  BOOST_CHECK(!r2.next(c1));
+}
+
+BOOST_AUTO_TEST_CASE(testMarker)
+{
+  string s1 =
+    "BLOCK A\n"
+    " 1 1\n";
+  string s2 =
+    "  # point 1\n"
+    "BLOCK A\n"
+    " 1 2\n"
+    "BLOCK A\n"
+    " 1 3\n";
+  string s3 =
+    "# point 2\n"
+    "BLOCK B\n"
+    " #point 3\n";
+  string s4 = s1 + s2 + s3;
+
+  SpectrumReader r1(s4.data(), s4.data() + s4.length());
+  r1.separator("# point");
+  BOOST_CHECK_EQUAL(r1.separator(), "# point");
+
+  Coll c1;
+  BOOST_CHECK(r1.next(c1));
+  BOOST_CHECK_EQUAL(c1, Coll::from_str(s1));
+  BOOST_CHECK(r1.next(c1));
+  BOOST_CHECK_EQUAL(c1, Coll::from_str(s2));
+  BOOST_CHECK_EQUAL(c1.size(), 3);
+  BOOST_CHECK(r1.next(c1));
+  BOOST_CHECK_EQUAL(c1, Coll::from_str(s3));
+  BOOST_CHECK(!r1.next(c1));
+}
+
+BOOST_AUTO_TEST_CASE(testFile)
+{
+  const char* path = "reader_file.txt";
+  {
+    ofstream ofs(path);
+    ofs << "BLOCK A\n 1 1\nBLOCK A\n 1 2";
+  }
+
+  SpectrumReader r1(path);
+  Coll c1;
+  BOOST_CHECK(r1.next(c1));
+  BOOST_CHECK_EQUAL(c1.at("A").at("1").at(1), "1");
+  BOOST_CHECK(r1.next(c1));
+  BOOST_CHECK_EQUAL(c1.at("A").at("1").at(1), "2");
+  BOOST_CHECK(!r1.next(c1));
+
+  remove(path);
+  BOOST_CHECK_THROW(SpectrumReader r2(path), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()